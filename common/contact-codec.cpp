@@ -0,0 +1,383 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "contact-codec.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QDateTime>
+#include <QtCore/QUrl>
+
+#include <QtContacts/QContactId>
+#include <QtContacts/QContactType>
+#include <QtContacts/QContactManagerEngine>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifndef MFD_CLOEXEC
+#include <linux/memfd.h>
+#endif
+
+#define CONTACT_CODEC_MAGIC     0x47414c42  // "GALB"
+
+using namespace QtContacts;
+
+namespace
+{
+    enum ValueTag {
+        TagInvalid = 0,
+        TagString,
+        TagBool,
+        TagInt,
+        TagDouble,
+        TagDate,
+        TagDateTime,
+        TagUrl,
+        TagByteArray,
+        TagStringList,
+        TagIntList,
+        // any other type supported by QVariant streaming
+        TagVariant
+    };
+}
+
+namespace galera
+{
+
+const quint16 ContactCodec::FormatVersion = 1;
+
+QByteArray ContactCodec::encode(const QList<QContact> &contacts)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    stream << quint32(CONTACT_CODEC_MAGIC) << FormatVersion << quint32(contacts.size());
+
+    Q_FOREACH(const QContact &contact, contacts) {
+        stream << contact.id().toString();
+
+        const QList<QContactDetail> details = contact.details();
+        stream << quint32(details.size());
+        Q_FOREACH(const QContactDetail &detail, details) {
+            const QMap<int, QVariant> values = detail.values();
+            stream << quint32(detail.type())
+                   << quint32(detail.accessConstraints())
+                   << quint32(values.size());
+            QMap<int, QVariant>::const_iterator i = values.constBegin();
+            for(; i != values.constEnd(); i++) {
+                stream << qint32(i.key());
+                encodeValue(stream, i.value());
+            }
+        }
+
+        const QMap<QString, QContactDetail> preferred = contact.preferredDetails();
+        stream << quint32(preferred.size());
+        QMap<QString, QContactDetail>::const_iterator p = preferred.constBegin();
+        for(; p != preferred.constEnd(); p++) {
+            stream << p.key() << qint32(details.indexOf(p.value()));
+        }
+    }
+
+    return data;
+}
+
+bool ContactCodec::decode(const QByteArray &data, QList<QContact> *contacts)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> count;
+    if ((magic != CONTACT_CODEC_MAGIC) || (version != FormatVersion)) {
+        qWarning() << "Invalid contacts data, format version" << version;
+        return false;
+    }
+
+    QList<QContact> result;
+    result.reserve(count);
+    for(quint32 c = 0; (c < count) && (stream.status() == QDataStream::Ok); c++) {
+        QContact contact;
+        QString id;
+        stream >> id;
+        if (!id.isEmpty()) {
+            contact.setId(QContactId::fromString(id));
+        }
+
+        quint32 detailsCount = 0;
+        stream >> detailsCount;
+        QList<QContactDetail> details;
+        for(quint32 d = 0; (d < detailsCount) && (stream.status() == QDataStream::Ok); d++) {
+            quint32 type = 0;
+            quint32 access = 0;
+            quint32 valuesCount = 0;
+            stream >> type >> access >> valuesCount;
+
+            QContactDetail detail(static_cast<QContactDetail::DetailType>(type));
+            // the contact type detail is unique
+            if (detail.type() == QContactDetail::TypeType) {
+                detail = contact.detail(QContactDetail::TypeType);
+            }
+            for(quint32 v = 0; v < valuesCount; v++) {
+                qint32 field = 0;
+                QVariant value;
+                stream >> field;
+                if (!decodeValue(stream, &value)) {
+                    qWarning() << "Invalid contacts data";
+                    return false;
+                }
+                detail.setValue(field, value);
+            }
+            QContactManagerEngine::setDetailAccessConstraints(&detail,
+                                                              QContactDetail::AccessConstraints(access));
+            if (detail.type() == QContactDetail::TypeType) {
+                contact.saveDetail(&detail);
+            } else {
+                contact.appendDetail(detail);
+            }
+            details << detail;
+        }
+
+        quint32 preferredCount = 0;
+        stream >> preferredCount;
+        for(quint32 p = 0; p < preferredCount; p++) {
+            QString action;
+            qint32 index = -1;
+            stream >> action >> index;
+            if ((index >= 0) && (index < details.size())) {
+                contact.setPreferredDetail(action, details[index]);
+            }
+        }
+
+        result << contact;
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Invalid contacts data";
+        return false;
+    }
+
+    *contacts = result;
+    return true;
+}
+
+int ContactCodec::encodeToFile(const QList<QContact> &contacts)
+{
+#if defined(__NR_memfd_create) && defined(F_ADD_SEALS)
+    // memfd_create is not exposed by old glibc versions
+    int fd = syscall(__NR_memfd_create, "galera-contacts", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        qWarning() << "Fail to create memory file" << strerror(errno);
+        return -1;
+    }
+
+    const QByteArray data = encode(contacts);
+    qint64 written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.constData() + written, data.size() - written);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qWarning() << "Fail to write contacts to memory file" << strerror(errno);
+            close(fd);
+            return -1;
+        }
+        written += n;
+    }
+
+    // the receiver maps the file, make sure that it will not change anymore
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        qWarning() << "Fail to seal memory file" << strerror(errno);
+    }
+    return fd;
+#else
+    Q_UNUSED(contacts);
+    return -1;
+#endif
+}
+
+bool ContactCodec::decodeFromFile(int fd, QList<QContact> *contacts)
+{
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        qWarning() << "Invalid contacts file" << strerror(errno);
+        return false;
+    }
+
+    if (st.st_size == 0) {
+        qWarning() << "Empty contacts file";
+        return false;
+    }
+
+    void *map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        qWarning() << "Fail to map contacts file" << strerror(errno);
+        return false;
+    }
+
+    // decode in place, the data is not copied
+    bool result = decode(QByteArray::fromRawData(static_cast<const char*>(map), st.st_size), contacts);
+    munmap(map, st.st_size);
+    return result;
+}
+
+void ContactCodec::encodeValue(QDataStream &stream, const QVariant &value)
+{
+    switch(value.userType()) {
+    case QMetaType::UnknownType:
+        stream << quint8(TagInvalid);
+        break;
+    case QMetaType::QString:
+        stream << quint8(TagString) << value.toString();
+        break;
+    case QMetaType::Bool:
+        stream << quint8(TagBool) << value.toBool();
+        break;
+    case QMetaType::Int:
+        stream << quint8(TagInt) << qint32(value.toInt());
+        break;
+    case QMetaType::Double:
+        stream << quint8(TagDouble) << value.toDouble();
+        break;
+    case QMetaType::QDate:
+        stream << quint8(TagDate) << value.toDate();
+        break;
+    case QMetaType::QDateTime:
+        stream << quint8(TagDateTime) << value.toDateTime();
+        break;
+    case QMetaType::QUrl:
+        stream << quint8(TagUrl) << value.toUrl();
+        break;
+    case QMetaType::QByteArray:
+        stream << quint8(TagByteArray) << value.toByteArray();
+        break;
+    case QMetaType::QStringList:
+        stream << quint8(TagStringList) << value.toStringList();
+        break;
+    default:
+        if (value.userType() == qMetaTypeId<QList<int> >()) {
+            stream << quint8(TagIntList) << value.value<QList<int> >();
+        } else if (value.userType() < QMetaType::User) {
+            stream << quint8(TagVariant) << value;
+        } else {
+            qWarning() << "Contact value type not supported" << value.typeName();
+            stream << quint8(TagString) << value.toString();
+        }
+        break;
+    }
+}
+
+bool ContactCodec::decodeValue(QDataStream &stream, QVariant *value)
+{
+    quint8 tag = TagInvalid;
+    stream >> tag;
+
+    switch(tag) {
+    case TagInvalid:
+        *value = QVariant();
+        break;
+    case TagString:
+    {
+        QString v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagBool:
+    {
+        bool v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagInt:
+    {
+        qint32 v;
+        stream >> v;
+        *value = int(v);
+        break;
+    }
+    case TagDouble:
+    {
+        double v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagDate:
+    {
+        QDate v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagDateTime:
+    {
+        QDateTime v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagUrl:
+    {
+        QUrl v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagByteArray:
+    {
+        QByteArray v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagStringList:
+    {
+        QStringList v;
+        stream >> v;
+        *value = v;
+        break;
+    }
+    case TagIntList:
+    {
+        QList<int> v;
+        stream >> v;
+        *value = QVariant::fromValue<QList<int> >(v);
+        break;
+    }
+    case TagVariant:
+        stream >> *value;
+        break;
+    default:
+        return false;
+    }
+
+    return (stream.status() == QDataStream::Ok);
+}
+
+}
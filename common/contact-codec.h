@@ -0,0 +1,61 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_CONTACT_CODEC_H__
+#define __GALERA_CONTACT_CODEC_H__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QVariant>
+
+#include <QtContacts/QContact>
+
+class QDataStream;
+
+namespace galera
+{
+
+// Binary encoding of a list of contacts used by AddressBookView.contactsDetailsBinary.
+//
+// The data starts with a header (magic, format version, number of contacts) and
+// each contact is written as: id, details (type, access constraints and the
+// detail field values with a type tag) and the preferred details as an index
+// on the contact details list. All values are written with QDataStream (Qt_5_0).
+//
+// encodeToFile writes the same data into an anonymous memory file (memfd) that can
+// be sent over D-Bus as an unix file descriptor, decodeFromFile maps it back.
+class ContactCodec
+{
+public:
+    static const quint16 FormatVersion;
+
+    static QByteArray encode(const QList<QtContacts::QContact> &contacts);
+    static bool decode(const QByteArray &data, QList<QtContacts::QContact> *contacts);
+
+    // returns a read-only file descriptor or -1 if memfd is not supported
+    static int encodeToFile(const QList<QtContacts::QContact> &contacts);
+    static bool decodeFromFile(int fd, QList<QtContacts::QContact> *contacts);
+
+private:
+    static void encodeValue(QDataStream &stream, const QVariant &value);
+    static bool decodeValue(QDataStream &stream, QVariant *value);
+};
+
+}
+
+#endif
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "filter-program.h"
+
+#include <QtCore/QDebug>
+
+#include <QtContacts/QContactIdFilter>
+#include <QtContacts/QContactDetailFilter>
+#include <QtContacts/QContactUnionFilter>
+#include <QtContacts/QContactIntersectionFilter>
+#include <QtContacts/QContactChangeLogFilter>
+#include <QtContacts/QContactManagerEngine>
+#include <QtContacts/QContactPhoneNumber>
+
+#include <algorithm>
+
+// relative cost of each operation, used to sort the terms of unions and intersections
+#define COST_CONSTANT           0
+#define COST_ID                 1
+#define COST_CHANGE_LOG         1
+#define COST_DETAIL_PRESENCE    2
+#define COST_DETAIL_STRING      4
+#define COST_ENGINE             8
+#define COST_DETAIL_PHONE       16
+
+using namespace QtContacts;
+
+namespace galera
+{
+
+FilterProgram::FilterProgram(const Filter &filter)
+    : m_includeRemoved(filter.includeRemoved())
+{
+    m_root = compile(filter.toContactFilter());
+}
+
+bool FilterProgram::test(const QContact &contact, const QDateTime &deletedDate) const
+{
+    if (deletedDate.isValid() && !m_includeRemoved) {
+        return false;
+    }
+
+    return run(m_root, contact, deletedDate, 0);
+}
+
+bool FilterProgram::test(const QContact &contact,
+                         const QDateTime &deletedDate,
+                         const QList<PhoneNumberRecord> &phoneNumbers) const
+{
+    if (deletedDate.isValid() && !m_includeRemoved) {
+        return false;
+    }
+
+    return run(m_root, contact, deletedDate, &phoneNumbers);
+}
+
+QList<QContactDetail::DetailType> FilterProgram::detailTypes() const
+{
+    QList<QContactDetail::DetailType> types;
+    Q_FOREACH(const Instruction &inst, m_program) {
+        switch(inst.op) {
+        case OpDetailPresence:
+        case OpDetailString:
+        case OpDetailPhone:
+            if (!types.contains(inst.detailType)) {
+                types << inst.detailType;
+            }
+            break;
+        case OpEngine:
+            // the filters evaluated by the engine can read any detail
+            return QList<QContactDetail::DetailType>();
+        default:
+            break;
+        }
+    }
+
+    // the contact id is always available
+    if (types.isEmpty()) {
+        types << QContactDetail::TypeGuid;
+    }
+    return types;
+}
+
+int FilterProgram::append(const Instruction &instruction)
+{
+    m_program.append(instruction);
+    return m_program.size() - 1;
+}
+
+int FilterProgram::compile(const QContactFilter &filter)
+{
+    Instruction inst;
+    inst.op = OpFalse;
+    inst.cost = COST_CONSTANT;
+    inst.detailType = QContactDetail::TypeUndefined;
+    inst.detailField = -1;
+    inst.matchType = 0;
+    inst.caseSensitivity = Qt::CaseInsensitive;
+
+    switch(filter.type()) {
+    case QContactFilter::DefaultFilter:
+        inst.op = OpTrue;
+        break;
+
+    case QContactFilter::IdFilter:
+    {
+        const QContactIdFilter idf(filter);
+        inst.op = OpId;
+        inst.cost = COST_ID;
+        inst.ids = QSet<QContactId>::fromList(idf.ids());
+        break;
+    }
+
+    case QContactFilter::ChangeLogFilter:
+    {
+        const QContactChangeLogFilter clf(filter);
+        if (clf.eventType() == QContactChangeLogFilter::EventRemoved) {
+            inst.op = OpChangeLogRemoved;
+            inst.cost = COST_CHANGE_LOG;
+            inst.since = clf.since();
+        } else {
+            inst.op = OpEngine;
+            inst.cost = COST_ENGINE;
+            inst.filter = filter;
+        }
+        break;
+    }
+
+    case QContactFilter::ContactDetailFilter:
+    {
+        const QContactDetailFilter cdf(filter);
+        inst.detailType = cdf.detailType();
+        inst.detailField = cdf.detailField();
+        inst.matchType = cdf.matchFlags();
+        inst.caseSensitivity = (cdf.matchFlags() & QContactFilter::MatchCaseSensitive) ?
+                    Qt::CaseSensitive : Qt::CaseInsensitive;
+
+        // like Filter::test the phone match does not check if the value is valid
+        if (cdf.detailType() == QContactDetail::TypeUndefined) {
+            inst.op = OpFalse;
+        } else if (cdf.detailField() == -1) {
+            inst.op = OpDetailPresence;
+            inst.cost = COST_DETAIL_PRESENCE;
+        } else if (cdf.matchFlags() & QContactFilter::MatchPhoneNumber) {
+            inst.op = OpDetailPhone;
+            inst.cost = COST_DETAIL_PHONE;
+            inst.phone = PhoneNumberRecord(cdf.value().toString());
+        } else if (!cdf.value().isValid()) {
+            inst.op = OpDetailPresence;
+            inst.cost = COST_DETAIL_PRESENCE;
+        } else if (cdf.matchFlags() & (QContactFilter::MatchEndsWith |
+                                       QContactFilter::MatchStartsWith |
+                                       QContactFilter::MatchContains |
+                                       QContactFilter::MatchFixedString)) {
+            inst.op = OpDetailString;
+            inst.cost = COST_DETAIL_STRING;
+            inst.matchType = cdf.matchFlags() & 7;
+            inst.needle = cdf.value().toString();
+        } else {
+            // variant compare
+            inst.op = OpEngine;
+            inst.cost = COST_ENGINE;
+            inst.filter = filter;
+        }
+        break;
+    }
+
+    case QContactFilter::IntersectionFilter:
+    case QContactFilter::UnionFilter:
+    {
+        const QList<QContactFilter> terms = (filter.type() == QContactFilter::UnionFilter) ?
+                    QContactUnionFilter(filter).filters() :
+                    QContactIntersectionFilter(filter).filters();
+        if (terms.isEmpty()) {
+            inst.op = OpFalse;
+            break;
+        }
+
+        inst.op = (filter.type() == QContactFilter::UnionFilter) ? OpUnion : OpIntersection;
+        Q_FOREACH(const QContactFilter &f, terms) {
+            int child = compile(f);
+            inst.children << child;
+            inst.cost += m_program[child].cost;
+        }
+
+        // run the cheap terms first
+        std::stable_sort(inst.children.begin(), inst.children.end(), [this] (int a, int b) {
+            return m_program[a].cost < m_program[b].cost;
+        });
+        break;
+    }
+
+    case QContactFilter::InvalidFilter:
+        inst.op = OpFalse;
+        break;
+
+    default:
+        inst.op = OpEngine;
+        inst.cost = COST_ENGINE;
+        inst.filter = filter;
+        break;
+    }
+
+    return append(inst);
+}
+
+bool FilterProgram::run(int index,
+                        const QContact &contact,
+                        const QDateTime &deletedDate,
+                        const QList<PhoneNumberRecord> *phoneNumbers) const
+{
+    const Instruction &inst = m_program[index];
+
+    switch(inst.op) {
+    case OpFalse:
+        return false;
+
+    case OpTrue:
+        return true;
+
+    case OpId:
+        return inst.ids.contains(contact.id());
+
+    case OpChangeLogRemoved:
+        return (deletedDate >= inst.since);
+
+    case OpDetailPresence:
+    {
+        const QList<QContactDetail> details = contact.details(inst.detailType);
+        if (inst.detailField == -1) {
+            return !details.isEmpty();
+        }
+        Q_FOREACH(const QContactDetail &detail, details) {
+            if (detail.hasValue(inst.detailField)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    case OpDetailString:
+    {
+        Q_FOREACH(const QContactDetail &detail, contact.details(inst.detailType)) {
+            const QString value = detail.value(inst.detailField).toString();
+            switch(inst.matchType) {
+            case QContactFilter::MatchStartsWith:
+                if (value.startsWith(inst.needle, inst.caseSensitivity)) {
+                    return true;
+                }
+                break;
+            case QContactFilter::MatchEndsWith:
+                if (value.endsWith(inst.needle, inst.caseSensitivity)) {
+                    return true;
+                }
+                break;
+            case QContactFilter::MatchContains:
+                if (value.contains(inst.needle, inst.caseSensitivity)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+            }
+            if (QString::compare(value, inst.needle, inst.caseSensitivity) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    case OpDetailPhone:
+    {
+        QContactFilter::MatchFlags flags(QFlag(inst.matchType));
+        if (phoneNumbers &&
+            (inst.detailType == QContactPhoneNumber::Type) &&
+            (inst.detailField == QContactPhoneNumber::FieldNumber)) {
+            Q_FOREACH(const PhoneNumberRecord &record, *phoneNumbers) {
+                if (PhoneNumberRecord::compare(inst.phone, record, flags)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        Q_FOREACH(const QContactDetail &detail, contact.details(inst.detailType)) {
+            if (PhoneNumberRecord::compare(inst.phone, detail.value(inst.detailField).toString(), flags)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    case OpUnion:
+        Q_FOREACH(int child, inst.children) {
+            if (run(child, contact, deletedDate, phoneNumbers)) {
+                return true;
+            }
+        }
+        return false;
+
+    case OpIntersection:
+        Q_FOREACH(int child, inst.children) {
+            if (!run(child, contact, deletedDate, phoneNumbers)) {
+                return false;
+            }
+        }
+        return true;
+
+    case OpEngine:
+        return QContactManagerEngine::testFilter(inst.filter, contact);
+    }
+
+    return false;
+}
+
+}
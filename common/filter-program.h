@@ -0,0 +1,98 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_FILTER_PROGRAM_H__
+#define __GALERA_FILTER_PROGRAM_H__
+
+#include "common/filter.h"
+#include "common/phone-number-record.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include <QtContacts/QContactFilter>
+#include <QtContacts/QContactId>
+#include <QtContacts/QContact>
+
+namespace galera
+{
+
+// A galera::Filter compiled into a flat list of predicates.
+// The filter tree is translated once: detail types, fields, match flags and
+// phone number inputs are resolved ahead of time and the cheap terms of unions
+// and intersections are evaluated first.
+class FilterProgram
+{
+public:
+    FilterProgram(const Filter &filter);
+
+    bool test(const QtContacts::QContact &contact, const QDateTime &deletedDate = QDateTime()) const;
+    // phoneNumbers: records of the contact phone numbers, avoid processing them again
+    bool test(const QtContacts::QContact &contact,
+              const QDateTime &deletedDate,
+              const QList<PhoneNumberRecord> &phoneNumbers) const;
+    // detail types read by the filter, empty if the filter can read any detail
+    QList<QtContacts::QContactDetail::DetailType> detailTypes() const;
+
+private:
+    enum Operation {
+        OpFalse = 0,
+        OpTrue,
+        OpId,
+        OpChangeLogRemoved,
+        OpDetailPresence,
+        OpDetailString,
+        OpDetailPhone,
+        OpUnion,
+        OpIntersection,
+        OpEngine
+    };
+
+    struct Instruction
+    {
+        Operation op;
+        int cost;
+        QtContacts::QContactDetail::DetailType detailType;
+        int detailField;
+        int matchType;
+        Qt::CaseSensitivity caseSensitivity;
+        QString needle;
+        QDateTime since;
+        QSet<QtContacts::QContactId> ids;
+        PhoneNumberRecord phone;
+        // filters evaluated by QContactManagerEngine
+        QtContacts::QContactFilter filter;
+        QVector<int> children;
+    };
+
+    QVector<Instruction> m_program;
+    int m_root;
+    bool m_includeRemoved;
+
+    int compile(const QtContacts::QContactFilter &filter);
+    int append(const Instruction &instruction);
+    bool run(int index,
+             const QtContacts::QContact &contact,
+             const QDateTime &deletedDate,
+             const QList<PhoneNumberRecord> *phoneNumbers) const;
+};
+
+}
+
+#endif
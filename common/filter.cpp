@@ -17,6 +17,7 @@
  */
 
 #include "filter.h"
+#include "phone-number-record.h"
 
 #include <QtCore/QDataStream>
 #include <QtCore/QByteArray>
@@ -36,7 +37,6 @@
 #include <QtContacts/QContactIdFilter>
 #include <QtContacts/QContactRelationshipFilter>
 
-#include <phonenumbers/phonenumberutil.h>
 
 using namespace QtContacts;
 
@@ -109,7 +109,8 @@ bool Filter::testFilter(const QContactFilter& filter,
 
             if (cdf.matchFlags() & QContactFilter::MatchPhoneNumber) {
                 /* Doing phone number filtering.  We hand roll an implementation here, backends will obviously want to override this. */
-                QString input = cdf.value().toString();
+                /* The input is processed once, the values are only parsed if necessary */
+                PhoneNumberRecord input(cdf.value().toString());
 
                 /* Look at every detail in the set of details and compare */
                 for (int j = 0; j < details.count(); j++) {
@@ -173,50 +174,9 @@ bool Filter::testFilter(const QContactFilter& filter,
     return false;
 }
 
-bool Filter::comparePhoneNumbers(const QString &input, const QString &value, QContactFilter::MatchFlags flags)
+bool Filter::comparePhoneNumbers(const PhoneNumberRecord &input, const QString &value, QContactFilter::MatchFlags flags)
 {
-    static i18n::phonenumbers::PhoneNumberUtil *phonenumberUtil = i18n::phonenumbers::PhoneNumberUtil::GetInstance();
-
-    std::string stdPreprocessedInput(input.toStdString());
-    std::string stdProcessedValue(value.toStdString());
-
-    phonenumberUtil->NormalizeDiallableCharsOnly(&stdPreprocessedInput);
-    phonenumberUtil->NormalizeDiallableCharsOnly(&stdProcessedValue);
-
-    QString preprocessedInput = QString::fromStdString(stdPreprocessedInput);
-    QString preprocessedValue = QString::fromStdString(stdProcessedValue);
-
-    // if one of they does not contain digits return false
-    if (preprocessedInput.isEmpty() || preprocessedValue.isEmpty()) {
-        return false;
-    }
-
-    bool mc = flags & QContactFilter::MatchContains;
-    bool msw = flags & QContactFilter::MatchStartsWith;
-    bool mew = flags & QContactFilter::MatchEndsWith;
-    bool me = flags & QContactFilter::MatchExactly;
-    if (!mc && !msw && !mew && !me &&
-        ((preprocessedInput.length() < 6) || (preprocessedValue.length() < 6))) {
-        return preprocessedInput == preprocessedValue;
-    }
-
-    if (mc) {
-        return preprocessedValue.contains(preprocessedInput);
-    } else if (msw) {
-        return preprocessedValue.startsWith(preprocessedInput);
-    } else if (mew) {
-        return preprocessedValue.endsWith(preprocessedInput);
-    } else {
-        i18n::phonenumbers::PhoneNumberUtil::MatchType match =
-                phonenumberUtil->IsNumberMatchWithTwoStrings(input.toStdString(),
-                                                             value.toStdString());
-        if (me) {
-            return match == i18n::phonenumbers::PhoneNumberUtil::EXACT_MATCH;
-        } else {
-            return match > i18n::phonenumbers::PhoneNumberUtil::NO_MATCH;
-        }
-    }
-    return false;
+    return PhoneNumberRecord::compare(input, value, flags);
 }
 
 bool Filter::checkIsValid(const QList<QContactFilter> filters) const
@@ -306,6 +266,29 @@ QStringList Filter::idsToFilter() const
     return idsToFilter(m_filter);
 }
 
+QString Filter::textToFilter(bool *startsWith) const
+{
+    bool onlyStartsWith = true;
+    QString text = textToFilter(m_filter, &onlyStartsWith);
+    if (startsWith) {
+        *startsWith = onlyStartsWith;
+    }
+    return text;
+}
+
+QList<QContactDetail::DetailType> Filter::textDetailTypes()
+{
+    // used by the filter threads, the static initialization runs only once
+    static const QList<QContactDetail::DetailType> types =
+            QList<QContactDetail::DetailType>() << QContactDetail::TypeDisplayLabel
+                                                << QContactDetail::TypeName
+                                                << QContactDetail::TypeNickname
+                                                << QContactDetail::TypeEmailAddress
+                                                << QContactDetail::TypeOrganization
+                                                << QContactDetail::TypeExtendedDetail;
+    return types;
+}
+
 QString Filter::phoneNumberToFilter(const QtContacts::QContactFilter &filter)
 {
     switch (filter.type()) {
@@ -389,6 +372,65 @@ QStringList Filter::idsToFilter(const QtContacts::QContactFilter &filter)
     return result;
 }
 
+// return the text used by the filter if all contacts matching it contain the text on one of the
+// textDetailTypes(), "startsWith" will be false if the text can be found on the middle of the value
+QString Filter::textToFilter(const QtContacts::QContactFilter &filter, bool *startsWith)
+{
+    switch (filter.type()) {
+    case QContactFilter::ContactDetailFilter:
+    {
+        const QContactDetailFilter cdf(filter);
+        if ((cdf.detailField() == -1) ||
+            (cdf.matchFlags() & (QContactFilter::MatchPhoneNumber | QContactFilter::MatchKeypadCollation)) ||
+            !textDetailTypes().contains(cdf.detailType())) {
+            break;
+        }
+
+        QString text = cdf.value().toString();
+        if (!text.isEmpty()) {
+            // MatchExactly is 0 and MatchStartsWith is 2
+            int matchType = cdf.matchFlags() & 0x07;
+            if ((matchType != QContactFilter::MatchExactly) &&
+                (matchType != QContactFilter::MatchStartsWith)) {
+                *startsWith = false;
+            }
+        }
+        return text;
+    }
+    case QContactFilter::UnionFilter:
+    {
+        // all terms need to look for the same text
+        const QContactUnionFilter uf(filter);
+        QString text;
+        Q_FOREACH(const QContactFilter &f, uf.filters()) {
+            QString textToFilter = Filter::textToFilter(f, startsWith);
+            if (textToFilter.isEmpty() ||
+                (!text.isEmpty() && (text.compare(textToFilter, Qt::CaseInsensitive) != 0))) {
+                return QString();
+            }
+            text = textToFilter;
+        }
+        return text;
+    }
+    case QContactFilter::IntersectionFilter:
+    {
+        const QContactIntersectionFilter cif(filter);
+        Q_FOREACH(const QContactFilter &f, cif.filters()) {
+            bool termStartsWith = true;
+            QString textToFilter = Filter::textToFilter(f, &termStartsWith);
+            if (!textToFilter.isEmpty()) {
+                *startsWith = termStartsWith;
+                return textToFilter;
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return QString();
+}
+
 QString Filter::toString(const QtContacts::QContactFilter &filter)
 {
     QByteArray filterArray;
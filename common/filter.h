@@ -21,11 +21,14 @@
 
 #include <QtCore/QDateTime>
 #include <QtContacts/QContactFilter>
+#include <QtContacts/QContactDetail>
 #include <QtContacts/QContact>
 
 
 namespace galera
 {
+class PhoneNumberRecord;
+
 class Filter
 {
 public:
@@ -43,6 +46,9 @@ public:
     // optimization by index
     QString phoneNumberToFilter() const;
     QStringList idsToFilter() const;
+    QString textToFilter(bool *startsWith = 0) const;
+
+    static QList<QtContacts::QContactDetail::DetailType> textDetailTypes();
 
 private:
     QtContacts::QContactFilter m_filter;
@@ -55,6 +61,7 @@ private:
 
     static QString phoneNumberToFilter(const QtContacts::QContactFilter &filter);
     static QStringList idsToFilter(const QtContacts::QContactFilter &filter);
+    static QString textToFilter(const QtContacts::QContactFilter &filter, bool *startsWith);
     static QString toString(const QtContacts::QContactFilter &filter);
     static QtContacts::QContactFilter buildFilter(const QString &filter);
 
@@ -66,7 +73,7 @@ private:
     static QtContacts::QContactFilter parseUnionFilter(const QtContacts::QContactFilter &filter);
     static QtContacts::QContactFilter parseIntersectionFilter(const QtContacts::QContactFilter &filter);
     static bool testFilter(const QtContacts::QContactFilter& filter, const QtContacts::QContact &contact, const QDateTime &deletedDate);
-    static bool comparePhoneNumbers(const QString &phoneNumberA, const QString &phoneNumberB, QtContacts::QContactFilter::MatchFlags flags);
+    static bool comparePhoneNumbers(const PhoneNumberRecord &input, const QString &value, QtContacts::QContactFilter::MatchFlags flags);
 };
 
 }
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "phone-number-record.h"
+
+#include <QtContacts/QContactPhoneNumber>
+
+#include <phonenumbers/phonenumber.pb.h>
+#include <phonenumbers/phonenumberutil.h>
+#include <phonenumbers/region_code.h>
+
+using namespace QtContacts;
+using namespace i18n::phonenumbers;
+
+namespace galera
+{
+
+PhoneNumberRecord::PhoneNumberRecord()
+    : m_parseError(PhoneNumberUtil::NOT_A_NUMBER)
+{
+}
+
+PhoneNumberRecord::PhoneNumberRecord(const QString &number)
+    : m_number(number),
+      m_stdNumber(number.toStdString()),
+      m_parseError(PhoneNumberUtil::NOT_A_NUMBER)
+{
+    static PhoneNumberUtil *phonenumberUtil = PhoneNumberUtil::GetInstance();
+
+    m_diallable = diallableChars(m_stdNumber);
+    if (m_diallable.isEmpty()) {
+        return;
+    }
+
+    PhoneNumber *parsed = new PhoneNumber;
+    m_parseError = phonenumberUtil->Parse(m_stdNumber, RegionCode::GetUnknown(), parsed);
+    if (m_parseError == PhoneNumberUtil::NO_PARSING_ERROR) {
+        std::string e164;
+        phonenumberUtil->Format(*parsed, PhoneNumberUtil::E164, &e164);
+        m_e164 = QString::fromStdString(e164);
+        m_parsed = QSharedPointer<PhoneNumber>(parsed);
+    } else {
+        delete parsed;
+    }
+}
+
+QString PhoneNumberRecord::number() const
+{
+    return m_number;
+}
+
+QString PhoneNumberRecord::diallable() const
+{
+    return m_diallable;
+}
+
+QString PhoneNumberRecord::e164() const
+{
+    return m_e164;
+}
+
+bool PhoneNumberRecord::isParsed() const
+{
+    return !m_parsed.isNull();
+}
+
+QList<PhoneNumberRecord> PhoneNumberRecord::fromContact(const QContact &contact)
+{
+    QList<PhoneNumberRecord> records;
+    Q_FOREACH(const QContactPhoneNumber &phone, contact.details<QContactPhoneNumber>()) {
+        records << PhoneNumberRecord(phone.number());
+    }
+    return records;
+}
+
+bool PhoneNumberRecord::compare(const PhoneNumberRecord &input,
+                                const PhoneNumberRecord &value,
+                                QContactFilter::MatchFlags flags)
+{
+    bool result = false;
+    if (compareDiallable(input.m_diallable, value.m_diallable, flags, &result)) {
+        return result;
+    }
+    return checkNumberMatch(isNumberMatch(input, value), flags);
+}
+
+bool PhoneNumberRecord::compare(const PhoneNumberRecord &input,
+                                const QString &value,
+                                QContactFilter::MatchFlags flags)
+{
+    // the value is only parsed if the numbers need to be matched
+    bool result = false;
+    if (compareDiallable(input.m_diallable, diallableChars(value.toStdString()), flags, &result)) {
+        return result;
+    }
+    return checkNumberMatch(isNumberMatch(input, PhoneNumberRecord(value)), flags);
+}
+
+QString PhoneNumberRecord::diallableChars(const std::string &number)
+{
+    static PhoneNumberUtil *phonenumberUtil = PhoneNumberUtil::GetInstance();
+
+    std::string diallable(number);
+    phonenumberUtil->NormalizeDiallableCharsOnly(&diallable);
+    return QString::fromStdString(diallable);
+}
+
+bool PhoneNumberRecord::compareDiallable(const QString &input,
+                                         const QString &value,
+                                         QContactFilter::MatchFlags flags,
+                                         bool *result)
+{
+    // if one of they does not contain digits return false
+    if (input.isEmpty() || value.isEmpty()) {
+        *result = false;
+        return true;
+    }
+
+    bool mc = flags & QContactFilter::MatchContains;
+    bool msw = flags & QContactFilter::MatchStartsWith;
+    bool mew = flags & QContactFilter::MatchEndsWith;
+    bool me = flags & QContactFilter::MatchExactly;
+    if (!mc && !msw && !mew && !me &&
+        ((input.length() < 6) || (value.length() < 6))) {
+        *result = (input == value);
+        return true;
+    }
+
+    if (mc) {
+        *result = value.contains(input);
+    } else if (msw) {
+        *result = value.startsWith(input);
+    } else if (mew) {
+        *result = value.endsWith(input);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool PhoneNumberRecord::checkNumberMatch(int match, QContactFilter::MatchFlags flags)
+{
+    if (flags & QContactFilter::MatchExactly) {
+        return match == PhoneNumberUtil::EXACT_MATCH;
+    } else {
+        return match > PhoneNumberUtil::NO_MATCH;
+    }
+}
+
+// Same result as PhoneNumberUtil::IsNumberMatchWithTwoStrings but reusing the
+// numbers already parsed, the strings are only parsed again when neither of them
+// contains the country code
+int PhoneNumberRecord::isNumberMatch(const PhoneNumberRecord &input, const PhoneNumberRecord &value)
+{
+    static PhoneNumberUtil *phonenumberUtil = PhoneNumberUtil::GetInstance();
+
+    if (input.m_parsed) {
+        if (value.m_parsed) {
+            return phonenumberUtil->IsNumberMatch(*input.m_parsed, *value.m_parsed);
+        }
+        return phonenumberUtil->IsNumberMatchWithOneString(*input.m_parsed, value.m_stdNumber);
+    }
+
+    if (input.m_parseError != PhoneNumberUtil::INVALID_COUNTRY_CODE_ERROR) {
+        return PhoneNumberUtil::INVALID_NUMBER;
+    }
+
+    if (value.m_parsed) {
+        return phonenumberUtil->IsNumberMatchWithOneString(*value.m_parsed, input.m_stdNumber);
+    }
+
+    return phonenumberUtil->IsNumberMatchWithTwoStrings(input.m_stdNumber, value.m_stdNumber);
+}
+
+}
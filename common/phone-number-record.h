@@ -0,0 +1,84 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_PHONE_NUMBER_RECORD_H__
+#define __GALERA_PHONE_NUMBER_RECORD_H__
+
+#include <QtCore/QString>
+#include <QtCore/QList>
+#include <QtCore/QSharedPointer>
+
+#include <QtContacts/QContact>
+#include <QtContacts/QContactFilter>
+
+#include <string>
+
+namespace i18n {
+namespace phonenumbers {
+class PhoneNumber;
+}
+}
+
+namespace galera
+{
+
+// A phone number processed once: diallable chars, the parsed number
+// (only available when the number contains the country code) and its E.164 form
+class PhoneNumberRecord
+{
+public:
+    PhoneNumberRecord();
+    PhoneNumberRecord(const QString &number);
+
+    QString number() const;
+    QString diallable() const;
+    QString e164() const;
+    bool isParsed() const;
+
+    static QList<PhoneNumberRecord> fromContact(const QtContacts::QContact &contact);
+
+    // compare two phone numbers following the rules of QContactFilter::MatchPhoneNumber
+    static bool compare(const PhoneNumberRecord &input,
+                        const PhoneNumberRecord &value,
+                        QtContacts::QContactFilter::MatchFlags flags);
+    // same as above, the value is only parsed if the match flags need it
+    static bool compare(const PhoneNumberRecord &input,
+                        const QString &value,
+                        QtContacts::QContactFilter::MatchFlags flags);
+
+private:
+    QString m_number;
+    std::string m_stdNumber;
+    QString m_diallable;
+    QString m_e164;
+    int m_parseError;
+    QSharedPointer<i18n::phonenumbers::PhoneNumber> m_parsed;
+
+    static QString diallableChars(const std::string &number);
+    // returns false if the result depends on the parsed numbers
+    static bool compareDiallable(const QString &input,
+                                 const QString &value,
+                                 QtContacts::QContactFilter::MatchFlags flags,
+                                 bool *result);
+    static bool checkNumberMatch(int match, QtContacts::QContactFilter::MatchFlags flags);
+    static int isNumberMatch(const PhoneNumberRecord &input, const PhoneNumberRecord &value);
+};
+
+}
+
+#endif
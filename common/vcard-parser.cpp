@@ -17,6 +17,8 @@
  */
 
 #include "vcard-parser.h"
+#include "vcard-reader.h"
+#include "vcard-writer.h"
 
 #include <QtCore/QMimeDatabase>
 #include <QtCore/QMimeType>
@@ -296,8 +298,11 @@ const QMap<QtContacts::QContactDetail::DetailType, QString> VCardParser::Preferr
 VCardParser::VCardParser(QObject *parent)
     : QObject(parent),
       m_versitWriter(0),
-      m_versitReader(0)
+      m_versitReader(0),
+      m_fastExport(true),
+      m_fastImport(true)
 {
+    qRegisterMetaType<QList<QtContacts::QContact> >();
     m_exporterHandler = new ContactExporterDetailHandler;
     m_importerHandler = new ContactImporterPropertyHandler;
 }
@@ -332,8 +337,33 @@ void VCardParser::vcardToContact(const QStringList &vcardList)
     }
     m_vcardsResult.clear();
     m_contactsResult.clear();
+    m_importPositions.clear();
+    m_importVcards.clear();
+
+    // read the vcards directly when possible, only the vcards with
+    // properties not supported by VCardReader go through QtVersit
+    QStringList versitVcards;
+    VCardReader reader;
+    for(int i = 0; i < vcardList.size(); i++) {
+        QContact contact;
+        if (m_fastImport && reader.read(vcardList[i], &contact)) {
+            m_contactsResult << contact;
+        } else {
+            m_contactsResult << QContact();
+            m_importPositions << i;
+            versitVcards << vcardList[i];
+            m_importVcards << vcardList[i];
+        }
+    }
 
-    QString vcards = vcardList.join("\r\n");
+    if (versitVcards.isEmpty()) {
+        // keep the signal asynchronous like the QVersitReader result
+        QMetaObject::invokeMethod(this, "contactsParsed", Qt::QueuedConnection,
+                                  Q_ARG(QList<QtContacts::QContact>, m_contactsResult));
+        return;
+    }
+
+    QString vcards = versitVcards.join("\r\n");
     m_versitReader = new QVersitReader(vcards.toUtf8());
     connect(m_versitReader,
             SIGNAL(resultsAvailable()),
@@ -376,6 +406,16 @@ void VCardParser::waitForFinished()
     QCoreApplication::sendPostedEvents(this);
 }
 
+void VCardParser::setFastExportEnabled(bool enabled)
+{
+    m_fastExport = enabled;
+}
+
+void VCardParser::setFastImportEnabled(bool enabled)
+{
+    m_fastImport = enabled;
+}
+
 QStringList VCardParser::vcardResult() const
 {
     return m_vcardsResult;
@@ -417,18 +457,47 @@ void VCardParser::onReaderStateChanged(QVersitReader::State state)
 
         QVersitContactImporter contactImporter;
         contactImporter.setPropertyHandler(m_importerHandler);
-        if (!contactImporter.importDocuments(documents)) {
-            qWarning() << "Fail to import contacts";
-            return;
+        bool imported = contactImporter.importDocuments(documents);
+
+        QList<QContact> contacts = contactImporter.contacts();
+        if (imported && (contacts.size() == m_importPositions.size())) {
+            for(int i = 0; i < m_importPositions.size(); i++) {
+                m_contactsResult[m_importPositions[i]] = contacts[i];
+            }
+        } else {
+            // some vcards are invalid, import them one by one to keep each contact
+            // on the position of its vcard, the invalid ones stay empty
+            qWarning() << "Fail to import some contacts";
+            for(int i = 0; i < m_importPositions.size(); i++) {
+                m_contactsResult[m_importPositions[i]] = importVcard(m_importVcards[i]);
+            }
         }
-        m_contactsResult = contactImporter.contacts();
-        Q_EMIT contactsParsed(contactImporter.contacts());
+        Q_EMIT contactsParsed(m_contactsResult);
 
         delete m_versitReader;
         m_versitReader = 0;
     }
 }
 
+QContact VCardParser::importVcard(const QString &vcard) const
+{
+    QVersitReader reader(vcard.toUtf8());
+    reader.startReading();
+    reader.waitForFinished();
+
+    QList<QVersitDocument> documents = reader.results();
+    if (documents.isEmpty()) {
+        return QContact();
+    }
+
+    QVersitContactImporter contactImporter;
+    contactImporter.setPropertyHandler(m_importerHandler);
+    if (!contactImporter.importDocuments(documents.mid(0, 1))) {
+        return QContact();
+    }
+    return contactImporter.contacts().value(0, QContact());
+}
+
 void VCardParser::contactToVcard(QList<QtContacts::QContact> contacts)
 {
     if (m_versitWriter) {
@@ -437,11 +506,36 @@ void VCardParser::contactToVcard(QList<QtContacts::QContact> contacts)
     }
     m_vcardsResult.clear();
     m_contactsResult.clear();
+    m_vcardData.clear();
+    m_exportPositions.clear();
+
+    // write the contacts directly when possible, only the contacts with
+    // details not supported by VCardWriter go through QtVersit
+    QList<QContact> versitContacts;
+    VCardWriter writer;
+    for(int i = 0; i < contacts.size(); i++) {
+        const QContact &contact = contacts[i];
+        if (m_fastExport && VCardWriter::canWrite(contact)) {
+            m_vcardsResult << writer.write(contact);
+        } else {
+            m_vcardsResult << QString();
+            m_exportPositions << i;
+            versitContacts << contact;
+        }
+    }
+
+    if (versitContacts.isEmpty()) {
+        // keep the signal asynchronous like the QVersitWriter result
+        QMetaObject::invokeMethod(this, "vcardParsed", Qt::QueuedConnection,
+                                  Q_ARG(QStringList, m_vcardsResult));
+        return;
+    }
 
     QVersitContactExporter exporter;
     exporter.setDetailHandler(m_exporterHandler);
-    if (!exporter.exportContacts(contacts, QVersitDocument::VCard30Type)) {
+    if (!exporter.exportContacts(versitContacts, QVersitDocument::VCard30Type)) {
         qWarning() << "Fail to export contacts" << exporter.errors();
+        m_vcardsResult.clear();
         return;
     }
 
@@ -456,8 +550,10 @@ void VCardParser::onWriterStateChanged(QVersitWriter::State state)
 {
     if (state == QVersitWriter::FinishedState) {
         QStringList vcards = VCardParser::splitVcards(m_vcardData);
-        m_vcardsResult = vcards;
-        Q_EMIT vcardParsed(vcards);
+        for(int i = 0; i < m_exportPositions.size(); i++) {
+            m_vcardsResult[m_exportPositions[i]] = vcards.value(i);
+        }
+        Q_EMIT vcardParsed(m_vcardsResult);
         delete m_versitWriter;
         m_versitWriter = 0;
     }
@@ -48,6 +48,11 @@ public:
     void cancel();
     void waitForFinished();
 
+    // when disabled all contacts are exported with QtVersit instead of VCardWriter
+    void setFastExportEnabled(bool enabled);
+    // when disabled all vcards are imported with QtVersit instead of VCardReader
+    void setFastImportEnabled(bool enabled);
+
     QStringList vcardResult() const;
     QList<QtContacts::QContact> contactsResult() const;
 
@@ -84,8 +89,16 @@ private:
     QtVersit::QVersitContactImporterPropertyHandlerV2 *m_importerHandler;
 
     QByteArray m_vcardData;
+    QList<int> m_exportPositions;
+    QList<int> m_importPositions;
+    QStringList m_importVcards;
+    bool m_fastExport;
+    bool m_fastImport;
     QStringList m_vcardsResult;
     QList<QtContacts::QContact> m_contactsResult;
+
+    // empty contact if the vcard is invalid
+    QtContacts::QContact importVcard(const QString &vcard) const;
 };
 
 }
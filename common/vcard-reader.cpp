@@ -0,0 +1,531 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vcard-reader.h"
+#include "vcard-parser.h"
+
+#include <QtCore/QHash>
+
+#include <QtContacts/QContactId>
+#include <QtContacts/QContactGuid>
+#include <QtContacts/QContactName>
+#include <QtContacts/QContactDisplayLabel>
+#include <QtContacts/QContactNickname>
+#include <QtContacts/QContactBirthday>
+#include <QtContacts/QContactTimestamp>
+#include <QtContacts/QContactFavorite>
+#include <QtContacts/QContactNote>
+#include <QtContacts/QContactEmailAddress>
+#include <QtContacts/QContactPhoneNumber>
+#include <QtContacts/QContactSyncTarget>
+#include <QtContacts/QContactExtendedDetail>
+#include <QtContacts/QContactManagerEngine>
+
+using namespace QtContacts;
+
+namespace
+{
+    // same values used by QVersitContactImporter
+    QHash<QString, int> contextValues()
+    {
+        QHash<QString, int> map;
+        map[QStringLiteral("HOME")] = QContactDetail::ContextHome;
+        map[QStringLiteral("WORK")] = QContactDetail::ContextWork;
+        return map;
+    }
+
+    QHash<QString, int> phoneSubTypeValues()
+    {
+        QHash<QString, int> map;
+        map[QStringLiteral("ISDN")] = QContactPhoneNumber::SubTypeLandline;
+        map[QStringLiteral("CELL")] = QContactPhoneNumber::SubTypeMobile;
+        map[QStringLiteral("FAX")] = QContactPhoneNumber::SubTypeFax;
+        map[QStringLiteral("PAGER")] = QContactPhoneNumber::SubTypePager;
+        map[QStringLiteral("VOICE")] = QContactPhoneNumber::SubTypeVoice;
+        map[QStringLiteral("MODEM")] = QContactPhoneNumber::SubTypeModem;
+        map[QStringLiteral("VIDEO")] = QContactPhoneNumber::SubTypeVideo;
+        map[QStringLiteral("CAR")] = QContactPhoneNumber::SubTypeCar;
+        map[QStringLiteral("BBS")] = QContactPhoneNumber::SubTypeBulletinBoardSystem;
+        map[QStringLiteral("MSG")] = QContactPhoneNumber::SubTypeMessagingCapable;
+        return map;
+    }
+
+    // extended details exported by the service
+    QStringList extendedDetailNames()
+    {
+        return QStringList() << QStringLiteral("X-CREATED-AT")
+                             << QStringLiteral("X-REMOTE-ID")
+                             << QStringLiteral("X-GOOGLE-ETAG")
+                             << QStringLiteral("X-GROUP-ID")
+                             << QStringLiteral("X-DELETED-AT")
+                             << QStringLiteral("X-AVATAR-REV");
+    }
+
+    const QHash<QString, int> ContextValues = contextValues();
+    const QHash<QString, int> PhoneSubTypeValues = phoneSubTypeValues();
+    const QStringList ExtendedDetailNames = extendedDetailNames();
+}
+
+namespace galera
+{
+
+VCardReader::VCardReader()
+    : m_readOnly(false),
+      m_irremovable(false),
+      m_pref(false)
+{
+}
+
+bool VCardReader::read(const QString &vcard, QContact *contact)
+{
+    int pos = 0;
+    QString value;
+
+    if (!nextLine(vcard, &pos) || !parseLine(&value) ||
+        (m_name != QStringLiteral("BEGIN")) || (value != QStringLiteral("VCARD"))) {
+        return false;
+    }
+    if (!nextLine(vcard, &pos) || !parseLine(&value) ||
+        (m_name != QStringLiteral("VERSION")) || (value != QStringLiteral("3.0"))) {
+        return false;
+    }
+
+    QContact result;
+    QContactDetail preferredPhone;
+    QString createdAt;
+    bool finished = false;
+
+    while (nextLine(vcard, &pos)) {
+        if (finished || !parseLine(&value)) {
+            return false;
+        }
+
+        if (m_name == QStringLiteral("END")) {
+            if (value != QStringLiteral("VCARD")) {
+                return false;
+            }
+            finished = true;
+        } else if (!readProperty(value, &result, &preferredPhone, &createdAt)) {
+            return false;
+        }
+    }
+
+    if (!finished) {
+        return false;
+    }
+
+    // same as ContactImporterPropertyHandler::documentProcessed
+    if (!preferredPhone.isEmpty()) {
+        result.setPreferredDetail(VCardParser::PreferredActionNames[QContactDetail::TypePhoneNumber],
+                                  preferredPhone);
+    }
+
+    if (result.id().isNull() &&
+        !result.detail<QContactGuid>().isEmpty()) {
+        QContactId id = QContactId::fromString(
+                    QString("qtcontacts:galera::%1").arg(result.detail<QContactGuid>().guid()));
+        result.setId(id);
+    }
+
+    QContactTimestamp timestamp = result.detail<QContactTimestamp>();
+    QDateTime created = timestamp.lastModified();
+    if (!createdAt.isNull()) {
+        created = QDateTime::fromString(createdAt, Qt::ISODate).toUTC();
+    }
+    timestamp.setCreated(created);
+    result.saveDetail(&timestamp);
+
+    *contact = result;
+    return true;
+}
+
+// Read the next line unfolding the continuation lines, the lines can end with "\r\n" or "\n"
+bool VCardReader::nextLine(const QString &vcard, int *pos)
+{
+    m_line.resize(0);
+
+    const int size = vcard.size();
+    while (*pos < size) {
+        int end = vcard.indexOf(QLatin1Char('\n'), *pos);
+        if (end == -1) {
+            end = size;
+        }
+        int length = end - *pos;
+        if ((length > 0) && (vcard.at(end - 1) == QLatin1Char('\r'))) {
+            length--;
+        }
+
+        if (m_line.isEmpty()) {
+            m_line.append(vcard.constData() + *pos, length);
+        } else if (length > 0) {
+            // skip the space used to fold the line
+            m_line.append(vcard.constData() + *pos + 1, length - 1);
+        }
+        *pos = end + 1;
+
+        bool folded = (*pos < size) &&
+                      ((vcard.at(*pos) == QLatin1Char(' ')) || (vcard.at(*pos) == QLatin1Char('\t')));
+        if (!folded && !m_line.isEmpty()) {
+            return true;
+        }
+    }
+
+    return !m_line.isEmpty();
+}
+
+// Split the current line in name, parameters and value; only the parameters
+// written by VCardWriter are accepted
+bool VCardReader::parseLine(QString *value)
+{
+    m_name.clear();
+    m_types.clear();
+    m_pid.clear();
+    m_readOnly = false;
+    m_irremovable = false;
+    m_pref = false;
+
+    int colon = m_line.indexOf(QLatin1Char(':'));
+    if (colon <= 0) {
+        return false;
+    }
+
+    const QString head = m_line.left(colon);
+    if (head.contains(QLatin1Char('"'))) {
+        return false;
+    }
+
+    *value = m_line.mid(colon + 1);
+    // QtVersit does not unescape quoted values
+    if (value->startsWith(QLatin1Char('"'))) {
+        return false;
+    }
+
+    QStringList params = head.split(QLatin1Char(';'));
+    m_name = params.takeFirst();
+    // property groups
+    if (m_name.contains(QLatin1Char('.'))) {
+        return false;
+    }
+
+    Q_FOREACH(const QString &param, params) {
+        int equal = param.indexOf(QLatin1Char('='));
+        if (equal <= 0) {
+            return false;
+        }
+
+        const QString paramName = param.left(equal);
+        const QString paramValue = param.mid(equal + 1);
+        if (paramName == QStringLiteral("TYPE")) {
+            m_types << paramValue.split(QLatin1Char(','));
+        } else if (paramName == VCardParser::PidFieldName) {
+            m_pid = paramValue;
+        } else if (paramName == VCardParser::ReadOnlyFieldName) {
+            m_readOnly = (paramValue == QStringLiteral("YES"));
+        } else if (paramName == VCardParser::IrremovableFieldName) {
+            m_irremovable = (paramValue == QStringLiteral("YES"));
+        } else if (paramName == VCardParser::PrefParamName) {
+            m_pref = true;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VCardReader::readProperty(const QString &value,
+                               QContact *contact,
+                               QContactDetail *preferredPhone,
+                               QString *createdAt)
+{
+    if (value.isEmpty()) {
+        return false;
+    }
+
+    // only email and phone numbers have types
+    if (!m_types.isEmpty() &&
+        (m_name != QStringLiteral("EMAIL")) && (m_name != QStringLiteral("TEL"))) {
+        return false;
+    }
+
+    if (m_name == QStringLiteral("UID")) {
+        QContactGuid guid;
+        guid.setGuid(unescape(value));
+        saveDetail(contact, &guid);
+    } else if (m_name == QStringLiteral("N")) {
+        QStringList values = splitValue(value, QLatin1Char(';'));
+        if (values.size() > 5) {
+            return false;
+        }
+
+        QContactName name;
+        if (!values.value(0).isEmpty()) {
+            name.setLastName(values.value(0));
+        }
+        if (!values.value(1).isEmpty()) {
+            name.setFirstName(values.value(1));
+        }
+        if (!values.value(2).isEmpty()) {
+            name.setMiddleName(values.value(2));
+        }
+        if (!values.value(3).isEmpty()) {
+            name.setPrefix(values.value(3));
+        }
+        if (!values.value(4).isEmpty()) {
+            name.setSuffix(values.value(4));
+        }
+        if (name.isEmpty()) {
+            return false;
+        }
+        saveDetail(contact, &name);
+    } else if (m_name == QStringLiteral("FN")) {
+        QContactDisplayLabel label;
+        label.setLabel(unescape(value));
+        saveDetail(contact, &label);
+    } else if (m_name == QStringLiteral("NICKNAME")) {
+        QStringList values = splitValue(value, QLatin1Char(','));
+        if (values.size() != 1) {
+            return false;
+        }
+        QContactNickname nickname;
+        nickname.setNickname(values.first());
+        saveDetail(contact, &nickname);
+    } else if (m_name == QStringLiteral("BDAY")) {
+        QDateTime dateTime;
+        bool justDate = false;
+        if (!parseDateTime(value, &dateTime, &justDate)) {
+            return false;
+        }
+        QContactBirthday birthday;
+        if (justDate) {
+            birthday.setDate(dateTime.date());
+        } else {
+            birthday.setDateTime(dateTime);
+        }
+        saveDetail(contact, &birthday);
+    } else if (m_name == QStringLiteral("REV")) {
+        QDateTime dateTime;
+        bool justDate = false;
+        if (!parseDateTime(value, &dateTime, &justDate) || justDate) {
+            return false;
+        }
+        QContactTimestamp timestamp;
+        timestamp.setLastModified(dateTime);
+        saveDetail(contact, &timestamp);
+    } else if (m_name == QStringLiteral("NOTE")) {
+        QContactNote note;
+        note.setNote(unescape(value));
+        saveDetail(contact, &note);
+    } else if (m_name == QStringLiteral("EMAIL")) {
+        QList<int> contexts;
+        if (!parseTypes(&contexts, 0)) {
+            return false;
+        }
+        QContactEmailAddress email;
+        email.setEmailAddress(unescape(value));
+        if (!contexts.isEmpty()) {
+            email.setContexts(contexts);
+        }
+        saveDetail(contact, &email);
+    } else if (m_name == QStringLiteral("TEL")) {
+        QList<int> contexts;
+        QList<int> subTypes;
+        if (!parseTypes(&contexts, &subTypes)) {
+            return false;
+        }
+        // QtVersit keeps a empty subtype list on the preferred phone
+        if (m_pref && subTypes.isEmpty()) {
+            return false;
+        }
+        QContactPhoneNumber phone;
+        phone.setNumber(unescape(value));
+        if (!contexts.isEmpty()) {
+            phone.setContexts(contexts);
+        }
+        if (!subTypes.isEmpty()) {
+            phone.setSubTypes(subTypes);
+        }
+        saveDetail(contact, &phone);
+        if (m_pref) {
+            *preferredPhone = phone;
+        }
+    } else if (m_name == VCardParser::PidMapFieldName) {
+        if (value.contains(QLatin1Char('\\'))) {
+            return false;
+        }
+        QStringList values = value.split(QLatin1Char(';'));
+        QContactSyncTarget target;
+        target.setSyncTarget(values.value(0));
+        if (values.size() > 1) {
+            target.setValue(QContactSyncTarget::FieldSyncTarget + 1, values.value(1));
+        }
+        if (values.size() > 2) {
+            target.setValue(QContactSyncTarget::FieldSyncTarget + 2, values.value(2));
+        }
+        saveDetail(contact, &target);
+    } else if (m_name == QStringLiteral("X-QTPROJECT-FAVORITE")) {
+        QStringList values = value.split(QLatin1Char(';'));
+        if (values.size() != 2) {
+            return false;
+        }
+        QContactFavorite favorite;
+        favorite.setFavorite(values[0] == QStringLiteral("true"));
+        favorite.setIndex(values[1].toInt());
+        saveDetail(contact, &favorite);
+    } else if (ExtendedDetailNames.contains(m_name)) {
+        if (value.contains(QLatin1Char('\\'))) {
+            return false;
+        }
+        QContactExtendedDetail xDet;
+        xDet.setName(m_name);
+        xDet.setData(value);
+        saveDetail(contact, &xDet);
+        if ((m_name == QStringLiteral("X-CREATED-AT")) && createdAt->isNull()) {
+            *createdAt = value;
+        }
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+// same as ContactImporterPropertyHandler::propertyProcessed
+void VCardReader::saveDetail(QContact *contact, QContactDetail *detail) const
+{
+    if (!m_pid.isEmpty()) {
+        detail->setDetailUri(m_pid);
+    }
+
+    QContactDetail::AccessConstraints access;
+    if (m_readOnly) {
+        access |= QContactDetail::ReadOnly;
+    }
+    if (m_irremovable) {
+        access |= QContactDetail::Irremovable;
+    }
+    if (access) {
+        QContactManagerEngine::setDetailAccessConstraints(detail, access);
+    }
+
+    contact->saveDetail(detail);
+}
+
+bool VCardReader::parseTypes(QList<int> *contexts, QList<int> *subTypes) const
+{
+    Q_FOREACH(const QString &type, m_types) {
+        if (ContextValues.contains(type)) {
+            *contexts << ContextValues.value(type);
+        } else if (subTypes && PhoneSubTypeValues.contains(type)) {
+            *subTypes << PhoneSubTypeValues.value(type);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// accepts the ISO 8601 extended formats: "yyyy-MM-dd", "yyyy-MM-ddThh:mm:ss" and "yyyy-MM-ddThh:mm:ssZ"
+bool VCardReader::parseDateTime(const QString &value, QDateTime *dateTime, bool *justDate)
+{
+    static const QString dateFormat(QStringLiteral("yyyy-MM-dd"));
+    static const QString dateTimeFormat(QStringLiteral("yyyy-MM-ddThh:mm:ss"));
+
+    if (value.length() == dateFormat.length()) {
+        QDate date = QDate::fromString(value, dateFormat);
+        if (!date.isValid()) {
+            return false;
+        }
+        *dateTime = QDateTime(date);
+        *justDate = true;
+        return true;
+    }
+
+    bool utc = (value.length() == (dateTimeFormat.length() + 1)) &&
+               value.endsWith(QLatin1Char('Z'));
+    if ((value.length() != dateTimeFormat.length()) && !utc) {
+        return false;
+    }
+
+    *dateTime = QDateTime::fromString(value.left(dateTimeFormat.length()), dateTimeFormat);
+    if (!dateTime->isValid()) {
+        return false;
+    }
+    if (utc) {
+        dateTime->setTimeSpec(Qt::UTC);
+    }
+    *justDate = false;
+    return true;
+}
+
+// split the value on the separators not escaped and unescape each part
+QStringList VCardReader::splitValue(const QString &value, QChar separator)
+{
+    QStringList result;
+    int start = 0;
+    for(int i = 0; i < value.length(); i++) {
+        if (value.at(i) == QLatin1Char('\\')) {
+            i++;
+        } else if (value.at(i) == separator) {
+            result << unescape(value.mid(start, i - start));
+            start = i + 1;
+        }
+    }
+    result << unescape(value.mid(start));
+    return result;
+}
+
+QString VCardReader::unescape(const QString &value)
+{
+    int i = value.indexOf(QLatin1Char('\\'));
+    if (i == -1) {
+        return value;
+    }
+
+    QString result;
+    result.reserve(value.length());
+    result.append(value.constData(), i);
+    for(; i < value.length(); i++) {
+        const QChar c = value.at(i);
+        if ((c != QLatin1Char('\\')) || ((i + 1) == value.length())) {
+            result.append(c);
+            continue;
+        }
+
+        const QChar next = value.at(++i);
+        switch(next.unicode()) {
+        case 'n':
+        case 'N':
+            result.append(QLatin1Char('\n'));
+            break;
+        case ';':
+        case ',':
+        case ':':
+        case '\\':
+            result.append(next);
+            break;
+        default:
+            result.append(c);
+            result.append(next);
+            break;
+        }
+    }
+    return result;
+}
+
+}
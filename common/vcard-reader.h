@@ -0,0 +1,69 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_VCARD_READER_H__
+#define __GALERA_VCARD_READER_H__
+
+#include <QtCore/QString>
+#include <QtCore/QDateTime>
+#include <QtCore/QStringList>
+
+#include <QtContacts/QContact>
+#include <QtContacts/QContactDetail>
+
+namespace galera
+{
+
+// vCard 3.0 decoder for the properties written by VCardWriter.
+// Creates the same contact as QVersitReader + QVersitContactImporter with the
+// VCardParser importer handler, parsing the vcard on the calling thread without
+// creating QVersitDocuments. Returns false for vcards using anything else
+// (other properties, groups, encodings...), these must be imported with QtVersit.
+class VCardReader
+{
+public:
+    VCardReader();
+
+    bool read(const QString &vcard, QtContacts::QContact *contact);
+
+private:
+    QString m_line;
+    QString m_name;
+    QStringList m_types;
+    QString m_pid;
+    bool m_readOnly;
+    bool m_irremovable;
+    bool m_pref;
+
+    bool nextLine(const QString &vcard, int *pos);
+    bool parseLine(QString *value);
+    bool readProperty(const QString &value,
+                      QtContacts::QContact *contact,
+                      QtContacts::QContactDetail *preferredPhone,
+                      QString *createdAt);
+    void saveDetail(QtContacts::QContact *contact, QtContacts::QContactDetail *detail) const;
+    bool parseTypes(QList<int> *contexts, QList<int> *subTypes) const;
+
+    static bool parseDateTime(const QString &value, QDateTime *dateTime, bool *justDate);
+    static QStringList splitValue(const QString &value, QChar separator);
+    static QString unescape(const QString &value);
+};
+
+}
+
+#endif
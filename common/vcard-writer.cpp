@@ -0,0 +1,562 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vcard-writer.h"
+#include "vcard-parser.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMap>
+#include <QtCore/QUrl>
+
+#include <QtContacts/QContactGuid>
+#include <QtContacts/QContactName>
+#include <QtContacts/QContactDisplayLabel>
+#include <QtContacts/QContactNickname>
+#include <QtContacts/QContactBirthday>
+#include <QtContacts/QContactTimestamp>
+#include <QtContacts/QContactFavorite>
+#include <QtContacts/QContactNote>
+#include <QtContacts/QContactEmailAddress>
+#include <QtContacts/QContactPhoneNumber>
+#include <QtContacts/QContactAddress>
+#include <QtContacts/QContactAvatar>
+#include <QtContacts/QContactTag>
+#include <QtContacts/QContactSyncTarget>
+#include <QtContacts/QContactExtendedDetail>
+
+// same line length used by QVersitWriter
+#define VCARD_MAX_LINE_LENGTH   76
+
+using namespace QtContacts;
+
+namespace
+{
+    // same values used by QVersitContactExporter
+    QMap<int, QString> contextNames()
+    {
+        QMap<int, QString> map;
+        map[QContactDetail::ContextHome] = QStringLiteral("HOME");
+        map[QContactDetail::ContextWork] = QStringLiteral("WORK");
+        return map;
+    }
+
+    QMap<int, QString> phoneSubTypeNames()
+    {
+        QMap<int, QString> map;
+        map[QContactPhoneNumber::SubTypeLandline] = QStringLiteral("ISDN");
+        map[QContactPhoneNumber::SubTypeMobile] = QStringLiteral("CELL");
+        map[QContactPhoneNumber::SubTypeFax] = QStringLiteral("FAX");
+        map[QContactPhoneNumber::SubTypePager] = QStringLiteral("PAGER");
+        map[QContactPhoneNumber::SubTypeVoice] = QStringLiteral("VOICE");
+        map[QContactPhoneNumber::SubTypeModem] = QStringLiteral("MODEM");
+        map[QContactPhoneNumber::SubTypeVideo] = QStringLiteral("VIDEO");
+        map[QContactPhoneNumber::SubTypeCar] = QStringLiteral("CAR");
+        map[QContactPhoneNumber::SubTypeBulletinBoardSystem] = QStringLiteral("BBS");
+        map[QContactPhoneNumber::SubTypeMessagingCapable] = QStringLiteral("MSG");
+        return map;
+    }
+
+    QMap<int, QString> addressSubTypeNames()
+    {
+        QMap<int, QString> map;
+        map[QContactAddress::SubTypeDomestic] = QStringLiteral("DOM");
+        map[QContactAddress::SubTypeInternational] = QStringLiteral("INTL");
+        map[QContactAddress::SubTypePostal] = QStringLiteral("POSTAL");
+        map[QContactAddress::SubTypeParcel] = QStringLiteral("PARCEL");
+        return map;
+    }
+
+    // image types set by QVersitDefaultResourceHandler from the file extension
+    QMap<QString, QString> imageTypeNames()
+    {
+        QMap<QString, QString> map;
+        map[QStringLiteral("jpeg")] = QStringLiteral("JPEG");
+        map[QStringLiteral("jpg")] = QStringLiteral("JPEG");
+        map[QStringLiteral("png")] = QStringLiteral("PNG");
+        map[QStringLiteral("gif")] = QStringLiteral("GIF");
+        return map;
+    }
+
+    const QMap<int, QString> ContextNames = contextNames();
+    const QMap<int, QString> PhoneSubTypeNames = phoneSubTypeNames();
+    const QMap<int, QString> AddressSubTypeNames = addressSubTypeNames();
+    const QMap<QString, QString> ImageTypeNames = imageTypeNames();
+
+    // QVersitContactExporter keeps the remote avatar urls, the other ones are read as files
+    bool isRemoteUrl(const QUrl &url)
+    {
+        return (!url.scheme().isEmpty() &&
+                !url.host().isEmpty() &&
+                (url.scheme() != QStringLiteral("file")));
+    }
+
+    QString imageFileExtension(const QString &fileName)
+    {
+        return fileName.split(QLatin1Char('.')).last().toLower();
+    }
+
+    // parameter values are written without escaping
+    bool isSafeParameterValue(const QString &value)
+    {
+        Q_FOREACH(const QChar &c, value) {
+            switch(c.unicode()) {
+            case ';':
+            case ',':
+            case ':':
+            case '\\':
+            case '"':
+            case '\r':
+            case '\n':
+                return false;
+            default:
+                break;
+            }
+        }
+        return true;
+    }
+}
+
+namespace galera
+{
+
+VCardWriter::VCardWriter()
+    : m_lineLength(0)
+{
+}
+
+bool VCardWriter::canWrite(const QContact &contact)
+{
+    // QtVersit merges the nicknames and the tags in a single property
+    if (contact.details(QContactName::Type).isEmpty() ||
+        (contact.details(QContactNickname::Type).size() > 1) ||
+        (contact.details(QContactTag::Type).size() > 1)) {
+        return false;
+    }
+
+    Q_FOREACH(const QContactDetail &detail, contact.details()) {
+        if (!canWriteDetail(detail)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VCardWriter::canWriteDetail(const QContactDetail &detail)
+{
+    if (!isSafeParameterValue(detail.detailUri())) {
+        return false;
+    }
+
+    switch(detail.type()) {
+    case QContactDetail::TypeGuid:
+    case QContactDetail::TypeName:
+    case QContactDetail::TypeDisplayLabel:
+    case QContactDetail::TypeTimestamp:
+    case QContactDetail::TypeFavorite:
+    case QContactDetail::TypeNote:
+    case QContactDetail::TypeSyncTarget:
+        break;
+    case QContactDetail::TypeNickname:
+        if (static_cast<const QContactNickname&>(detail).nickname().isEmpty()) {
+            return false;
+        }
+        break;
+    case QContactDetail::TypeBirthday:
+        if (detail.hasValue(QContactBirthday::FieldCalendarType)) {
+            return false;
+        }
+        break;
+    case QContactDetail::TypeExtendedDetail:
+        if (static_cast<const QContactExtendedDetail&>(detail).name().isEmpty()) {
+            return false;
+        }
+        break;
+    case QContactDetail::TypeTag:
+        if (static_cast<const QContactTag&>(detail).tag().isEmpty()) {
+            return false;
+        }
+        break;
+    case QContactDetail::TypeAvatar:
+    {
+        // the image type of local files is guessed from a few known extensions
+        const QUrl url = static_cast<const QContactAvatar&>(detail).imageUrl();
+        const QString fileName = url.toLocalFile();
+        if (!isRemoteUrl(url) && !fileName.isEmpty() &&
+            !ImageTypeNames.contains(imageFileExtension(fileName))) {
+            return false;
+        }
+        break;
+    }
+    case QContactDetail::TypeEmailAddress:
+    case QContactDetail::TypePhoneNumber:
+    case QContactDetail::TypeAddress:
+    {
+        Q_FOREACH(int context, detail.contexts()) {
+            if (!ContextNames.contains(context)) {
+                return false;
+            }
+        }
+        if (detail.type() == QContactDetail::TypePhoneNumber) {
+            Q_FOREACH(int subType, static_cast<const QContactPhoneNumber&>(detail).subTypes()) {
+                if (!PhoneSubTypeNames.contains(subType)) {
+                    return false;
+                }
+            }
+        } else if (detail.type() == QContactDetail::TypeAddress) {
+            Q_FOREACH(int subType, static_cast<const QContactAddress&>(detail).subTypes()) {
+                if (!AddressSubTypeNames.contains(subType)) {
+                    return false;
+                }
+            }
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+    return true;
+}
+
+QString VCardWriter::write(const QContact &contact)
+{
+    // keep the buffer capacity between contacts
+    m_buffer.resize(0);
+    m_lineLength = 0;
+
+    writeProperty(QStringLiteral("BEGIN"), Parameters(), QStringLiteral("VCARD"));
+    writeProperty(QStringLiteral("VERSION"), Parameters(), QStringLiteral("3.0"));
+
+    Q_FOREACH(const QContactDetail &detail, contact.details()) {
+        writeDetail(contact, detail);
+    }
+
+    // translate contact id to uid vcard
+    if (!contact.id().isNull() &&
+        contact.details<QContactGuid>().isEmpty()) {
+        writeProperty(QStringLiteral("UID"), Parameters(),
+                      contact.id().toString().split("::").last());
+    }
+
+    writeProperty(QStringLiteral("END"), Parameters(), QStringLiteral("VCARD"));
+
+    return QString(m_buffer.constData(), m_buffer.size());
+}
+
+void VCardWriter::writeDetail(const QContact &contact, const QContactDetail &detail)
+{
+    switch(detail.type()) {
+    case QContactDetail::TypeGuid:
+        writeProperty(QStringLiteral("UID"),
+                      detailParameters(detail),
+                      static_cast<const QContactGuid&>(detail).guid());
+        break;
+    case QContactDetail::TypeName:
+    {
+        const QContactName &name = static_cast<const QContactName&>(detail);
+        writeCompoundProperty(QStringLiteral("N"),
+                              detailParameters(detail),
+                              QStringList() << name.lastName()
+                                            << name.firstName()
+                                            << name.middleName()
+                                            << name.prefix()
+                                            << name.suffix());
+        break;
+    }
+    case QContactDetail::TypeDisplayLabel:
+        writeProperty(QStringLiteral("FN"),
+                      detailParameters(detail),
+                      static_cast<const QContactDisplayLabel&>(detail).label());
+        break;
+    case QContactDetail::TypeNickname:
+        writeProperty(QStringLiteral("NICKNAME"),
+                      detailParameters(detail),
+                      static_cast<const QContactNickname&>(detail).nickname());
+        break;
+    case QContactDetail::TypeBirthday:
+    {
+        QVariant birthday = detail.value(QContactBirthday::FieldBirthday);
+        if (birthday.type() == QVariant::Date) {
+            writeProperty(QStringLiteral("BDAY"),
+                          detailParameters(detail),
+                          birthday.toDate().toString(Qt::ISODate));
+        } else if (birthday.type() == QVariant::DateTime) {
+            writeProperty(QStringLiteral("BDAY"),
+                          detailParameters(detail),
+                          birthday.toDateTime().toString(Qt::ISODate));
+        }
+        break;
+    }
+    case QContactDetail::TypeTimestamp:
+    {
+        const QContactTimestamp &timestamp = static_cast<const QContactTimestamp&>(detail);
+        QDateTime rev = timestamp.lastModified();
+        if (rev.toString(Qt::ISODate).isEmpty()) {
+            rev = timestamp.created();
+        }
+        QString value = rev.toString(Qt::ISODate);
+        if (value.isEmpty()) {
+            break;
+        }
+        if ((rev.timeSpec() == Qt::UTC) && !value.endsWith(QLatin1Char('Z'), Qt::CaseInsensitive)) {
+            value += QLatin1Char('Z');
+        }
+        writeProperty(QStringLiteral("REV"), detailParameters(detail), value);
+        break;
+    }
+    case QContactDetail::TypeFavorite:
+    {
+        const QContactFavorite &favorite = static_cast<const QContactFavorite&>(detail);
+        writeCompoundProperty(QStringLiteral("X-QTPROJECT-FAVORITE"),
+                              detailParameters(detail),
+                              QStringList() << (favorite.isFavorite() ? QStringLiteral("true") : QStringLiteral("false"))
+                                            << QString::number(favorite.index()));
+        break;
+    }
+    case QContactDetail::TypeNote:
+        writeProperty(QStringLiteral("NOTE"),
+                      detailParameters(detail),
+                      static_cast<const QContactNote&>(detail).note());
+        break;
+    case QContactDetail::TypeEmailAddress:
+    {
+        Parameters params = detailParameters(detail);
+        QStringList types = typeParameters(detail, QList<int>());
+        if (!types.isEmpty()) {
+            params.prepend(qMakePair(QStringLiteral("TYPE"), types));
+        }
+        writeProperty(QStringLiteral("EMAIL"),
+                      params,
+                      static_cast<const QContactEmailAddress&>(detail).emailAddress());
+        break;
+    }
+    case QContactDetail::TypePhoneNumber:
+    {
+        const QContactPhoneNumber &phone = static_cast<const QContactPhoneNumber&>(detail);
+        Parameters params = detailParameters(detail);
+        QStringList types = typeParameters(detail, phone.subTypes());
+        if (!types.isEmpty()) {
+            params.prepend(qMakePair(QStringLiteral("TYPE"), types));
+        }
+        QString prefName = VCardParser::PreferredActionNames[QContactDetail::TypePhoneNumber];
+        if (contact.preferredDetail(prefName) == detail) {
+            params << qMakePair(VCardParser::PrefParamName, QStringList() << QStringLiteral("1"));
+        }
+        writeProperty(QStringLiteral("TEL"), params, phone.number());
+        break;
+    }
+    case QContactDetail::TypeAddress:
+    {
+        const QContactAddress &address = static_cast<const QContactAddress&>(detail);
+        Parameters params = detailParameters(detail);
+        QStringList types = typeParameters(detail, address.subTypes());
+        if (!types.isEmpty()) {
+            params.prepend(qMakePair(QStringLiteral("TYPE"), types));
+        }
+        // QtVersit leaves the extended address field empty
+        writeCompoundProperty(QStringLiteral("ADR"),
+                              params,
+                              QStringList() << address.postOfficeBox()
+                                            << QString()
+                                            << address.street()
+                                            << address.locality()
+                                            << address.region()
+                                            << address.postcode()
+                                            << address.country());
+        break;
+    }
+    case QContactDetail::TypeTag:
+        writeProperty(QStringLiteral("CATEGORIES"),
+                      detailParameters(detail),
+                      static_cast<const QContactTag&>(detail).tag());
+        break;
+    case QContactDetail::TypeAvatar:
+    {
+        const QUrl url = static_cast<const QContactAvatar&>(detail).imageUrl();
+        Parameters params = detailParameters(detail);
+        if (isRemoteUrl(url)) {
+            // the value parameter is added by QVersitContactExporter and by the VCardParser handler
+            params << qMakePair(QStringLiteral("VALUE"), QStringList() << QStringLiteral("URL")
+                                                                      << QStringLiteral("URL"));
+        } else {
+            // QtVersit skips the files that can not be read, the VCardParser handler
+            // replaces the file contents by the url but keeps the image type
+            const QString fileName = url.toLocalFile();
+            QFileInfo info(fileName);
+            if (fileName.isEmpty() || !info.isFile() || !info.isReadable() || (info.size() == 0)) {
+                break;
+            }
+            params << qMakePair(QStringLiteral("TYPE"),
+                                QStringList() << ImageTypeNames.value(imageFileExtension(fileName)));
+            params << qMakePair(QStringLiteral("VALUE"), QStringList() << QStringLiteral("URL"));
+        }
+        writeProperty(QStringLiteral("PHOTO"), params, url.toString(QUrl::RemoveUserInfo));
+        break;
+    }
+    case QContactDetail::TypeSyncTarget:
+    {
+        const QContactSyncTarget &syncTarget = static_cast<const QContactSyncTarget&>(detail);
+        writeCompoundProperty(VCardParser::PidMapFieldName,
+                              detailParameters(detail),
+                              QStringList() << syncTarget.syncTarget()
+                                            << syncTarget.value(QContactSyncTarget::FieldSyncTarget + 1).toString()
+                                            << syncTarget.value(QContactSyncTarget::FieldSyncTarget + 2).toString());
+        break;
+    }
+    case QContactDetail::TypeExtendedDetail:
+        writeProperty(detail.value(QContactExtendedDetail::FieldName).toString(),
+                      detailParameters(detail),
+                      detail.value(QContactExtendedDetail::FieldData).toString());
+        break;
+    default:
+        break;
+    }
+}
+
+VCardWriter::Parameters VCardWriter::detailParameters(const QContactDetail &detail)
+{
+    Parameters params;
+    if (!detail.detailUri().isEmpty()) {
+        params << qMakePair(VCardParser::PidFieldName, QStringList() << detail.detailUri());
+    }
+    if (detail.accessConstraints().testFlag(QContactDetail::ReadOnly)) {
+        params << qMakePair(VCardParser::ReadOnlyFieldName, QStringList() << QStringLiteral("YES"));
+    }
+    if (detail.accessConstraints().testFlag(QContactDetail::Irremovable)) {
+        params << qMakePair(VCardParser::IrremovableFieldName, QStringList() << QStringLiteral("YES"));
+    }
+    return params;
+}
+
+// QVersitProperty keeps the parameters on a QMultiHash, the values of the same
+// parameter are written starting from the last inserted one
+QStringList VCardWriter::typeParameters(const QContactDetail &detail, const QList<int> &subTypes)
+{
+    const QMap<int, QString> &subTypeNames = (detail.type() == QContactDetail::TypeAddress) ?
+                AddressSubTypeNames : PhoneSubTypeNames;
+    QStringList types;
+    for(int i = subTypes.size() - 1; i >= 0; i--) {
+        types << subTypeNames.value(subTypes[i]);
+    }
+    QList<int> contexts = detail.contexts();
+    for(int i = contexts.size() - 1; i >= 0; i--) {
+        types << ContextNames.value(contexts[i]);
+    }
+    return types;
+}
+
+void VCardWriter::writeProperty(const QString &name, const Parameters &parameters, const QString &value)
+{
+    writeLine(name, parameters, escape(value));
+}
+
+void VCardWriter::writeCompoundProperty(const QString &name, const Parameters &parameters, const QStringList &values)
+{
+    QStringList escaped;
+    escaped.reserve(values.size());
+    Q_FOREACH(const QString &value, values) {
+        escaped << escape(value);
+    }
+    writeLine(name, parameters, escaped.join(QStringLiteral(";")));
+}
+
+void VCardWriter::writeLine(const QString &name, const Parameters &parameters, const QString &escapedValue)
+{
+    writeString(name);
+    for(int i = 0; i < parameters.size(); i++) {
+        writeString(QStringLiteral(";") + parameters[i].first + QStringLiteral("="));
+        writeString(parameters[i].second.join(QStringLiteral(",")));
+    }
+    writeString(QStringLiteral(":"));
+    writeString(escapedValue);
+    writeCrlf();
+}
+
+// Fold the lines like QVersitWriter does: each line has at most VCARD_MAX_LINE_LENGTH
+// chars, continuation lines start with a space and surrogate pairs are not split
+void VCardWriter::writeString(const QString &value)
+{
+    int spaceRemaining = VCARD_MAX_LINE_LENGTH - m_lineLength;
+    int written = 0;
+    while (spaceRemaining < (value.length() - written)) {
+        int count = spaceRemaining;
+        if ((count > 0) && value.at(written + count - 1).isHighSurrogate()) {
+            count--;
+        }
+        m_buffer.append(value.constData() + written, count);
+        written += count;
+        writeCrlf();
+        m_buffer.append(QLatin1Char(' '));
+        m_lineLength = 1;
+        spaceRemaining = VCARD_MAX_LINE_LENGTH - m_lineLength;
+    }
+    m_buffer.append(value.constData() + written, value.length() - written);
+    m_lineLength += value.length() - written;
+}
+
+void VCardWriter::writeCrlf()
+{
+    m_buffer.append(QLatin1String("\r\n"));
+    m_lineLength = 0;
+}
+
+// vCard 3.0 escaping: backslash, semicolon and comma are escaped and line breaks
+// are replaced by "\n"
+QString VCardWriter::escape(const QString &value)
+{
+    int i = 0;
+    for(; i < value.length(); i++) {
+        ushort c = value.at(i).unicode();
+        if ((c == ';') || (c == ',') || (c == '\\') || (c == '\r') || (c == '\n')) {
+            break;
+        }
+    }
+    if (i == value.length()) {
+        return value;
+    }
+
+    QString result;
+    result.reserve(value.length() + 8);
+    result.append(value.constData(), i);
+    for(; i < value.length(); i++) {
+        const QChar c = value.at(i);
+        switch(c.unicode()) {
+        case ';':
+        case ',':
+        case '\\':
+            result.append(QLatin1Char('\\'));
+            result.append(c);
+            break;
+        case '\r':
+            if (((i + 1) < value.length()) && (value.at(i + 1) == QLatin1Char('\n'))) {
+                i++;
+            }
+            result.append(QLatin1String("\\n"));
+            break;
+        case '\n':
+            result.append(QLatin1String("\\n"));
+            break;
+        default:
+            result.append(c);
+            break;
+        }
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_VCARD_WRITER_H__
+#define __GALERA_VCARD_WRITER_H__
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QPair>
+#include <QtCore/QList>
+
+#include <QtContacts/QContact>
+#include <QtContacts/QContactDetail>
+
+namespace galera
+{
+
+// vCard 3.0 serializer for the details exported by the service.
+// Writes the same properties, values and line folding as QVersitContactExporter +
+// QVersitWriter with the VCardParser exporter handler, but straight into a string,
+// one contact at a time. Contacts with details that are not handled here
+// (see canWrite) must be exported with QtVersit.
+class VCardWriter
+{
+public:
+    VCardWriter();
+
+    static bool canWrite(const QtContacts::QContact &contact);
+    QString write(const QtContacts::QContact &contact);
+
+private:
+    typedef QList<QPair<QString, QStringList> > Parameters;
+
+    QString m_buffer;
+    int m_lineLength;
+
+    void writeDetail(const QtContacts::QContact &contact, const QtContacts::QContactDetail &detail);
+    void writeProperty(const QString &name, const Parameters &parameters, const QString &value);
+    void writeCompoundProperty(const QString &name, const Parameters &parameters, const QStringList &values);
+    void writeLine(const QString &name, const Parameters &parameters, const QString &escapedValue);
+    void writeString(const QString &value);
+    void writeCrlf();
+
+    static bool canWriteDetail(const QtContacts::QContactDetail &detail);
+    static Parameters detailParameters(const QtContacts::QContactDetail &detail);
+    static QStringList typeParameters(const QtContacts::QContactDetail &detail,
+                                      const QList<int> &subTypes);
+    static QString escape(const QString &value);
+};
+
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include "qcontactsaverequest-data.h"
 
 #include "common/vcard-parser.h"
+#include "common/contact-codec.h"
 #include "common/filter.h"
 #include "common/fetch-hint.h"
 #include "common/sort-clause.h"
@@ -38,6 +39,7 @@
 #include <QtDBus/QDBusPendingCallWatcher>
 #include <QtDBus/QDBusPendingReply>
 #include <QtDBus/QDBusConnectionInterface>
+#include <QtDBus/QDBusUnixFileDescriptor>
 
 #include <QtContacts/QContact>
 #include <QtContacts/QContactChangeSet>
@@ -52,7 +54,10 @@
 #include <QtVersit/QVersitWriter>
 
 #define ALTERNATIVE_CPIM_SERVICE_PAGE_SIZE  "CANONICAL_PIM_SERVICE_PAGE_SIZE"
+#define ALTERNATIVE_CPIM_SERVICE_FILE_TRANSPORT "CANONICAL_PIM_SERVICE_FILE_TRANSPORT"
 #define FETCH_PAGE_SIZE                     25
+// keep each createContacts call under the D-Bus timeout
+#define CREATE_CONTACTS_CHUNK_SIZE          50
 
 using namespace QtVersit;
 using namespace QtContacts;
@@ -78,6 +83,12 @@ GaleraContactsService::GaleraContactsService(const QString &managerUri)
         m_pageSize = FETCH_PAGE_SIZE;
     }
 
+    // fetch all contacts of a view in a single file, if the connection supports unix fds
+    m_fileTransport = QDBusConnection::sessionBus().connectionCapabilities().testFlag(QDBusConnection::UnixFileDescriptorPassing);
+    if (qEnvironmentVariableIsSet(ALTERNATIVE_CPIM_SERVICE_FILE_TRANSPORT)) {
+        m_fileTransport &= (qgetenv(ALTERNATIVE_CPIM_SERVICE_FILE_TRANSPORT) != "0");
+    }
+
     m_serviceWatcher = new QDBusServiceWatcher(m_serviceName,
                                                QDBusConnection::sessionBus(),
                                                QDBusServiceWatcher::WatchForOwnerChange,
@@ -358,11 +369,18 @@ void GaleraContactsService::fetchContactsPage(QContactFetchRequestData *data)
         return;
     }
 
-    // Load contacs async
-    QDBusPendingCall pcall = data->view()->asyncCall("contactsDetails",
-                                                     data->fields(),
-                                                     data->offset(),
-                                                     m_pageSize);
+    // Load contacs async, using the binary format if the service supports it
+    QDBusPendingCall pcall;
+    if (useFileTransport(data)) {
+        // all contacts in a single call
+        pcall = data->view()->asyncCall("contactsDetailsFile", data->fields());
+    } else {
+        bool binary = (data->view()->metaObject()->indexOfMethod("contactsDetailsBinary(QStringList,int,int)") != -1);
+        pcall = data->view()->asyncCall(binary ? "contactsDetailsBinary" : "contactsDetails",
+                                        data->fields(),
+                                        data->offset(),
+                                        m_pageSize);
+    }
     if (pcall.isError()) {
         qWarning() << pcall.error().name() << pcall.error().message();
         data->finish(QContactManager::UnspecifiedError);
@@ -386,14 +404,42 @@ void GaleraContactsService::fetchContactsDone(QContactFetchRequestData *data,
         return;
     }
 
-    QDBusPendingReply<QStringList> reply = *call;
-    if (reply.isError()) {
-        qWarning() << reply.error().name() << reply.error().message();
+    if (call->isError() && (call->error().type() == QDBusError::NotSupported) && useFileTransport(data)) {
+        // the service can not create the file, use the paged fetch from now on
+        qWarning() << call->error().message();
+        m_fileTransport = false;
+        data->updateWatcher(0);
+        fetchContactsPage(data);
+    } else if (call->isError()) {
+        qWarning() << call->error().name() << call->error().message();
         data->update(QList<QContact>(),
                         QContactAbstractRequest::FinishedState,
                         QContactManager::UnspecifiedError);
         destroyRequest(data);
+    } else if (call->reply().signature() == QStringLiteral("h")) {
+        QDBusPendingReply<QDBusUnixFileDescriptor> reply = *call;
+        QList<QContact> contacts;
+        if (ContactCodec::decodeFromFile(reply.value().fileDescriptor(), &contacts)) {
+            fetchContactsPageDone(data, contacts, true);
+        } else {
+            data->update(QList<QContact>(),
+                            QContactAbstractRequest::FinishedState,
+                            QContactManager::UnspecifiedError);
+            destroyRequest(data);
+        }
+    } else if (call->reply().signature() == QStringLiteral("ay")) {
+        QDBusPendingReply<QByteArray> reply = *call;
+        QList<QContact> contacts;
+        if (ContactCodec::decode(reply.value(), &contacts)) {
+            fetchContactsPageDone(data, contacts);
+        } else {
+            data->update(QList<QContact>(),
+                            QContactAbstractRequest::FinishedState,
+                            QContactManager::UnspecifiedError);
+            destroyRequest(data);
+        }
     } else {
+        QDBusPendingReply<QStringList> reply = *call;
         const QStringList vcards = reply.value();
         if (vcards.size()) {
             VCardParser *parser = new VCardParser;
@@ -444,6 +490,25 @@ void GaleraContactsService::onVCardsParsed(QList<QContact> contacts)
         return;
     }
 
+    fetchContactsPageDone(data, contacts);
+    sender->deleteLater();
+}
+
+bool GaleraContactsService::useFileTransport(QContactFetchRequestData *data) const
+{
+    if (!m_fileTransport || (data->offset() > 0) ||
+        (data->view()->metaObject()->indexOfMethod("contactsDetailsFile(QStringList)") == -1)) {
+        return false;
+    }
+
+    // small fetches are faster using a single page
+    QContactFetchRequest *request = qobject_cast<QContactFetchRequest*>(data->request());
+    int maxCount = request ? request->fetchHint().maxCountHint() : -1;
+    return ((maxCount <= 0) || (maxCount > m_pageSize));
+}
+
+void GaleraContactsService::fetchContactsPageDone(QContactFetchRequestData *data, QList<QContact> contacts, bool lastPage)
+{
     QList<QContact>::iterator contact;
     for (contact = contacts.begin(); contact != contacts.end(); ++contact) {
         if (!contact->isEmpty()) {
@@ -453,7 +518,7 @@ void GaleraContactsService::onVCardsParsed(QList<QContact> contacts)
         }
     }
 
-    if (contacts.size() == m_pageSize) {
+    if (!lastPage && (contacts.size() == m_pageSize)) {
         data->update(contacts, QContactAbstractRequest::ActiveState);
         data->updateOffset(m_pageSize);
         data->updateWatcher(0);
@@ -462,8 +527,6 @@ void GaleraContactsService::onVCardsParsed(QList<QContact> contacts)
         data->update(contacts, QContactAbstractRequest::FinishedState);
         destroyRequest(data);
     }
-
-    sender->deleteLater();
 }
 
 void GaleraContactsService::fetchContactsGroupsContinue(QContactFetchRequestData *data,
@@ -531,7 +594,7 @@ void GaleraContactsService::saveContact(QtContacts::QContactSaveRequest *request
 /* Will create async the first group on the list, if the list is not empty,
  * otherwise it will call 'createContactsStart' to create the contacts in the list
  *
- * Due the Server limitation we will call this function for each contact
+ * Due the Server limitation we will call this function for each group
  * sequentially.
  */
 void GaleraContactsService::createGroupsStart(QContactSaveRequestData *data)
@@ -589,8 +652,8 @@ void GaleraContactsService::createGroupDone(QContactSaveRequestData *data,
 /* After handle all contacts with type = 'QContactType::TypeGroup', we need to
  * create the real contacts.
  *
- * Due the Server limitation we will call this function for each contact
- * sequentially.
+ * The contacts with the same sync target are created with 'createContacts'
+ * calls of up to CREATE_CONTACTS_CHUNK_SIZE contacts.
  */
 void GaleraContactsService::createContactsStart(QContactSaveRequestData *data)
 {
@@ -608,9 +671,9 @@ void GaleraContactsService::createContactsStart(QContactSaveRequestData *data)
     }
 
     QString syncSource;
-    QString contact = data->nextContact(&syncSource);
+    QStringList contacts = data->nextContacts(&syncSource, CREATE_CONTACTS_CHUNK_SIZE);
 
-    QDBusPendingCall pcall = m_iface->asyncCall("createContact", contact, syncSource);
+    QDBusPendingCall pcall = m_iface->asyncCall("createContacts", contacts, syncSource);
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pcall, 0);
     data->updateWatcher(watcher);
     QObject::connect(watcher, &QDBusPendingCallWatcher::finished,
@@ -619,9 +682,9 @@ void GaleraContactsService::createContactsStart(QContactSaveRequestData *data)
                      });
 }
 
-/* 'createContact' will call this function when done,
- * we need to check for errors and update the contact Id with the new Id, and
- * call 'createContactsStart' to continue with the next contact.
+/* 'createContacts' will call this function when done,
+ * we need to check for errors and update the contacts Id with the new Id, and
+ * call 'createContactsStart' to continue with the contacts of the next sync target.
   */
 void GaleraContactsService::createContactsDone(QContactSaveRequestData *data,
                                                QDBusPendingCallWatcher *call)
@@ -632,24 +695,43 @@ void GaleraContactsService::createContactsDone(QContactSaveRequestData *data,
         return;
     }
 
-    QDBusPendingReply<QString> reply = *call;
+    QDBusPendingReply<QStringList> reply = *call;
     if (reply.isError()) {
         qWarning() << reply.error().name() << reply.error().message();
-        data->notifyUpdateError(QContactManager::UnspecifiedError);
+        data->notifyCurrentContactsError(QContactManager::UnspecifiedError);
     } else {
-        const QString vcard = reply.value();
-        if (!vcard.isEmpty()) {
-            QContact contact = VCardParser::vcardToContact(vcard);
+        // the contacts that fail to be created are returned as empty vcards
+        const QStringList vcards = reply.value();
+        QStringList newVcards;
+        QList<int> newIndexes;
+        for(int i = 0; i < vcards.size(); i++) {
+            if (!vcards[i].isEmpty()) {
+                newVcards << vcards[i];
+                newIndexes << i;
+            }
+        }
+
+        QList<QContact> contacts;
+        contacts.reserve(vcards.size());
+        for(int i = 0; i < vcards.size(); i++) {
+            contacts << QContact();
+        }
+
+        QList<QContact> newContacts = VCardParser::vcardToContactSync(newVcards);
+        for(int i = 0; i < newContacts.size() && i < newIndexes.size(); i++) {
+            QContact contact = newContacts[i];
+            if (contact.isEmpty()) {
+                // invalid vcard, reported as not created
+                continue;
+            }
             QContactGuid detailId = contact.detail<QContactGuid>();
-            QContactId newId(m_managerUri, detailId.guid().toUtf8());
-            contact.setId(newId);
-            data->updateCurrentContact(contact);
-        } else {
-            data->notifyUpdateError(QContactManager::UnspecifiedError);
+            contact.setId(QContactId(m_managerUri, detailId.guid().toUtf8()));
+            contacts[newIndexes[i]] = contact;
         }
+        data->updateCurrentContacts(contacts);
     }
 
-    // go to next contact
+    // go to next contacts
     createContactsStart(data);
 }
 
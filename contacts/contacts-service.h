@@ -89,6 +89,7 @@ private:
     QDBusServiceWatcher *m_serviceWatcher;
     bool m_serviceIsReady;
     int m_pageSize;
+    bool m_fileTransport;
     bool m_showInvisibleContacts;
 
     QSharedPointer<QDBusInterface> m_iface;
@@ -111,6 +112,8 @@ private:
     void fetchContactsById(QtContacts::QContactFetchByIdRequest *request);
     void fetchContactsPage(QContactFetchRequestData *data);
     void fetchContactsDone(QContactFetchRequestData *data, QDBusPendingCallWatcher *call);
+    void fetchContactsPageDone(QContactFetchRequestData *data, QList<QtContacts::QContact> contacts, bool lastPage = false);
+    bool useFileTransport(QContactFetchRequestData *data) const;
 
     void saveContact(QtContacts::QContactSaveRequest *request);
     void createGroupsStart(QContactSaveRequestData *data);
@@ -81,15 +81,29 @@ bool QContactSaveRequestData::hasNextGroup() const
     return (m_pendingGroups.count() > 0);
 }
 
-QString QContactSaveRequestData::nextContact(QString *syncTargetName)
+/*
+ * Returns up to maxCount pending contacts with the same sync target of the
+ * first one, they can be created with a single call
+ */
+QStringList QContactSaveRequestData::nextContacts(QString *syncTargetName, int maxCount)
 {
     Q_ASSERT(m_pendingContacts.count() > 0);
-    m_currentContact = m_pendingContacts.begin();
+    QString syncTarget = m_pendingContactsSyncTarget.begin().value();
+
+    QStringList vcards;
+    m_currentContacts.clear();
+    QMap<int, QString>::const_iterator i = m_pendingContactsSyncTarget.constBegin();
+    for(; (i != m_pendingContactsSyncTarget.constEnd()) && (vcards.size() < maxCount); i++) {
+        if (i.value() == syncTarget) {
+            m_currentContacts << i.key();
+            vcards << m_pendingContacts[i.key()];
+        }
+    }
 
     if (syncTargetName) {
-        *syncTargetName = m_pendingContactsSyncTarget.begin().value();
+        *syncTargetName = syncTarget;
     }
-    return m_currentContact.value();
+    return vcards;
 }
 
 Source QContactSaveRequestData::nextGroup()
@@ -100,11 +114,34 @@ Source QContactSaveRequestData::nextGroup()
     return *m_currentGroup;
 }
 
-void QContactSaveRequestData::updateCurrentContact(const QContact &contact)
+/*
+ * Update the contacts sent on the last createContacts call, the list has the
+ * same order of the call, empty contacts were not created
+ */
+void QContactSaveRequestData::updateCurrentContacts(const QList<QContact> &contacts)
 {
-    m_contactsToCreate[m_currentContact.key()] = contact;
-    m_pendingContacts.remove(m_currentContact.key());
-    m_pendingContactsSyncTarget.remove(m_currentContact.key());
+    for(int i = 0; i < m_currentContacts.size(); i++) {
+        int key = m_currentContacts[i];
+        QContact contact = contacts.value(i);
+        if (contact.isEmpty()) {
+            m_errorMap.insert(key, QContactManager::UnspecifiedError);
+        } else {
+            m_contactsToCreate[key] = contact;
+        }
+        m_pendingContacts.remove(key);
+        m_pendingContactsSyncTarget.remove(key);
+    }
+    m_currentContacts.clear();
+}
+
+void QContactSaveRequestData::notifyCurrentContactsError(QContactManager::Error error)
+{
+    Q_FOREACH(int key, m_currentContacts) {
+        m_errorMap.insert(key, error);
+        m_pendingContacts.remove(key);
+        m_pendingContactsSyncTarget.remove(key);
+    }
+    m_currentContacts.clear();
 }
 
 void QContactSaveRequestData::updateCurrentGroup(const Source &group, const QString &managerUri)
@@ -41,10 +41,11 @@ public:
 
 
     bool hasNext() const;
-    QString nextContact(QString *syncTargetName);
+    QStringList nextContacts(QString *syncTargetName, int maxCount);
     QtContacts::QContact currentContact() const;
     QStringList allPendingContacts() const;
-    void updateCurrentContact(const QtContacts::QContact &contact);
+    void updateCurrentContacts(const QList<QtContacts::QContact> &contacts);
+    void notifyCurrentContactsError(QtContacts::QContactManager::Error error);
     void updatePendingContacts(QStringList vcards);
 
     bool hasNextGroup() const;
@@ -71,6 +72,8 @@ private:
     QMap<int, QString> m_pendingContacts;
     QMap<int, QString> m_pendingContactsSyncTarget;
     QMap<int, QString>::Iterator m_currentContact;
+    // contacts sent on the last createContacts call
+    QList<int> m_currentContacts;
 
     QMap<int, Source> m_pendingGroups;
     QMap<int, Source>::Iterator m_currentGroup;
@@ -116,6 +116,17 @@ QString AddressBookAdaptor::createContact(const QString &contact, const QString
     return QString();
 }
 
+QStringList AddressBookAdaptor::createContacts(const QStringList &contacts, const QString &source, const QDBusMessage &message)
+{
+    message.setDelayedReply(true);
+    QMetaObject::invokeMethod(m_addressBook, "createContacts",
+                              Qt::QueuedConnection,
+                              Q_ARG(const QStringList&, contacts),
+                              Q_ARG(const QString&, source),
+                              Q_ARG(const QDBusMessage&, message));
+    return QStringList();
+}
+
 QDBusObjectPath AddressBookAdaptor::query(const QString &clause, const QString &sort, int maxCount, bool showInvisible, const QStringList &sources)
 {
     View *v = m_addressBook->query(clause, sort, maxCount, showInvisible, sources);
@@ -159,6 +170,12 @@ QStringList AddressBookAdaptor::updateContacts(const QStringList &contacts, cons
 }
 
 bool AddressBookAdaptor::isReady()
+{
+    // while folks is loading the contacts the queries are answered from the snapshot
+    return m_addressBook->isReady() || m_addressBook->hasSnapshot();
+}
+
+bool AddressBookAdaptor::isLive() const
 {
     return m_addressBook->isReady();
 }
@@ -108,6 +108,11 @@ class AddressBookAdaptor: public QDBusAbstractAdaptor
 "      <arg direction=\"in\" type=\"s\" name=\"source\"/>\n"
 "      <arg direction=\"out\" type=\"s\"/>\n"
 "    </method>\n"
+"    <method name=\"createContacts\">\n"
+"      <arg direction=\"in\" type=\"as\" name=\"contacts\"/>\n"
+"      <arg direction=\"in\" type=\"s\" name=\"source\"/>\n"
+"      <arg direction=\"out\" type=\"as\"/>\n"
+"    </method>\n"
 "    <method name=\"updateContacts\">\n"
 "      <arg direction=\"out\" type=\"as\"/>\n"
 "      <arg direction=\"in\" type=\"as\" name=\"contacts\"/>\n"
@@ -136,6 +141,7 @@ public:
     virtual ~AddressBookAdaptor();
 
     void setSafeMode(bool flag);
+    bool isLive() const;
 
 public Q_SLOTS:
     SourceList availableSources(const QDBusMessage &message);
@@ -151,6 +157,7 @@ public Q_SLOTS:
     QDBusObjectPath query(const QString &clause, const QString &sort, int maxCount, bool showInvisible, const QStringList &sources);
     int removeContacts(const QStringList &contactIds, const QDBusMessage &message);
     QString createContact(const QString &contact, const QString &source, const QDBusMessage &message);
+    QStringList createContacts(const QStringList &contacts, const QString &source, const QDBusMessage &message);
     QStringList updateContacts(const QStringList &contacts, const QDBusMessage &message);
     QString linkContacts(const QStringList &contacts);
     bool unlinkContacts(const QString &parentId, const QStringList &contactsIds);
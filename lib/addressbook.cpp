@@ -21,8 +21,12 @@
 #include "addressbook-adaptor.h"
 #include "view.h"
 #include "contacts-map.h"
+#include "contacts-snapshot.h"
 #include "qindividual.h"
 #include "dirtycontact-notify.h"
+#include "eds-client-pool.h"
+#include "remove-contacts-request.h"
+#include "update-scheduler.h"
 #include "e-source-ubuntu.h"
 
 #include "common/vcard-parser.h"
@@ -47,6 +51,8 @@ namespace C {
 }
 
 #define MESSAGING_MENU_SOURCE_ID "address-book-service"
+// max number of personas created at the same time by createContacts
+#define CREATE_CONTACTS_MAX_PENDING 8
 
 using namespace QtContacts;
 
@@ -61,25 +67,34 @@ public:
     galera::AddressBook *m_addressbook;
 };
 
-class UpdateContactsData
+class CreateContactsData
 {
 public:
     QList<QContact> m_contacts;
-    QStringList m_request;
-    int m_currentIndex;
     QStringList m_result;
+    int m_nextIndex;
+    int m_pending;
+    FolksPersonaStore *m_store;
     galera::AddressBook *m_addressbook;
     QDBusMessage m_message;
 };
 
-class RemoveContactsData
+class CreateContactsItem
+{
+public:
+    CreateContactsData *m_data;
+    int m_index;
+};
+
+class UpdateContactsData
 {
 public:
+    QList<QContact> m_contacts;
     QStringList m_request;
+    int m_currentIndex;
+    QStringList m_result;
     galera::AddressBook *m_addressbook;
     QDBusMessage m_message;
-    int m_sucessCount;
-    bool m_softRemoval;
 };
 
 class CreateSourceData
@@ -138,14 +153,14 @@ ESource* create_esource_from_data(CreateSourceData &data, ESourceRegistry **regi
     ESourceAddressBook *ext = E_SOURCE_ADDRESS_BOOK(e_source_get_extension(source, E_SOURCE_EXTENSION_ADDRESS_BOOK));
     e_source_backend_set_backend_name(E_SOURCE_BACKEND(ext), "local");
 
-    *registry = e_source_registry_new_sync(NULL, &error);
-    if (error) {
-        qWarning() << "Fail to change default contact address book" << error->message;
-        g_error_free(error);
+    ESourceRegistry *r = galera::EdsClientPool::registry();
+    if (!r) {
+        qWarning() << "Fail to change default contact address book";
         g_object_unref(source);
         return 0;
     }
 
+    *registry = E_SOURCE_REGISTRY(g_object_ref(r));
     return source;
 }
 
@@ -160,8 +175,11 @@ AddressBook::AddressBook(QObject *parent)
     : QObject(parent),
       m_individualAggregator(0),
       m_contacts(0),
+      m_snapshot(0),
+      m_snapshotIsDirty(false),
       m_adaptor(0),
       m_notifyContactUpdate(0),
+      m_updateScheduler(0),
       m_edsIsLive(false),
       m_ready(false),
       m_isAboutToQuit(false),
@@ -179,6 +197,16 @@ AddressBook::AddressBook(QObject *parent)
     } else {
         m_serviceName = CPIM_SERVICE_NAME;
     }
+    if (ContactsSnapshot::isEnabled()) {
+        m_snapshot = new ContactsSnapshot;
+    }
+    m_updateScheduler = new UpdateScheduler(this);
+    connect(m_updateScheduler, &UpdateScheduler::contactsUpdated,
+            [this] (const QSet<QString> &ids) {
+        if (m_notifyContactUpdate) {
+            m_notifyContactUpdate->insertChangedContacts(ids);
+        }
+    });
     prepareUnixSignals();
     connectWithEDS();
     connect(this, SIGNAL(readyChanged()), SLOT(checkCompatibility()));
@@ -187,10 +215,8 @@ AddressBook::AddressBook(QObject *parent)
 
 AddressBook::~AddressBook()
 {
-    if (m_sourceRegistryListener) {
-        g_object_unref(m_sourceRegistryListener);
-        m_sourceRegistryListener = 0;
-    }
+    // the registry is shared, it can outlive the address book
+    disconnectFromSourceRegistry();
 
     if (m_messagingMenuMessage) {
         g_object_unref(m_messagingMenuMessage);
@@ -214,6 +240,11 @@ AddressBook::~AddressBook()
         delete m_notifyContactUpdate;
         m_notifyContactUpdate = 0;
     }
+
+    if (m_snapshot) {
+        delete m_snapshot;
+        m_snapshot = 0;
+    }
 }
 
 QString AddressBook::objectPath()
@@ -274,6 +305,12 @@ void AddressBook::unprepareFolks()
     // flusing any pending notification
     m_notifyContactUpdate->flush();
 
+    // save any change made since the service became ready
+    if (m_snapshot && m_ready && m_snapshotIsDirty) {
+        m_snapshot->save(m_contacts);
+        m_snapshotIsDirty = false;
+    }
+
     setIsReady(false);
 
     Q_FOREACH(View* view, m_views) {
@@ -281,7 +318,12 @@ void AddressBook::unprepareFolks()
     }
     m_views.clear();
 
+    if (m_snapshot) {
+        m_snapshot->release();
+    }
+
     if (m_contacts) {
+        m_updateScheduler->setContacts(0);
         delete m_contacts;
         m_contacts = 0;
     }
@@ -315,11 +357,9 @@ void AddressBook::checkCompatibility()
         return;
     }
 
-    GError *gError = NULL;
-    ESourceRegistry *r = e_source_registry_new_sync(NULL, &gError);
-    if (gError) {
-        qWarning() << "Fail to check compatibility" << gError->message;
-        g_error_free(gError);
+    ESourceRegistry *r = EdsClientPool::registry();
+    if (!r) {
+        qWarning() << "Fail to check compatibility";
         return;
     }
 
@@ -336,7 +376,6 @@ void AddressBook::checkCompatibility()
     }
 
     g_list_free_full(sources, g_object_unref);
-    g_object_unref(r);
 
     if (enableSafeMode) {
         qWarning() << "Enabling safe mode";
@@ -376,16 +415,62 @@ void AddressBook::setIsReady(bool isReady)
 {
     if (isReady != m_ready) {
         m_ready = isReady;
+        if (m_ready) {
+            syncSnapshot();
+        }
         if (m_adaptor) {
             Q_EMIT readyChanged();
         }
     }
 }
 
+void AddressBook::syncSnapshot()
+{
+    if (!m_snapshot) {
+        return;
+    }
+
+    // wait for any query running over the snapshot contacts
+    Q_FOREACH(View *view, m_views) {
+        view->waitFilter();
+    }
+
+    bool servingSnapshot = (m_snapshot->contacts() != 0) && m_notifyContactUpdate;
+    QSet<QString> addedIds;
+    QSet<QString> removedIds;
+    QSet<QString> updatedIds;
+    if (m_snapshot->sync(m_contacts, &addedIds, &removedIds, &updatedIds) && servingSnapshot) {
+        // notify clients about the difference between the snapshot and the live contacts
+        if (!removedIds.isEmpty()) {
+            m_notifyContactUpdate->insertRemovedContacts(removedIds);
+        }
+
+        if (!addedIds.isEmpty()) {
+            m_notifyContactUpdate->insertAddedContacts(addedIds);
+        }
+
+        if (!updatedIds.isEmpty()) {
+            m_notifyContactUpdate->insertChangedContacts(updatedIds);
+        }
+    }
+    Q_FOREACH(View *view, m_views) {
+        view->setContacts(m_contacts);
+    }
+    m_snapshot->release();
+    // the file still has the old contacts, it is written again on the next save
+    m_snapshotIsDirty = true;
+}
+
 void AddressBook::prepareFolks()
 {
     qDebug() << "Initialize folks";
     m_contacts = new ContactsMap;
+    m_updateScheduler->setContacts(m_contacts);
+    if (m_snapshot && m_snapshot->load() && m_adaptor) {
+        // queries can be answered with the snapshot contacts until folks is ready
+        Q_EMIT m_adaptor->readyChanged();
+    }
+
     m_individualAggregator = folks_individual_aggregator_dup();
     gboolean ready;
     g_object_get(G_OBJECT(m_individualAggregator), "is-quiescent", &ready, NULL);
@@ -438,18 +523,46 @@ void AddressBook::connectWithEDS()
         }
     }
 
-    // connect with source registry to get notifications about source change
-    GError *gError = NULL;
+    connectWithSourceRegistry();
+
+    // check if service is already registered
+    // We will try register a EDS service if its fails this mean that the service is already registered
+    m_edsIsLive = !QDBusConnection::sessionBus().registerService(evolutionServiceName);
+    if (!m_edsIsLive) {
+        // if we succeed we need to unregister it
+        QDBusConnection::sessionBus().unregisterService(evolutionServiceName);
+    }
+
+    m_edsWatcher = new QDBusServiceWatcher(evolutionServiceName,
+                                           QDBusConnection::sessionBus(),
+                                           QDBusServiceWatcher::WatchForOwnerChange,
+                                           this);
+    connect(m_edsWatcher, SIGNAL(serviceOwnerChanged(QString,QString,QString)),
+            this, SLOT(onEdsServiceOwnerChanged(QString,QString,QString)));
+
+
+    // WORKAROUND: Will ceck for EDS after the service get ready
+    connect(this, SIGNAL(readyChanged()), SLOT(checkForEds()));
+}
+
+void AddressBook::disconnectFromSourceRegistry()
+{
     if (m_sourceRegistryListener) {
+        g_signal_handlers_disconnect_by_data(m_sourceRegistryListener, this);
         g_object_unref(m_sourceRegistryListener);
         m_sourceRegistryListener = 0;
     }
-    m_sourceRegistryListener = e_source_registry_new_sync(NULL, &gError);
-    if (gError) {
-        qWarning() << "Fail to connect with source registry" << gError->message;
-        g_error_free(gError);
-        m_sourceRegistryListener = 0;
+}
+
+void AddressBook::connectWithSourceRegistry()
+{
+    // connect with source registry to get notifications about source change
+    disconnectFromSourceRegistry();
+    ESourceRegistry *registry = EdsClientPool::registry();
+    if (!registry) {
+        qWarning() << "Fail to connect with source registry";
     } else {
+        m_sourceRegistryListener = E_SOURCE_REGISTRY(g_object_ref(registry));
         g_signal_connect(m_sourceRegistryListener,
                          "source-added",
                          G_CALLBACK(AddressBook::sourceEDSChanged),
@@ -471,25 +584,6 @@ void AddressBook::connectWithEDS()
                          G_CALLBACK(AddressBook::sourceEDSChanged),
                          this);
     }
-
-    // check if service is already registered
-    // We will try register a EDS service if its fails this mean that the service is already registered
-    m_edsIsLive = !QDBusConnection::sessionBus().registerService(evolutionServiceName);
-    if (!m_edsIsLive) {
-        // if we succeed we need to unregister it
-        QDBusConnection::sessionBus().unregisterService(evolutionServiceName);
-    }
-
-    m_edsWatcher = new QDBusServiceWatcher(evolutionServiceName,
-                                           QDBusConnection::sessionBus(),
-                                           QDBusServiceWatcher::WatchForOwnerChange,
-                                           this);
-    connect(m_edsWatcher, SIGNAL(serviceOwnerChanged(QString,QString,QString)),
-            this, SLOT(onEdsServiceOwnerChanged(QString,QString,QString)));
-
-
-    // WORKAROUND: Will ceck for EDS after the service get ready
-    connect(this, SIGNAL(readyChanged()), SLOT(checkForEds()));
 }
 
 SourceList AddressBook::availableSources(const QDBusMessage &message)
@@ -603,13 +697,12 @@ void AddressBook::updateSourcesEDS(void *data)
     }
 
     if (uData->m_registry == 0) {
-        GError *gError = 0;
-        uData->m_registry = e_source_registry_new_sync(NULL, &gError);
-        if (gError) {
-            qWarning() << "Fail to create source registry" << gError->message;
-            g_error_free(gError);
+        ESourceRegistry *registry = EdsClientPool::registry();
+        if (!registry) {
+            qWarning() << "Fail to create source registry";
             goto operation_done;
         }
+        uData->m_registry = E_SOURCE_REGISTRY(g_object_ref(registry));
     }
 
     source = uData->m_toUpdate.takeFirst();
@@ -671,6 +764,9 @@ void AddressBook::updateSourceEDSDone(GObject *registry,
 
 void AddressBook::sourceEDSChanged(ESourceRegistry *registry, ESource *source, AddressBook *self)
 {
+    Q_UNUSED(registry);
+    // the source client needs to be connected again
+    EdsClientPool::invalidate(QString::fromUtf8(e_source_get_uid(source)));
     Q_EMIT self->sourcesChanged();
 }
 
@@ -1015,18 +1111,15 @@ SourceList AddressBook::availableSourcesDoneImpl(FolksBackendStore *backendStore
             // FIXME: Due a bug on Folks we can not rely on folks_persona_store_get_is_primary_store
             // see main.cpp:68
             if (strcmp(folks_backend_get_name(backend), "eds") == 0) {
-                GError *error = 0;
-                ESourceRegistry *r = e_source_registry_new_sync(NULL, &error);
-                if (error) {
-                    qWarning() << "Failt to check default source:" << error->message;
-                    g_error_free(error);
+                ESourceRegistry *r = EdsClientPool::registry();
+                if (!r) {
+                    qWarning() << "Failt to check default source";
                 } else {
                     ESource *defaultSource = e_source_registry_ref_default_address_book(r);
                     ESource *source = edsf_persona_store_get_source(EDSF_PERSONA_STORE(store));
                     displayName = QString::fromUtf8(e_source_get_display_name(source));
                     isPrimary = e_source_equal(defaultSource, source);
                     g_object_unref(defaultSource);
-                    g_object_unref(r);
 
                     if (e_source_has_extension(source, E_SOURCE_EXTENSION_UBUNTU)) {
                         ESourceUbuntu *ubuntu_ex = E_SOURCE_UBUNTU(e_source_get_extension(source, E_SOURCE_EXTENSION_UBUNTU));
@@ -1094,6 +1187,74 @@ QString AddressBook::createContact(const QString &contact, const QString &source
     return "";
 }
 
+QStringList AddressBook::createContacts(const QStringList &contacts, const QString &source, const QDBusMessage &message)
+{
+    CreateContactsData *data = new CreateContactsData;
+    data->m_message = message;
+    data->m_addressbook = this;
+    data->m_nextIndex = 0;
+    data->m_pending = 0;
+    // parse all vcards in one pass, the result keeps the vcards order
+    data->m_contacts = VCardParser::vcardToContactSync(contacts);
+    for(int i = 0; i < contacts.size(); i++) {
+        data->m_result << QString();
+        if ((i < data->m_contacts.size()) && m_contacts->valueFromVCard(contacts[i])) {
+            qWarning() << "Contact exists";
+            data->m_contacts[i] = QContact();
+        }
+    }
+    data->m_store = getFolksStore(source);
+
+    createContactsStart(data);
+    return QStringList();
+}
+
+/*
+ * Create the next contacts on the list keeping at most CREATE_CONTACTS_MAX_PENDING
+ * personas being created at the same time, the reply is sent after the last one
+ */
+void AddressBook::createContactsStart(void *data)
+{
+    CreateContactsData *createData = static_cast<CreateContactsData*>(data);
+    AddressBook *self = createData->m_addressbook;
+
+    while ((createData->m_pending < CREATE_CONTACTS_MAX_PENDING) &&
+           (createData->m_nextIndex < createData->m_contacts.size())) {
+        int index = createData->m_nextIndex++;
+        const QContact &qcontact = createData->m_contacts[index];
+        if (qcontact.isEmpty()) {
+            continue;
+        }
+
+        GHashTable *details = QIndividual::parseDetails(qcontact);
+        Q_ASSERT(details);
+        CreateContactsItem *item = new CreateContactsItem;
+        item->m_data = createData;
+        item->m_index = index;
+        createData->m_pending++;
+        folks_individual_aggregator_add_persona_from_details(self->m_individualAggregator,
+                                                             NULL, //parent
+                                                             createData->m_store,
+                                                             details,
+                                                             (GAsyncReadyCallback) createContactsDone,
+                                                             (void*) item);
+        g_hash_table_destroy(details);
+    }
+
+    if (createData->m_pending > 0) {
+        return;
+    }
+
+    if (createData->m_message.type() != QDBusMessage::InvalidMessage) {
+        QDBusMessage reply = createData->m_message.createReply(createData->m_result);
+        QDBusConnection::sessionBus().send(reply);
+    }
+    if (createData->m_store) {
+        g_object_unref(createData->m_store);
+    }
+    delete createData;
+}
+
 FolksPersonaStore * AddressBook::getFolksStore(const QString &source)
 {
     QString sourceId(source);
@@ -1101,16 +1262,15 @@ FolksPersonaStore * AddressBook::getFolksStore(const QString &source)
 
     // if source is empty we try use EDS default source
     if (source.isEmpty()) {
-        GError *gError = NULL;
-        ESourceRegistry *registry = e_source_registry_new_sync (NULL, &gError);
-        if (gError) {
+        ESourceRegistry *registry = EdsClientPool::registry();
+        if (!registry) {
             qWarning() << "Fail to find EDS default source";
         } else {
             ESource *defaultAB = e_source_registry_ref_default_address_book(registry);
             if (defaultAB) {
                 sourceId = QString::fromUtf8(e_source_get_uid(defaultAB));
+                g_object_unref(defaultAB);
             }
-            g_object_unref(registry);
         }
     }
 
@@ -1161,7 +1321,8 @@ QString AddressBook::linkContacts(const QStringList &contacts)
 
 View *AddressBook::query(const QString &clause, const QString &sort, int maxCount, bool showInvisible, const QStringList &sources)
 {
-    View *view = new View(clause, sort, maxCount, showInvisible, sources, m_ready ? m_contacts : 0, this);
+    ContactsMap *contacts = m_ready ? m_contacts : (m_snapshot ? m_snapshot->contacts() : 0);
+    View *view = new View(clause, sort, maxCount, showInvisible, sources, contacts, this);
     m_views << view;
     connect(view, SIGNAL(closed()), this, SLOT(viewClosed()));
     return view;
@@ -1174,6 +1335,18 @@ void AddressBook::viewClosed()
 
 void AddressBook::individualChanged(QIndividual *individual)
 {
+    m_snapshotIsDirty = true;
+    ContactEntry *entry = m_contacts ? m_contacts->value(individual->id()) : 0;
+    if (entry) {
+        // the map orderings and the phone and text indexes use the contact details
+        m_contacts->updatePosition(entry);
+        if (m_ready) {
+            Q_FOREACH(View *view, m_views) {
+                view->updateContact(entry);
+            }
+        }
+    }
+
     if (individual->isVisible()) {
         m_notifyContactUpdate->insertChangedContacts(QSet<QString>() << individual->id());
     }
@@ -1181,6 +1354,8 @@ void AddressBook::individualChanged(QIndividual *individual)
 
 void AddressBook::onEdsServiceOwnerChanged(const QString &name, const QString &oldOwner, const QString &newOwner)
 {
+    // the EDS objects belong to the old service
+    EdsClientPool::invalidate();
     if (newOwner.isEmpty()) {
         m_edsIsLive = false;
         m_isAboutToReload = true;
@@ -1188,6 +1363,7 @@ void AddressBook::onEdsServiceOwnerChanged(const QString &name, const QString &o
         unprepareFolks();
     } else {
         m_edsIsLive = true;
+        connectWithSourceRegistry();
     }
 }
 
@@ -1230,56 +1406,45 @@ void AddressBook::onSafeModeChanged()
 
 int AddressBook::removeContacts(const QStringList &contactIds, const QDBusMessage &message)
 {
-    RemoveContactsData *data = new RemoveContactsData;
-    data->m_addressbook = this;
-    data->m_message = message;
-    data->m_request = contactIds;
-    data->m_sucessCount = 0;
-    data->m_softRemoval = true;
-    removeContactDone(0, 0, data);
+    QList<QIndividual*> individuals;
+    Q_FOREACH(const QString &contactId, contactIds) {
+        ContactEntry *entry = m_contacts->value(contactId);
+        if (entry) {
+            individuals << entry->individual();
+        }
+    }
+    removeIndividuals(individuals, true, message);
     return 0;
 }
 
-void AddressBook::removeContactDone(FolksIndividualAggregator *individualAggregator,
-                                    GAsyncResult *result,
-                                    void *data)
+void AddressBook::removeIndividuals(const QList<QIndividual*> &individuals, bool softRemoval, const QDBusMessage &message)
 {
-    GError *error = 0;
-    RemoveContactsData *removeData = static_cast<RemoveContactsData*>(data);
-
-    if (result) {
-        folks_individual_aggregator_remove_individual_finish(individualAggregator, result, &error);
-        if (error) {
-            qWarning() << "Fail to remove contact:" << error->message;
-            g_error_free(error);
-        } else {
-            removeData->m_sucessCount++;
-        }
-    }
-
-
-    if (!removeData->m_request.isEmpty()) {
-        QString contactId = removeData->m_request.takeFirst();
-        ContactEntry *entry = removeData->m_addressbook->m_contacts->value(contactId);
-        if (entry) {
-            if (removeData->m_softRemoval && entry->individual()->markAsDeleted()) {
-                removeContactDone(individualAggregator, 0, data);
-                // since this will not be removed we need to send a removal singal
-                removeData->m_addressbook->m_notifyContactUpdate->insertRemovedContacts(QSet<QString>() << entry->individual()->id());
-            } else {
-                folks_individual_aggregator_remove_individual(individualAggregator,
-                                                              entry->individual()->individual(),
-                                                              (GAsyncReadyCallback) removeContactDone,
-                                                              data);
-            }
-        } else {
-            removeContactDone(individualAggregator, 0, data);
-        }
-    } else {
-        QDBusMessage reply = removeData->m_message.createReply(removeData->m_sucessCount);
-        QDBusConnection::sessionBus().send(reply);
-        delete removeData;
-    }
+    RemoveContactsRequest *request = new RemoveContactsRequest(m_individualAggregator, softRemoval, this);
+    connect(request, &RemoveContactsRequest::contactsMarkedAsDeleted,
+            [this] (const QStringList &ids, const QDateTime &deletedAt) {
+                if (!m_contacts) {
+                    return;
+                }
+                // since the contacts will not be removed we need to send a removal singal
+                QSet<QString> removedIds;
+                Q_FOREACH(const QString &id, ids) {
+                    ContactEntry *entry = m_contacts->value(id);
+                    if (entry) {
+                        entry->individual()->setDeletedAt(deletedAt);
+                        removedIds << id;
+                    }
+                }
+                if (!removedIds.isEmpty()) {
+                    m_notifyContactUpdate->insertRemovedContacts(removedIds);
+                }
+            });
+    connect(request, &RemoveContactsRequest::done,
+            [message] (int removedCount) {
+                if (message.type() != QDBusMessage::InvalidMessage) {
+                    QDBusConnection::sessionBus().send(message.createReply(removedCount));
+                }
+            });
+    request->start(individuals);
 }
 
 QStringList AddressBook::sortFields()
@@ -1298,109 +1463,52 @@ bool AddressBook::isReady() const
     return m_ready && m_edsIsLive;
 }
 
-QStringList AddressBook::updateContacts(const QStringList &contacts, const QDBusMessage &message)
+bool AddressBook::hasSnapshot() const
 {
-    //TODO: support multiple update contacts calls
-    Q_ASSERT(m_updateCommandPendingContacts.isEmpty());
-    if (!processUpdates()) {
-        qWarning() << "Fail to process pending updates";
-        QDBusMessage reply = m_updateCommandReplyMessage.createReply(QStringList());
-        QDBusConnection::sessionBus().send(reply);
-        return QStringList();
-    }
-
-    m_updatedIds.clear();
-    m_updateCommandReplyMessage = message;
-    m_updateCommandResult = contacts;
-    m_updateCommandPendingContacts = contacts;
+    return !m_ready && m_snapshot && m_snapshot->contacts();
+}
 
-    updateContactsDone("", "");
+QStringList AddressBook::updateContacts(const QStringList &contacts, const QDBusMessage &message)
+{
+    m_updateScheduler->updateContacts(contacts, message);
     return QStringList();
 }
 
 void AddressBook::purgeContacts(const QDateTime &since, const QString &sourceId, const QDBusMessage &message)
 {
-    RemoveContactsData *data = new RemoveContactsData;
-    data->m_addressbook = this;
-    data->m_message = message;
-    data->m_sucessCount = 0;
-    data->m_softRemoval = false;
+    // the deleted date is cached by the individual and the sync target does not
+    // need the full contact
+    QList<QContactDetail::DetailType> types;
+    types << QContactDetail::TypeSyncTarget;
 
+    QList<QIndividual*> individuals;
     Q_FOREACH(const ContactEntry *entry, m_contacts->values()) {
         if (entry->individual()->deletedAt() > since) {
-            QContactSyncTarget syncTarget = entry->individual()->contact().detail<QContactSyncTarget>();
+            QContactSyncTarget syncTarget = entry->individual()->contact(types).detail<QContactSyncTarget>();
             if (syncTarget.value(QContactSyncTarget::FieldSyncTarget + 1).toString() == sourceId) {
-                data->m_request << entry->individual()->id();
+                individuals << entry->individual();
             }
         }
     }
 
-    removeContactDone(0, 0, data);
-}
-
-void AddressBook::updateContactsDone(const QString &contactId,
-                                     const QString &error)
-{
-    int currentContactIndex = m_updateCommandResult.size() - m_updateCommandPendingContacts.size() - 1;
-
-    if (!error.isEmpty()) {
-        // update the result with the error
-        if (currentContactIndex >= 0 &&
-            currentContactIndex < m_updateCommandResult.size()) {
-            m_updateCommandResult[currentContactIndex] = error;
-        } else {
-            qWarning() << "Invalid contact changed index" << currentContactIndex <<
-                          "Contact list size" << m_updateCommandResult.size();
-        }
-    } else if (!contactId.isEmpty()){
-        // update the result with the new contact info
-        ContactEntry *entry = m_contacts->value(contactId);
-        Q_ASSERT(entry);
-        m_updatedIds << contactId;
-        QContact contact = entry->individual()->contact();
-        QString vcard = VCardParser::contactToVcard(contact);
-        if (!vcard.isEmpty()) {
-            m_updateCommandResult[currentContactIndex] = vcard;
-        } else {
-            m_updateCommandResult[currentContactIndex] = "";
-        }
-        // update contact position on map
-        m_contacts->updatePosition(entry);
-    }
-
-    if (!m_updateCommandPendingContacts.isEmpty()) {
-        QString vCard = m_updateCommandPendingContacts.takeFirst();
-        QContact newContact = VCardParser::vcardToContact(vCard);
-        ContactEntry *entry = m_contacts->value(newContact.detail<QContactGuid>().guid());
-        if (entry) {
-            entry->individual()->update(newContact, this,
-                                        SLOT(updateContactsDone(QString,QString)));
-        } else {
-            qWarning() << "Contact not found for update:" << vCard;
-            updateContactsDone("", "Contact not found!");
-        }
-    } else {
-        QDBusMessage reply = m_updateCommandReplyMessage.createReply(m_updateCommandResult);
-        QDBusConnection::sessionBus().send(reply);
-
-        // notify about the changes
-        m_notifyContactUpdate->insertChangedContacts(m_updatedIds.toSet());
-
-        // clear command data
-        m_updatedIds.clear();
-        m_updateCommandResult.clear();
-        m_updateCommandReplyMessage = QDBusMessage();
-        m_updateLock.unlock();
-    }
+    removeIndividuals(individuals, false, message);
 }
 
 QString AddressBook::removeContact(FolksIndividual *individual, bool *visible)
 {
     QString contactId = QString::fromUtf8(folks_individual_get_id(individual));
-    ContactEntry *ci = m_contacts->take(contactId);
+    ContactEntry *ci = m_contacts->value(contactId);
     if (ci) {
         *visible = ci->individual()->isVisible();
-        delete ci;
+        // while loading, views are using the snapshot contacts
+        if (m_ready) {
+            Q_FOREACH(View *view, m_views) {
+                view->removeContact(ci);
+            }
+        }
+        // the entry is deleted when the running view filters finish
+        m_contacts->remove(contactId);
+        m_updateScheduler->contactRemoved(contactId);
         return contactId;
     }
     return QString();
@@ -1416,12 +1524,22 @@ QString AddressBook::addContact(FolksIndividual *individual, bool visible)
 
         // update contact position on map
         m_contacts->updatePosition(entry);
+        if (m_ready) {
+            Q_FOREACH(View *view, m_views) {
+                view->updateContact(entry);
+            }
+        }
     } else {
         QIndividual *i = new QIndividual(individual, m_individualAggregator);
         i->addListener(this, SLOT(individualChanged(QIndividual*)));
         i->setVisible(visible);
-        m_contacts->insert(new ContactEntry(i));
-        //TODO: Notify view
+        entry = new ContactEntry(i);
+        m_contacts->insert(entry);
+        if (m_ready) {
+            Q_FOREACH(View *view, m_views) {
+                view->appendContact(entry);
+            }
+        }
     }
 
     return id;
@@ -1442,6 +1560,9 @@ void AddressBook::individualsChangedCb(FolksIndividualAggregator *individualAggr
         invisibleSources = self->m_settings.value(SETTINGS_INVISIBLE_SOURCES).toStringList();
     }
 
+    // apply all the changes to the contacts lists and indexes at once
+    self->m_contacts->beginBatch();
+
     GeeSet *removed = gee_multi_map_get_keys(changes);
     GeeIterator *iter = gee_iterable_iterator(GEE_ITERABLE(removed));
     while(gee_iterator_next(iter)) {
@@ -1502,6 +1623,12 @@ void AddressBook::individualsChangedCb(FolksIndividualAggregator *individualAggr
     g_object_unref(removed);
     g_object_unref(added);
 
+    self->m_contacts->commitBatch();
+
+    if (self->m_ready) {
+        self->m_snapshotIsDirty = true;
+    }
+
     if (!removedIds.isEmpty()) {
         self->m_notifyContactUpdate->insertRemovedContacts(removedIds);
     }
@@ -1542,21 +1669,24 @@ void AddressBook::createContactDone(FolksIndividualAggregator *individualAggrega
         qWarning() << "Failed to create individual from contact: Persona already exists";
         reply = createData->m_message.createErrorReply("Failed to create individual from contact", "Contact already exists");
     } else {
-        QIndividual::setExtendedDetails(persona,
-                                        createData->m_contact.details(QContactExtendedDetail::Type),
-                                        QDateTime::currentDateTime());
-        FolksIndividual *individual = folks_persona_get_individual(persona);
-        ContactEntry *entry = createData->m_addressbook->m_contacts->value(QString::fromUtf8(folks_individual_get_id(individual)));
-        if (entry) {
-            // We will need to reload contact due the extended details
-            entry->individual()->flush();
-            QString vcard = VCardParser::contactToVcard(entry->individual()->contact());
+        // reply after the extended details are saved
+        createData->m_addressbook->newContactVCard(persona, createData->m_contact,
+                                                   [createData] (const QString &vcard, const QString &errorMessage) {
             if (createData->m_message.type() != QDBusMessage::InvalidMessage) {
-                reply = createData->m_message.createReply(vcard);
+                QDBusMessage reply;
+                if (!errorMessage.isEmpty()) {
+                    reply = createData->m_message.createErrorReply("Failed to save the new contact", errorMessage);
+                } else if (!vcard.isEmpty()) {
+                    reply = createData->m_message.createReply(vcard);
+                } else {
+                    reply = createData->m_message.createErrorReply("", "Failed to retrieve the new contact");
+                }
+                //TODO: use dbus connection
+                QDBusConnection::sessionBus().send(reply);
             }
-        } else if (createData->m_message.type() != QDBusMessage::InvalidMessage) {
-            reply = createData->m_message.createErrorReply("", "Failed to retrieve the new contact");
-        }
+            delete createData;
+        });
+        return;
     }
     //TODO: use dbus connection
     if (createData->m_message.type() != QDBusMessage::InvalidMessage) {
@@ -1565,6 +1695,64 @@ void AddressBook::createContactDone(FolksIndividualAggregator *individualAggrega
     delete createData;
 }
 
+void AddressBook::createContactsDone(FolksIndividualAggregator *individualAggregator,
+                                     GAsyncResult *res,
+                                     void *data)
+{
+    CreateContactsItem *item = static_cast<CreateContactsItem*>(data);
+    CreateContactsData *createData = item->m_data;
+
+    GError *error = NULL;
+    FolksPersona *persona = folks_individual_aggregator_add_persona_from_details_finish(individualAggregator, res, &error);
+    if (error != NULL) {
+        qWarning() << "Failed to create individual from contact:" << error->message;
+        g_clear_error(&error);
+    } else if (persona == NULL) {
+        qWarning() << "Failed to create individual from contact: Persona already exists";
+    } else {
+        // the item stays pending until the extended details are saved
+        createData->m_addressbook->newContactVCard(persona, createData->m_contacts[item->m_index],
+                                                   [item] (const QString &vcard, const QString &errorMessage) {
+            Q_UNUSED(errorMessage);
+            CreateContactsData *createData = item->m_data;
+            createData->m_result[item->m_index] = vcard;
+            createData->m_pending--;
+            delete item;
+            createContactsStart(createData);
+        });
+        return;
+    }
+
+    createData->m_pending--;
+    delete item;
+    createContactsStart(createData);
+}
+
+void AddressBook::newContactVCard(FolksPersona *persona,
+                                  const QContact &contact,
+                                  const NewContactCallback &callback)
+{
+    g_object_ref(persona);
+    QIndividual::setExtendedDetails(persona,
+                                    contact.details(QContactExtendedDetail::Type),
+                                    QDateTime::currentDateTime(),
+                                    [this, persona, callback] (const QString &errorMessage) {
+        QString vcard;
+        FolksIndividual *individual = folks_persona_get_individual(persona);
+        ContactEntry *entry = 0;
+        if (errorMessage.isEmpty() && individual) {
+            entry = m_contacts->value(QString::fromUtf8(folks_individual_get_id(individual)));
+        }
+        if (entry) {
+            // We will need to reload contact due the extended details
+            entry->individual()->flush();
+            vcard = VCardParser::contactToVcard(entry->individual()->contact());
+        }
+        g_object_unref(persona);
+        callback(vcard, errorMessage);
+    });
+}
+
 void AddressBook::isQuiescentChanged(GObject *source, GParamSpec *param, AddressBook *self)
 {
     Q_UNUSED(param);
@@ -1581,19 +1769,6 @@ void AddressBook::quitSignalHandler(int)
      ::write(m_sigQuitFd[0], &a, sizeof(a));
 }
 
-bool AddressBook::processUpdates()
-{
-    int timeout = 10;
-    while(!m_updateLock.tryLock(1000)) {
-        if (timeout <= 0) {
-            return false;
-        }
-        QCoreApplication::processEvents();
-        timeout--;
-    }
-    return true;
-}
-
 int AddressBook::init()
 {
     struct sigaction quit = { { 0 } };
@@ -35,6 +35,8 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#include <functional>
+
 typedef struct _MessagingMenuMessage MessagingMenuMessage;
 typedef struct _MessagingMenuApp MessagingMenuApp;
 typedef struct _ESource ESource;
@@ -44,9 +46,11 @@ namespace galera
 {
 class View;
 class ContactsMap;
+class ContactsSnapshot;
 class AddressBookAdaptor;
 class QIndividual;
 class DirtyContactsNotify;
+class UpdateScheduler;
 
 class AddressBook: public QObject
 {
@@ -64,6 +68,7 @@ public:
     QStringList sortFields();
     bool unlinkContacts(const QString &parent, const QStringList &contacts);
     bool isReady() const;
+    bool hasSnapshot() const;
     void setSafeMode(bool flag);
 
     static bool isSafeMode();
@@ -84,10 +89,10 @@ public Q_SLOTS:
     SourceList updateSources(const SourceList &sources, const QDBusMessage &message);
     void removeSource(const QString &sourceId, const QDBusMessage &message);
     QString createContact(const QString &contact, const QString &source, const QDBusMessage &message = QDBusMessage());
+    QStringList createContacts(const QStringList &contacts, const QString &source, const QDBusMessage &message = QDBusMessage());
     int removeContacts(const QStringList &contactIds, const QDBusMessage &message);
     QStringList updateContacts(const QStringList &contacts, const QDBusMessage &message);
     void purgeContacts(const QDateTime &since, const QString &sourceId, const QDBusMessage &message);
-    void updateContactsDone(const QString &contactId, const QString &error);
 
 private Q_SLOTS:
     void viewClosed();
@@ -108,10 +113,15 @@ private Q_SLOTS:
 private:
     FolksIndividualAggregator *m_individualAggregator;
     ContactsMap *m_contacts;
+    // contacts saved from the last execution, used until folks is ready
+    ContactsSnapshot *m_snapshot;
+    bool m_snapshotIsDirty;
     QSet<View*> m_views;
     AddressBookAdaptor *m_adaptor;
     // timer to avoid send several updates at the same time
     DirtyContactsNotify *m_notifyContactUpdate;
+    // runs the contact updates requested by the clients
+    UpdateScheduler *m_updateScheduler;
     QDBusServiceWatcher *m_edsWatcher;
     MessagingMenuApp *m_messagingMenu;
     MessagingMenuMessage *m_messagingMenuMessage;
@@ -126,13 +136,6 @@ private:
     gulong m_notifyIsQuiescentHandlerId;
     QDBusConnection m_connection;
 
-    // Update command
-    QMutex m_updateLock;
-    QDBusMessage m_updateCommandReplyMessage;
-    QStringList m_updateCommandResult;
-    QStringList m_updatedIds;
-    QStringList m_updateCommandPendingContacts;
-
     // Unix signals
     static int m_sigQuitFd[2];
     QSocketNotifier *m_snQuit;
@@ -151,16 +154,27 @@ private:
     void prepareUnixSignals();
     static void quitSignalHandler(int unused);
 
-    bool processUpdates();
     void prepareFolks();
     void unprepareEds();
     void connectWithEDS();
+    void connectWithSourceRegistry();
+    void disconnectFromSourceRegistry();
     void continueShutdown();
     void setIsReady(bool isReady);
+    void syncSnapshot();
     bool registerObject(QDBusConnection &connection);
     QString removeContact(FolksIndividual *individual, bool *visible);
     QString addContact(FolksIndividual *individual, bool visible);
     FolksPersonaStore *getFolksStore(const QString &source);
+    void removeIndividuals(const QList<QIndividual*> &individuals, bool softRemoval, const QDBusMessage &message);
+    // saves the extended details of the new persona and returns its vcard, the
+    // vcard is empty if the contact could not be saved or found
+    typedef std::function<void(const QString &vcard, const QString &errorMessage)> NewContactCallback;
+    void newContactVCard(FolksPersona *persona,
+                         const QtContacts::QContact &contact,
+                         const NewContactCallback &callback);
+
+    static void createContactsStart(void *data);
 
     static void availableSourcesDoneListAllSources(FolksBackendStore *backendStore,
                                                    GAsyncResult *res,
@@ -182,9 +196,9 @@ private:
     static void createContactDone(FolksIndividualAggregator *individualAggregator,
                                   GAsyncResult *res,
                                   void *data);
-    static void removeContactDone(FolksIndividualAggregator *individualAggregator,
-                                  GAsyncResult *result,
-                                  void *data);
+    static void createContactsDone(FolksIndividualAggregator *individualAggregator,
+                                   GAsyncResult *res,
+                                   void *data);
     static void createSourceDone(GObject *source,
                                  GAsyncResult *res,
                                  void *data);
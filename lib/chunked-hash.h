@@ -0,0 +1,138 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_CHUNKED_HASH_H__
+#define __GALERA_CHUNKED_HASH_H__
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+// the keys are stored on 2^CHUNKED_HASH_BITS hashes
+#define CHUNKED_HASH_BITS       10
+#define CHUNKED_HASH_CHUNKS     (1 << CHUNKED_HASH_BITS)
+
+namespace galera
+{
+
+// Hash split on a fixed number of implicitly shared hashes.
+// A copy shares all the chunks, the first change after the copy only detaches
+// the chunk list and the chunks containing the changed keys instead of the
+// whole hash.
+template <typename Key, typename T>
+class ChunkedHash
+{
+public:
+    ChunkedHash()
+        : m_chunks(CHUNKED_HASH_CHUNKS),
+          m_size(0)
+    {
+    }
+
+    T &operator[](const Key &key)
+    {
+        QHash<Key, T> &hash = m_chunks[chunk(key)];
+        if (!hash.contains(key)) {
+            m_size++;
+        }
+        return hash[key];
+    }
+
+    bool contains(const Key &key) const
+    {
+        return m_chunks.at(chunk(key)).contains(key);
+    }
+
+    T value(const Key &key, const T &defaultValue = T()) const
+    {
+        return m_chunks.at(chunk(key)).value(key, defaultValue);
+    }
+
+    const T *find(const Key &key) const
+    {
+        const QHash<Key, T> &hash = m_chunks.at(chunk(key));
+        typename QHash<Key, T>::const_iterator it = hash.find(key);
+        return (it != hash.end()) ? &it.value() : 0;
+    }
+
+    void insert(const Key &key, const T &value)
+    {
+        (*this)[key] = value;
+    }
+
+    T take(const Key &key)
+    {
+        // avoid detaching a chunk that does not have the key
+        if (!contains(key)) {
+            return T();
+        }
+        m_size--;
+        return m_chunks[chunk(key)].take(key);
+    }
+
+    void remove(const Key &key)
+    {
+        if (contains(key)) {
+            m_size--;
+            m_chunks[chunk(key)].remove(key);
+        }
+    }
+
+    void clear()
+    {
+        m_chunks = QVector<QHash<Key, T> >(CHUNKED_HASH_CHUNKS);
+        m_size = 0;
+    }
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    QList<Key> keys() const
+    {
+        QList<Key> result;
+        for(int i = 0; i < m_chunks.size(); i++) {
+            result += m_chunks.at(i).keys();
+        }
+        return result;
+    }
+
+    QList<T> values() const
+    {
+        QList<T> result;
+        for(int i = 0; i < m_chunks.size(); i++) {
+            result += m_chunks.at(i).values();
+        }
+        return result;
+    }
+
+private:
+    QVector<QHash<Key, T> > m_chunks;
+    int m_size;
+
+    static int chunk(const Key &key)
+    {
+        // the pointer keys are aligned, the high bits of the product mix all of them
+        return (uint(qHash(key)) * 2654435761U) >> (32 - CHUNKED_HASH_BITS);
+    }
+};
+
+} //namespace
+
+#endif
@@ -22,6 +22,7 @@
 #include "contact-less-than.h"
 #include "contacts-map.h"
 #include "qindividual.h"
+#include "contact-sort-key.h"
 
 #include <QtCore/QTime>
 #include <QtCore/QDebug>
@@ -46,17 +47,18 @@ bool ContactLessThan::operator()(const QtContacts::QContact &contactA, const QtC
 }
 
 ContactEntryLessThan::ContactEntryLessThan(const SortClause &sortClause)
-    : m_sortClause(sortClause)
+    : m_sortClause(sortClause),
+      m_sortOrders(sortClause.toContactSortOrder()),
+      m_sortKeyName(ContactSortKey::name(sortClause))
 {
-
 }
 
 bool ContactEntryLessThan::operator()(ContactEntry *entryA, ContactEntry *entryB)
 {
-    int r = QContactManagerEngine::compareContact(entryA->individual()->contact(),
-                                                  entryB->individual()->contact(),
-                                                  m_sortClause.toContactSortOrder());
-    return (r <= 0);
+    // use the sort values cached by the individuals
+    ContactSortKey keyA = entryA->individual()->sortKey(m_sortClause, m_sortKeyName);
+    ContactSortKey keyB = entryB->individual()->sortKey(m_sortClause, m_sortKeyName);
+    return (keyA.compare(keyB, m_sortOrders) <= 0);
 }
 
 } // namespace
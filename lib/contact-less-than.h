@@ -25,6 +25,7 @@
 #include <QtCore/QVariant>
 
 #include <QtContacts/QContact>
+#include <QtContacts/QContactSortOrder>
 
 namespace galera {
 
@@ -50,6 +51,8 @@ public:
 
 private:
     SortClause m_sortClause;
+    QList<QtContacts::QContactSortOrder> m_sortOrders;
+    QString m_sortKeyName;
 };
 
 } // namespace
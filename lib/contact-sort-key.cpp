@@ -0,0 +1,124 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "contact-sort-key.h"
+
+#include <QtCore/QCollator>
+#include <QtCore/QThreadStorage>
+
+#include <QtContacts/QContactManagerEngine>
+
+using namespace QtContacts;
+
+namespace galera {
+
+ContactSortKey::Value::Value(const QCollatorSortKey &key, const QVariant &value, bool isBlank, bool isText)
+    : key(key),
+      value(value),
+      isBlank(isBlank),
+      isText(isText)
+{
+}
+
+ContactSortKey::ContactSortKey()
+{
+}
+
+ContactSortKey::ContactSortKey(const QContact &contact, const SortClause &clause)
+{
+    Q_FOREACH(const QContactSortOrder &sortOrder, clause.toContactSortOrder()) {
+        if (!sortOrder.isValid()) {
+            break;
+        }
+
+        const QVariant value = contact.detail(sortOrder.detailType()).value(sortOrder.detailField());
+        // treat empty strings as null values, same as QContactManagerEngine
+        bool isText = (value.type() == QVariant::String);
+        bool isBlank = value.isNull() || (isText && value.toString().isEmpty());
+
+        if (isText && !isBlank) {
+            QString text = value.toString();
+            if (sortOrder.caseSensitivity() == Qt::CaseInsensitive) {
+                text = text.toCaseFolded();
+            }
+            m_values << Value(collationKey(text), QVariant(), false, true);
+        } else {
+            m_values << Value(collationKey(QString()), value, isBlank, false);
+        }
+    }
+}
+
+bool ContactSortKey::isEmpty() const
+{
+    return m_values.isEmpty();
+}
+
+int ContactSortKey::compare(const ContactSortKey &other, const QList<QContactSortOrder> &sortOrders) const
+{
+    for(int i = 0, iMax = qMin(sortOrders.size(), qMin(m_values.size(), other.m_values.size())); i < iMax; i++) {
+        const QContactSortOrder &sortOrder = sortOrders.at(i);
+        const Value &a = m_values.at(i);
+        const Value &b = other.m_values.at(i);
+
+        if (a.isBlank && b.isBlank) {
+            continue;
+        }
+        if (a.isBlank) {
+            return (sortOrder.blankPolicy() == QContactSortOrder::BlanksFirst ? -1 : 1);
+        }
+        if (b.isBlank) {
+            return (sortOrder.blankPolicy() == QContactSortOrder::BlanksFirst ? 1 : -1);
+        }
+
+        int comparison;
+        if (a.isText && b.isText) {
+            comparison = a.key.compare(b.key);
+        } else {
+            comparison = QContactManagerEngine::compareVariant(a.value, b.value, sortOrder.caseSensitivity());
+        }
+
+        if (comparison != 0) {
+            return (sortOrder.direction() == Qt::AscendingOrder ? comparison : -comparison);
+        }
+    }
+
+    return 0;
+}
+
+QString ContactSortKey::name(const SortClause &clause)
+{
+    QString result;
+    Q_FOREACH(const QContactSortOrder &sortOrder, clause.toContactSortOrder()) {
+        result += QString("%1:%2:%3;").arg(sortOrder.detailType())
+                                      .arg(sortOrder.detailField())
+                                      .arg(sortOrder.caseSensitivity());
+    }
+    return result;
+}
+
+QCollatorSortKey ContactSortKey::collationKey(const QString &text)
+{
+    // QCollator is not thread safe and expensive to create, keep one for each thread
+    static QThreadStorage<QCollator*> collators;
+    if (!collators.hasLocalData()) {
+        collators.setLocalData(new QCollator(QLocale()));
+    }
+    return collators.localData()->sortKey(text);
+}
+
+} // namespace
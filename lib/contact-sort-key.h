@@ -0,0 +1,70 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_CONTACT_SORT_KEY_H__
+#define __GALERA_CONTACT_SORT_KEY_H__
+
+#include "common/sort-clause.h"
+
+#include <QtCore/QCollatorSortKey>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QVariant>
+
+#include <QtContacts/QContact>
+#include <QtContacts/QContactSortOrder>
+
+namespace galera {
+
+// Precomputed values used to sort a contact by a sort clause.
+// Text values are stored as collation keys and the comparison gives the same
+// result as QContactManagerEngine::compareContact without looking up the contact details.
+class ContactSortKey
+{
+public:
+    ContactSortKey();
+    ContactSortKey(const QtContacts::QContact &contact, const SortClause &clause);
+
+    bool isEmpty() const;
+    int compare(const ContactSortKey &other,
+                const QList<QtContacts::QContactSortOrder> &sortOrders) const;
+
+    // identifies the values used by the key, the sort direction and the blank policy
+    // are applied on the comparison and do not change the key
+    static QString name(const SortClause &clause);
+
+private:
+    class Value
+    {
+    public:
+        Value(const QCollatorSortKey &key, const QVariant &value, bool isBlank, bool isText);
+
+        QCollatorSortKey key;
+        QVariant value;
+        bool isBlank;
+        bool isText;
+    };
+
+    QList<Value> m_values;
+
+    static QCollatorSortKey collationKey(const QString &text);
+};
+
+} // namespace
+
+#endif
@@ -20,16 +20,16 @@
 #include "contacts-map.h"
 #include "qindividual.h"
 
+#include "common/filter.h"
+
 #include <QtCore/QDebug>
+#include <QtCore/QSet>
 
 #include <QtContacts/QContactSortOrder>
 #include <QtContacts/QContactDisplayLabel>
 #include <QtContacts/QContactTag>
 #include <QtContacts/QContactPhoneNumber>
 
-#include <phonenumbers/phonenumberutil.h>
-#include <phonenumbers/region_code.h>
-
 using namespace QtContacts;
 
 namespace galera
@@ -52,36 +52,58 @@ QIndividual *ContactEntry::individual() const
     return m_individual;
 }
 
-//ContactMap
-ContactsMap::ContactsMap()
-    : m_sortClause(defaultSort())
+ContactsMap::Ordering::Ordering()
+    : clause(QString())
 {
 }
 
-ContactsMap::~ContactsMap()
+ContactsMap::Ordering::Ordering(const SortClause &clause)
+    : clause(clause)
 {
-    clear();
 }
 
-ContactEntry *ContactsMap::value(const QString &id) const
+ContactsMap::Data::Data()
+    : sortClause(QString())
 {
-    return m_idToEntry.value(id, 0);
 }
 
-QList<ContactEntry *> ContactsMap::valueByPhone(const QString &phone) const
+QList<ContactEntry *> ContactsMap::Data::valueByPhone(const QString &phone) const
 {
     if (phone.isEmpty()) {
-        return values();
+        return contacts;
     }
 
-    return m_phoneToEntry.values(minimalNumber(phone));
+    return phoneIndex.lookup(phone);
 }
 
-QList<ContactEntry *> ContactsMap::values(const QStringList &ids) const
+QList<ContactEntry *> ContactsMap::Data::valueByText(const QString &text, bool startsWith, const SortClause &sort) const
+{
+    QList<ContactEntry*> candidates;
+    if (!textIndex.lookup(text, startsWith, &candidates)) {
+        // short texts are not indexed
+        return contacts;
+    }
+
+    if (candidates.size() < 2) {
+        return candidates;
+    }
+
+    // return the contacts in the map order or in the requested order
+    QSet<ContactEntry*> candidatesSet = QSet<ContactEntry*>::fromList(candidates);
+    QList<ContactEntry*> result;
+    Q_FOREACH(ContactEntry *entry, values(sort)) {
+        if (candidatesSet.contains(entry)) {
+            result << entry;
+        }
+    }
+    return result;
+}
+
+QList<ContactEntry *> ContactsMap::Data::values(const QStringList &ids) const
 {
     QList<ContactEntry *> result;
     Q_FOREACH(const QString &id, ids) {
-        ContactEntry *entry = m_idToEntry.value(id, 0);
+        ContactEntry *entry = idToEntry.value(id, 0);
         if (entry) {
             result << entry;
         }
@@ -89,6 +111,60 @@ QList<ContactEntry *> ContactsMap::values(const QStringList &ids) const
     return result;
 }
 
+QList<ContactEntry*> ContactsMap::Data::values(const SortClause &sort) const
+{
+    QHash<QString, Ordering>::const_iterator it = orderings.constFind(sort.toString());
+    return (it != orderings.constEnd()) ? it->contacts : contacts;
+}
+
+bool ContactsMap::Data::hasSort(const SortClause &sort) const
+{
+    return orderings.contains(sort.toString());
+}
+
+//ContactMap
+ContactsMap::ContactsMap()
+    : m_version(0),
+      m_batchDepth(0)
+{
+    m_data.sortClause = defaultSort();
+}
+
+ContactsMap::~ContactsMap()
+{
+    if (!m_snapshots.isEmpty()) {
+        qWarning() << "Contacts map destroyed with" << m_snapshots.size() << "snapshots alive";
+    }
+    if (m_batchDepth > 0) {
+        qWarning() << "Contacts map destroyed during a batch";
+        m_batchDepth = 0;
+        applyBatch();
+    }
+    clear();
+    m_snapshots.clear();
+    deleteRetired();
+}
+
+ContactEntry *ContactsMap::value(const QString &id) const
+{
+    return m_data.idToEntry.value(id, 0);
+}
+
+QList<ContactEntry *> ContactsMap::valueByPhone(const QString &phone) const
+{
+    return m_data.valueByPhone(phone);
+}
+
+QList<ContactEntry *> ContactsMap::valueByText(const QString &text, bool startsWith, const SortClause &sort) const
+{
+    return m_data.valueByText(text, startsWith, sort);
+}
+
+QList<ContactEntry *> ContactsMap::values(const QStringList &ids) const
+{
+    return m_data.values(ids);
+}
+
 ContactEntry *ContactsMap::take(FolksIndividual *individual)
 {
     QString contactId = QString::fromUtf8(folks_individual_get_id(individual));
@@ -97,85 +173,126 @@ ContactEntry *ContactsMap::take(FolksIndividual *individual)
 
 ContactEntry *ContactsMap::take(const QString &id)
 {
-    QWriteLocker locker(&m_mutex);
-    ContactEntry *entry = m_idToEntry.take(id);
+    QMutexLocker locker(&m_mutex);
+    if (m_batchDepth > 0) {
+        ContactEntry *entry = m_data.idToEntry.take(id);
+        batchRemove(entry, false);
+        return entry;
+    }
+
+    m_version++;
+    ContactEntry *entry = m_data.idToEntry.take(id);
     removeData(entry, false);
     return entry;
 }
 
 void ContactsMap::remove(const QString &id)
 {
-    QWriteLocker locker(&m_mutex);
-    ContactEntry *entry = m_idToEntry.take(id);
+    QMutexLocker locker(&m_mutex);
+    if (m_batchDepth > 0) {
+        batchRemove(m_data.idToEntry.take(id), true);
+        return;
+    }
+
+    m_version++;
+    ContactEntry *entry = m_data.idToEntry.take(id);
     removeData(entry, true);
 }
 
 void ContactsMap::insert(ContactEntry *entry)
 {
-    QWriteLocker locker(&m_mutex);
+    QMutexLocker locker(&m_mutex);
+    if (m_batchDepth > 0) {
+        batchInsert(entry);
+        return;
+    }
+
+    m_version++;
     insertData(entry);
 }
 
 void ContactsMap::updatePosition(ContactEntry *entry)
 {
-    QWriteLocker locker(&m_mutex);
-    if (!m_sortClause.isEmpty()) {
-        int oldPos = m_contacts.indexOf(entry);
+    QMutexLocker locker(&m_mutex);
+    if (m_batchDepth > 0) {
+        // the inserted entries are sorted on commit
+        if (!m_batchInsertedSet.contains(entry)) {
+            m_batchUpdated << entry;
+        }
+        return;
+    }
+
+    m_version++;
+    QHash<QString, Ordering>::iterator ordering = m_data.orderings.begin();
+    for(; ordering != m_data.orderings.end(); ordering++) {
+        ordering->contacts.removeOne(entry);
+        insertSorted(&ordering->contacts, entry, ordering->clause);
+    }
 
-        ContactEntryLessThan lessThan(m_sortClause);
-        QList<ContactEntry*>::iterator it(std::upper_bound(m_contacts.begin(), m_contacts.end(), entry, lessThan));
+    QList<ContactEntry*> &contacts = m_data.contacts;
+    if (!m_data.sortClause.isEmpty()) {
+        int oldPos = contacts.indexOf(entry);
 
-        if (it != m_contacts.end()) {
-            int newPos = std::distance(m_contacts.begin(), it);
+        ContactEntryLessThan lessThan(m_data.sortClause);
+        QList<ContactEntry*>::iterator it(std::upper_bound(contacts.begin(), contacts.end(), entry, lessThan));
+
+        if (it != contacts.end()) {
+            int newPos = std::distance(contacts.begin(), it);
             if (oldPos != newPos) {
-                m_contacts.move(oldPos, newPos);
+                contacts.move(oldPos, newPos);
             }
-        } else if (oldPos != (m_contacts.size() - 1)) {
-            m_contacts.move(oldPos, m_contacts.size() -1);
+        } else if (oldPos != (contacts.size() - 1)) {
+            contacts.move(oldPos, contacts.size() -1);
         }
     }
 
-    // update phone number map
-    Q_FOREACH(const QString &key, m_phoneToEntry.keys(entry)) {
-        m_phoneToEntry.remove(key, entry);
-    }
-    insertData(entry->individual()->contact().details<QContactPhoneNumber>(), entry);
+    // update phone number and text indexes
+    m_data.phoneIndex.update(entry, entry->individual()->phoneNumbers());
+    m_data.textIndex.update(entry, textValues(entry));
 }
 
 int ContactsMap::size() const
 {
-    return m_idToEntry.size();
+    return m_data.idToEntry.size();
 }
 
 void ContactsMap::clear()
 {
-    QWriteLocker locker(&m_mutex);
-    QList<ContactEntry*> entries = m_idToEntry.values();
-    m_idToEntry.clear();
-    m_phoneToEntry.clear();
-    m_contacts.clear();
-    qDeleteAll(entries);
-}
-
-void ContactsMap::lockForRead()
-{
-    m_mutex.lockForRead();
+    QMutexLocker locker(&m_mutex);
+    m_version++;
+    QList<ContactEntry*> entries = m_data.idToEntry.values();
+    m_data.idToEntry.clear();
+    m_data.phoneIndex.clear();
+    m_data.textIndex.clear();
+    m_data.contacts.clear();
+    QHash<QString, Ordering>::iterator ordering = m_data.orderings.begin();
+    for(; ordering != m_data.orderings.end(); ordering++) {
+        ordering->contacts.clear();
+    }
+    Q_FOREACH(ContactEntry *entry, entries + m_batchRetired) {
+        retire(entry);
+    }
+    m_batchInserted.clear();
+    m_batchInsertedSet.clear();
+    m_batchRemoved.clear();
+    m_batchUpdated.clear();
+    m_batchRetired.clear();
 }
 
-void ContactsMap::unlock()
+QList<ContactEntry*> ContactsMap::values() const
 {
-    m_mutex.unlock();
+    return m_data.contacts;
 }
 
-QList<ContactEntry*> ContactsMap::values() const
+QList<ContactEntry*> ContactsMap::values(const SortClause &sort) const
 {
-    return m_contacts;
+    return m_data.values(sort);
 }
 
 QList<QContact> ContactsMap::contacts() const
 {
     QList<QContact> result;
-    Q_FOREACH(ContactEntry *e, m_contacts) {
+    Q_FOREACH(ContactEntry *e, m_data.contacts) {
         result << e->individual()->contact();
     }
     return result;
@@ -183,23 +300,97 @@ QList<QContact> ContactsMap::contacts() const
 
 QStringList ContactsMap::keys() const
 {
-    return m_idToEntry.keys();
+    return m_data.idToEntry.keys();
 }
 
 void ContactsMap::sertSort(const SortClause &clause)
 {
-    if (clause.toContactSortOrder() != m_sortClause.toContactSortOrder()) {
-        m_sortClause = clause;
-        if (!m_sortClause.isEmpty()) {
-            ContactEntryLessThan lessThan(m_sortClause);
-            qSort(m_contacts.begin(), m_contacts.end(), lessThan);
+    if (clause.toContactSortOrder() != m_data.sortClause.toContactSortOrder()) {
+        QMutexLocker locker(&m_mutex);
+        m_version++;
+        m_data.sortClause = clause;
+        if (!clause.isEmpty()) {
+            ContactEntryLessThan lessThan(clause);
+            qSort(m_data.contacts.begin(), m_data.contacts.end(), lessThan);
         }
     }
 }
 
 SortClause ContactsMap::sort() const
 {
-    return m_sortClause;
+    return m_data.sortClause;
+}
+
+void ContactsMap::acquireSort(const SortClause &sort)
+{
+    if (sort.isEmpty() || (sort.toContactSortOrder() == m_data.sortClause.toContactSortOrder())) {
+        return;
+    }
+
+    QString key = sort.toString();
+    if (!m_data.orderings.contains(key)) {
+        Ordering ordering(sort);
+        ordering.contacts = m_data.contacts;
+        ContactEntryLessThan lessThan(sort);
+        qStableSort(ordering.contacts.begin(), ordering.contacts.end(), lessThan);
+
+        QMutexLocker locker(&m_mutex);
+        m_version++;
+        m_data.orderings.insert(key, ordering);
+    }
+    m_orderingRefs[key]++;
+}
+
+void ContactsMap::releaseSort(const SortClause &sort)
+{
+    QString key = sort.toString();
+    if (m_orderingRefs.contains(key) && (--m_orderingRefs[key] == 0)) {
+        m_orderingRefs.remove(key);
+
+        QMutexLocker locker(&m_mutex);
+        m_version++;
+        m_data.orderings.remove(key);
+    }
+}
+
+bool ContactsMap::hasSort(const SortClause &sort) const
+{
+    return m_data.hasSort(sort);
+}
+
+void ContactsMap::beginBatch()
+{
+    QMutexLocker locker(&m_mutex);
+    m_batchDepth++;
+}
+
+void ContactsMap::commitBatch()
+{
+    QMutexLocker locker(&m_mutex);
+    Q_ASSERT(m_batchDepth > 0);
+    if (--m_batchDepth == 0) {
+        applyBatch();
+    }
+}
+
+ContactsMapSnapshot *ContactsMap::snapshot()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_batchDepth > 0) {
+        // the snapshot must have consistent lists and indexes
+        applyBatch();
+    }
+    m_snapshots[m_version]++;
+    return new ContactsMapSnapshot(this, m_data, m_version);
+}
+
+void ContactsMap::releaseSnapshot(quint64 version)
+{
+    QMutexLocker locker(&m_mutex);
+    if (--m_snapshots[version] == 0) {
+        m_snapshots.remove(version);
+    }
+    deleteRetired();
 }
 
 SortClause ContactsMap::defaultSort()
@@ -237,7 +428,7 @@ ContactEntry *ContactsMap::valueFromVCard(const QString &vcard) const
         int endIndex = vcard.indexOf("\r\n", startIndex);
 
         QString id = vcard.mid(startIndex, endIndex - startIndex);
-        return m_idToEntry[id];
+        return m_data.idToEntry.value(id, 0);
     }
     return 0;
 }
@@ -250,24 +441,27 @@ bool ContactsMap::contains(FolksIndividual *individual) const
 
 bool ContactsMap::contains(const QString &id) const
 {
-    return m_idToEntry.contains(id);
+    return m_data.idToEntry.contains(id);
 }
 
 ContactEntry *ContactsMap::value(FolksIndividual *individual) const
 {
     QString contactId = QString::fromUtf8(folks_individual_get_id(individual));
-    return m_idToEntry.value(contactId, 0);
+    return m_data.idToEntry.value(contactId, 0);
 }
 
 void ContactsMap::removeData(ContactEntry *entry, bool del)
 {
     if (entry) {
-        Q_FOREACH(const QString &key,  m_phoneToEntry.keys(entry)) {
-            m_phoneToEntry.remove(key, entry);
+        m_data.phoneIndex.remove(entry);
+        m_data.textIndex.remove(entry);
+        m_data.contacts.removeOne(entry);
+        QHash<QString, Ordering>::iterator ordering = m_data.orderings.begin();
+        for(; ordering != m_data.orderings.end(); ordering++) {
+            ordering->contacts.removeOne(entry);
         }
-        m_contacts.removeOne(entry);
         if (del) {
-            delete entry;
+            retire(entry);
         }
     }
 
@@ -275,49 +469,246 @@ void ContactsMap::removeData(ContactEntry *entry, bool del)
 
 void ContactsMap::insertData(ContactEntry *entry)
 {
-    FolksIndividual *fIndividual = entry->individual()->individual();
+    QString id = entry->individual()->id();
 
-
-    if (fIndividual) {
+    if (!id.isEmpty()) {
         // fill id map
-        m_idToEntry.insert(folks_individual_get_id(fIndividual), entry);
-
-        // fill contact list
-        if (!m_sortClause.isEmpty()) {
-            ContactEntryLessThan lessThan(m_sortClause);
-            QList<ContactEntry*>::iterator it(std::upper_bound(m_contacts.begin(), m_contacts.end(), entry, lessThan));
-            m_contacts.insert(it, entry);
-        } else {
-            m_contacts.append(entry);
+        m_data.idToEntry.insert(id, entry);
+
+        // fill contact lists
+        insertSorted(&m_data.contacts, entry, m_data.sortClause);
+        QHash<QString, Ordering>::iterator ordering = m_data.orderings.begin();
+        for(; ordering != m_data.orderings.end(); ordering++) {
+            insertSorted(&ordering->contacts, entry, ordering->clause);
         }
 
-        // fill phone map
-        insertData(entry->individual()->contact().details<QContactPhoneNumber>(), entry);
+        // fill phone and text indexes
+        m_data.phoneIndex.insert(entry, entry->individual()->phoneNumbers());
+        m_data.textIndex.insert(entry, textValues(entry));
+    }
+}
+
+void ContactsMap::batchRemove(ContactEntry *entry, bool del)
+{
+    if (!entry) {
+        return;
+    }
+
+    // an entry inserted by the batch is not on the lists yet
+    if (!m_batchInsertedSet.remove(entry)) {
+        m_batchUpdated.remove(entry);
+        m_batchRemoved << entry;
+    }
+
+    if (del) {
+        // the entry is still on the lists until the batch is applied
+        m_batchRetired << entry;
+    }
+}
+
+void ContactsMap::batchInsert(ContactEntry *entry)
+{
+    QString id = entry->individual()->id();
+    if (id.isEmpty()) {
+        return;
+    }
+
+    m_data.idToEntry.insert(id, entry);
+    if (m_batchRemoved.remove(entry)) {
+        // taken and inserted back, it is still on the lists
+        m_batchUpdated << entry;
+    } else {
+        m_batchInserted << entry;
+        m_batchInsertedSet << entry;
+    }
+}
+
+// apply the batch changes with a single pass on each contact list, the new and
+// changed entries are sorted and merged into the lists instead of being
+// inserted one by one
+void ContactsMap::applyBatch()
+{
+    if (m_batchInsertedSet.isEmpty() && m_batchRemoved.isEmpty() &&
+        m_batchUpdated.isEmpty() && m_batchRetired.isEmpty()) {
+        return;
+    }
+
+    m_version++;
+
+    Q_FOREACH(ContactEntry *entry, m_batchRemoved) {
+        m_data.phoneIndex.remove(entry);
+        m_data.textIndex.remove(entry);
+    }
+    Q_FOREACH(ContactEntry *entry, m_batchUpdated) {
+        m_data.phoneIndex.update(entry, entry->individual()->phoneNumbers());
+        m_data.textIndex.update(entry, textValues(entry));
+    }
+    // an entry can be on the list more than once if it was taken and inserted
+    // back, the set keeps its last insertion
+    QList<ContactEntry*> inserted;
+    Q_FOREACH(ContactEntry *entry, m_batchInserted) {
+        if (m_batchInsertedSet.remove(entry)) {
+            inserted << entry;
+        }
+    }
+    Q_FOREACH(ContactEntry *entry, inserted) {
+        m_data.phoneIndex.insert(entry, entry->individual()->phoneNumbers());
+        m_data.textIndex.insert(entry, textValues(entry));
+    }
+
+    // the changed entries are placed again as new ones
+    QSet<ContactEntry*> removed = m_batchRemoved + m_batchUpdated;
+    QList<ContactEntry*> entries = inserted + m_batchUpdated.toList();
+    mergeSorted(&m_data.contacts, removed, entries, m_data.sortClause);
+    QHash<QString, Ordering>::iterator ordering = m_data.orderings.begin();
+    for(; ordering != m_data.orderings.end(); ordering++) {
+        mergeSorted(&ordering->contacts, removed, entries, ordering->clause);
+    }
+
+    Q_FOREACH(ContactEntry *entry, m_batchRetired) {
+        retire(entry);
+    }
+
+    m_batchInserted.clear();
+    m_batchInsertedSet.clear();
+    m_batchRemoved.clear();
+    m_batchUpdated.clear();
+    m_batchRetired.clear();
+}
+
+// the entry can be used by the snapshots of the previous versions
+void ContactsMap::retire(ContactEntry *entry)
+{
+    if (m_snapshots.isEmpty()) {
+        delete entry;
+    } else {
+        m_retired << qMakePair(m_version, entry);
     }
 }
 
-void ContactsMap::insertData(const QList<QContactPhoneNumber> &numbers, ContactEntry *entry)
+void ContactsMap::deleteRetired()
 {
-    Q_FOREACH(const QContactPhoneNumber &phone, numbers) {
-        QString mNumber = minimalNumber(phone.number());
-        if (!mNumber.isEmpty()) {
-            m_phoneToEntry.insert(mNumber, entry);
+    // the snapshots taken after the removal do not have the entry
+    quint64 oldest = m_snapshots.isEmpty() ? m_version : m_snapshots.firstKey();
+    for(int i = m_retired.size() - 1; i >= 0; i--) {
+        if (m_retired[i].first <= oldest) {
+            delete m_retired.takeAt(i).second;
         }
     }
 }
 
-QString ContactsMap::minimalNumber(const QString &phone) const
+void ContactsMap::insertSorted(QList<ContactEntry*> *contacts, ContactEntry *entry, const SortClause &sort)
 {
-    static i18n::phonenumbers::PhoneNumberUtil *phonenumberUtil = i18n::phonenumbers::PhoneNumberUtil::GetInstance();
+    if (!sort.isEmpty()) {
+        ContactEntryLessThan lessThan(sort);
+        QList<ContactEntry*>::iterator it(std::upper_bound(contacts->begin(), contacts->end(), entry, lessThan));
+        contacts->insert(it, entry);
+    } else {
+        contacts->append(entry);
+    }
+}
 
-    std::string stdPreprocessedPhone(phone.toStdString());
-    phonenumberUtil->NormalizeDiallableCharsOnly(&stdPreprocessedPhone);
+void ContactsMap::mergeSorted(QList<ContactEntry*> *contacts, const QSet<ContactEntry*> &removed,
+                              QList<ContactEntry*> entries, const SortClause &sort)
+{
+    QList<ContactEntry*> result;
+    result.reserve(contacts->size() + entries.size());
 
-    if (stdPreprocessedPhone.length() <= 7) {
-        return QString::fromStdString(stdPreprocessedPhone);
+    if (sort.isEmpty()) {
+        Q_FOREACH(ContactEntry *entry, *contacts) {
+            if (!removed.contains(entry)) {
+                result << entry;
+            }
+        }
+        result << entries;
+    } else {
+        ContactEntryLessThan lessThan(sort);
+        qStableSort(entries.begin(), entries.end(), lessThan);
+
+        // ContactEntryLessThan accepts equal contacts, so new entries go before the
+        // equal ones, like insertSorted
+        QList<ContactEntry*>::const_iterator it = entries.constBegin();
+        Q_FOREACH(ContactEntry *entry, *contacts) {
+            if (removed.contains(entry)) {
+                continue;
+            }
+            while ((it != entries.constEnd()) && lessThan(*it, entry)) {
+                result << *it;
+                it++;
+            }
+            result << entry;
+        }
+        for(; it != entries.constEnd(); it++) {
+            result << *it;
+        }
     }
 
-    return QString::fromStdString(stdPreprocessedPhone).right(7);
+    *contacts = result;
+}
+
+QStringList ContactsMap::textValues(ContactEntry *entry)
+{
+    QStringList values;
+    const QList<QContactDetail::DetailType> types = Filter::textDetailTypes();
+    const QContact contact = entry->individual()->contact(types);
+    Q_FOREACH(QContactDetail::DetailType type, types) {
+        Q_FOREACH(const QContactDetail &detail, contact.details(type)) {
+            Q_FOREACH(const QVariant &value, detail.values()) {
+                if (value.type() == QVariant::String) {
+                    values << value.toString();
+                }
+            }
+        }
+    }
+    return values;
+}
+
+//ContactsMapSnapshot
+ContactsMapSnapshot::ContactsMapSnapshot(ContactsMap *map, const ContactsMap::Data &data, quint64 version)
+    : m_map(map),
+      m_data(data),
+      m_version(version)
+{
+}
+
+ContactsMapSnapshot::~ContactsMapSnapshot()
+{
+    m_map->releaseSnapshot(m_version);
+}
+
+quint64 ContactsMapSnapshot::version() const
+{
+    return m_version;
+}
+
+SortClause ContactsMapSnapshot::sort() const
+{
+    return m_data.sortClause;
+}
+
+bool ContactsMapSnapshot::hasSort(const SortClause &sort) const
+{
+    return m_data.hasSort(sort);
+}
+
+QList<ContactEntry*> ContactsMapSnapshot::valueByPhone(const QString &phone) const
+{
+    return m_data.valueByPhone(phone);
+}
+
+QList<ContactEntry*> ContactsMapSnapshot::valueByText(const QString &text, bool startsWith, const SortClause &sort) const
+{
+    return m_data.valueByText(text, startsWith, sort);
+}
+
+QList<ContactEntry*> ContactsMapSnapshot::values(const QStringList &ids) const
+{
+    return m_data.values(ids);
+}
+
+QList<ContactEntry*> ContactsMapSnapshot::values(const SortClause &sort) const
+{
+    return m_data.values(sort);
 }
 
 } //namespace
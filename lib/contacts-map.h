@@ -20,10 +20,16 @@
 #define __GALERA_CONTACTS_MAP_PRIV_H__
 
 #include "common/sort-clause.h"
+#include "chunked-hash.h"
+#include "phone-index.h"
+#include "text-index.h"
 
 #include <QtCore/QString>
 #include <QtCore/QHash>
-#include <QtCore/QReadWriteLock>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QSet>
 
 #include <QtContacts/QContactPhoneNumber>
 
@@ -52,6 +58,8 @@ private:
 };
 
 
+class ContactsMapSnapshot;
+
 class ContactsMap
 {
 public:
@@ -66,39 +74,144 @@ public:
     ContactEntry *value(FolksIndividual *individual) const;
     ContactEntry *value(const QString &id) const;
     QList<ContactEntry*> valueByPhone(const QString &phone) const;
+    QList<ContactEntry*> valueByText(const QString &text, bool startsWith,
+                                     const SortClause &sort = SortClause(QString())) const;
     QList<ContactEntry*> values(const QStringList &ids) const;
 
+    // the caller owns the entry, it can be used by snapshots taken before
     ContactEntry *take(FolksIndividual *individual);
     ContactEntry *take(const QString &id);
 
+    // the entry is deleted after the release of the snapshots taken before
     void remove(const QString &id);
     void insert(ContactEntry *entry);
     void updatePosition(ContactEntry *entry);
     int size() const;
     void clear();
-    void lockForRead();
-    void unlock();
     QList<ContactEntry*> values() const;
+    // contacts in the order of a sort clause kept by acquireSort
+    QList<ContactEntry*> values(const SortClause &sort) const;
     QList<QtContacts::QContact> contacts() const;
     QStringList keys() const;
 
     void sertSort(const SortClause &clause);
     SortClause sort() const;
 
+    // keep the contacts also sorted by the clause while it is acquired
+    void acquireSort(const SortClause &sort);
+    void releaseSort(const SortClause &sort);
+    bool hasSort(const SortClause &sort) const;
+
+    // group the changes done until commitBatch, the id lookups are updated at once but
+    // the contact lists and the indexes are only updated by commitBatch. Batches can be nested
+    // and the entries taken during a batch must be kept alive until the commit.
+    void beginBatch();
+    void commitBatch();
+
+    // read-only copy of the current contacts, used to read the map from other threads
+    // without locking it. Must be deleted on the map thread before the map.
+    ContactsMapSnapshot *snapshot();
+
     static SortClause defaultSort();
 
 private:
-    QHash<QString, ContactEntry*> m_idToEntry;
-    QMultiMap<QString, ContactEntry*> m_phoneToEntry;
-    // sorted contacts
-    QList<ContactEntry*> m_contacts;
-    SortClause m_sortClause;
-    QReadWriteLock m_mutex;
+    friend class ContactsMapSnapshot;
+
+    class Ordering
+    {
+    public:
+        Ordering();
+        Ordering(const SortClause &clause);
+
+        SortClause clause;
+        QList<ContactEntry*> contacts;
+    };
+
+    // all the containers are implicitly shared, a snapshot copies them in constant
+    // time and the map only copies the ones changed while a snapshot is alive.
+    // The id hash and the indexes are split in small parts, only the parts
+    // changed are copied instead of the whole container.
+    class Data
+    {
+    public:
+        Data();
+
+        QList<ContactEntry*> valueByPhone(const QString &phone) const;
+        QList<ContactEntry*> valueByText(const QString &text, bool startsWith,
+                                         const SortClause &sort) const;
+        QList<ContactEntry*> values(const QStringList &ids) const;
+        QList<ContactEntry*> values(const SortClause &sort) const;
+        bool hasSort(const SortClause &sort) const;
+
+        ChunkedHash<QString, ContactEntry*> idToEntry;
+        PhoneIndex phoneIndex;
+        TextIndex textIndex;
+        // sorted contacts
+        QList<ContactEntry*> contacts;
+        SortClause sortClause;
+        // additional orderings requested by the views
+        QHash<QString, Ordering> orderings;
+    };
+
+    Data m_data;
+    QHash<QString, int> m_orderingRefs;
+    // held while the data changes or is copied by a snapshot
+    QMutex m_mutex;
+    // incremented on each change, a snapshot keeps the version of its data
+    quint64 m_version;
+    // number of alive snapshots by version
+    QMap<quint64, int> m_snapshots;
+    // entries removed on a version, deleted when the older snapshots are released
+    QList<QPair<quint64, ContactEntry*> > m_retired;
+    // changes of the current batch
+    int m_batchDepth;
+    // the list keeps the insertion order, the set holds the entries still
+    // inserted, the ones taken back by the batch are skipped on commit
+    QList<ContactEntry*> m_batchInserted;
+    QSet<ContactEntry*> m_batchInsertedSet;
+    QSet<ContactEntry*> m_batchRemoved;
+    QSet<ContactEntry*> m_batchUpdated;
+    QList<ContactEntry*> m_batchRetired;
 
     void removeData(ContactEntry *entry, bool del);
     void insertData(ContactEntry *entry);
-    void insertData(const QList<QtContacts::QContactPhoneNumber> &numbers, ContactEntry *entry);
-    QString minimalNumber(const QString &phone) const;
+    void retire(ContactEntry *entry);
+    void releaseSnapshot(quint64 version);
+    void deleteRetired();
+    void batchRemove(ContactEntry *entry, bool del);
+    void batchInsert(ContactEntry *entry);
+    void applyBatch();
+    static void mergeSorted(QList<ContactEntry*> *contacts, const QSet<ContactEntry*> &removed,
+                            QList<ContactEntry*> entries, const SortClause &sort);
+    static void insertSorted(QList<ContactEntry*> *contacts, ContactEntry *entry, const SortClause &sort);
+    static QStringList textValues(ContactEntry *entry);
+};
+
+// Contacts of a map at the time the snapshot was taken, the changes done on the
+// map after that are not visible and the entries are not deleted before the snapshot.
+class ContactsMapSnapshot
+{
+public:
+    ~ContactsMapSnapshot();
+
+    quint64 version() const;
+    SortClause sort() const;
+    bool hasSort(const SortClause &sort) const;
+
+    QList<ContactEntry*> valueByPhone(const QString &phone) const;
+    QList<ContactEntry*> valueByText(const QString &text, bool startsWith, const SortClause &sort) const;
+    QList<ContactEntry*> values(const QStringList &ids) const;
+    QList<ContactEntry*> values(const SortClause &sort) const;
+
+private:
+    friend class ContactsMap;
+
+    ContactsMap *m_map;
+    ContactsMap::Data m_data;
+    quint64 m_version;
+
+    ContactsMapSnapshot(ContactsMap *map, const ContactsMap::Data &data, quint64 version);
+    ContactsMapSnapshot(const ContactsMapSnapshot &other);
 };
 
 } //namespace
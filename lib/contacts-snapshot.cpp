@@ -0,0 +1,349 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "contacts-snapshot.h"
+#include "contacts-map.h"
+#include "qindividual.h"
+
+#include "common/contact-codec.h"
+#include "common/filter.h"
+
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStandardPaths>
+
+#define SNAPSHOT_MAGIC          0x47414c53 // "GALS"
+#define SNAPSHOT_VERSION        3
+
+using namespace QtContacts;
+
+namespace galera
+{
+
+ContactsSnapshot::ContactsSnapshot(const QString &fileName)
+    : m_fileName(fileName),
+      m_contacts(0),
+      m_file(0),
+      m_records(0),
+      m_recordsSize(0),
+      m_streamVersion(QDataStream::Qt_5_0)
+{
+}
+
+ContactsSnapshot::~ContactsSnapshot()
+{
+    release();
+}
+
+QString ContactsSnapshot::fileName() const
+{
+    return m_fileName;
+}
+
+ContactsMap *ContactsSnapshot::contacts() const
+{
+    return m_contacts;
+}
+
+bool ContactsSnapshot::load()
+{
+    release();
+
+    QScopedPointer<QFile> file(new QFile(m_fileName));
+    if (!file->exists()) {
+        return false;
+    }
+
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning() << "Fail to open contacts snapshot" << m_fileName << file->errorString();
+        return false;
+    }
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    // the file is unmapped when it is closed
+    uchar *mapped = file->map(0, file->size());
+    if (!mapped) {
+        qWarning() << "Fail to map contacts snapshot" << m_fileName << file->errorString();
+        return false;
+    }
+
+    // avoid copy the file contents, the stream reads directly from the mapped memory
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), file->size());
+    QDataStream stream(data);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 streamVersion = 0;
+    quint32 count = 0;
+    stream >> magic >> version >> streamVersion >> count;
+    if ((magic != SNAPSHOT_MAGIC) ||
+        (version != SNAPSHOT_VERSION) ||
+        (stream.status() != QDataStream::Ok) ||
+        ((qint64(count) * sizeof(quint32)) > file->size())) {
+        qWarning() << "Invalid contacts snapshot" << m_fileName;
+        return false;
+    }
+    stream.setVersion(streamVersion);
+
+    QVector<quint32> offsets(count);
+    for(quint32 i = 0; i < count; i++) {
+        stream >> offsets[i];
+    }
+    const qint64 recordsStart = stream.device()->pos();
+
+    // the full contacts are read later from these offsets, all of them must be
+    // inside the mapped file
+    bool validOffsets = (stream.status() == QDataStream::Ok);
+    for(quint32 i = 0; validOffsets && (i < count); i++) {
+        validOffsets = ((recordsStart + offsets[i]) < file->size());
+    }
+    if (!validOffsets) {
+        qWarning() << "Invalid contacts snapshot" << m_fileName;
+        return false;
+    }
+
+    // only the summary contacts are decoded, the full contacts are decoded on demand
+    const QList<QContactDetail::DetailType> types = summaryTypes();
+    QList<QIndividual*> individuals;
+    QHash<QString, QByteArray> digests;
+    for(quint32 i = 0; i < count; i++) {
+        if (!stream.device()->seek(recordsStart + offsets[i])) {
+            break;
+        }
+
+        QString id;
+        bool visible;
+        QDateTime deletedAt;
+        QByteArray digest;
+        QByteArray summaryData;
+        QList<QContact> summary;
+
+        stream >> id >> visible >> deletedAt >> digest >> summaryData;
+        if ((stream.status() != QDataStream::Ok) ||
+            !ContactCodec::decode(summaryData, &summary) ||
+            (summary.size() != 1)) {
+            break;
+        }
+
+        QIndividual *individual = new QIndividual(id, summary.first(), types, deletedAt,
+                                                  [this, i]() { return loadContact(i); });
+        individual->setVisible(visible);
+        individuals << individual;
+        digests.insert(id, digest);
+    }
+
+    if (individuals.size() != (int) count) {
+        qWarning() << "Corrupted contacts snapshot" << m_fileName;
+        qDeleteAll(individuals);
+        return false;
+    }
+
+    m_file = file.take();
+    m_records = reinterpret_cast<const char*>(mapped) + recordsStart;
+    m_recordsSize = m_file->size() - recordsStart;
+    m_streamVersion = streamVersion;
+    m_offsets = offsets;
+    m_digests = digests;
+
+    m_contacts = new ContactsMap;
+    Q_FOREACH(QIndividual *individual, individuals) {
+        m_contacts->insert(new ContactEntry(individual));
+    }
+
+    qDebug() << "Contacts snapshot loaded" << m_contacts->size() << "contacts in" << elapsed.elapsed() << "ms";
+    return true;
+}
+
+QContact ContactsSnapshot::loadContact(int index) const
+{
+    // called by any thread loading the contact, each call uses its own stream
+    if ((index < 0) || (index >= m_offsets.size()) || (m_offsets[index] >= m_recordsSize)) {
+        qWarning() << "Invalid contact on snapshot" << m_fileName << index;
+        return QContact();
+    }
+
+    // the stream is limited to the mapped records, a length past the end of the
+    // file fails the read instead of reading outside of the map
+    const quint32 offset = m_offsets[index];
+    QDataStream stream(QByteArray::fromRawData(m_records + offset, m_recordsSize - offset));
+    stream.setVersion(m_streamVersion);
+
+    QString id;
+    bool visible;
+    QDateTime deletedAt;
+    QByteArray digest;
+    QByteArray summaryData;
+    QByteArray contactData;
+    QList<QContact> contacts;
+
+    stream >> id >> visible >> deletedAt >> digest >> summaryData >> contactData;
+    if ((stream.status() != QDataStream::Ok) ||
+        !ContactCodec::decode(contactData, &contacts) ||
+        (contacts.size() != 1)) {
+        qWarning() << "Fail to load contact from snapshot" << m_fileName << id;
+        return QContact();
+    }
+    return contacts.first();
+}
+
+// the codec writes the details in the contact order with the fields sorted,
+// the same summary has the same digest on any run
+static QByteArray summaryDigest(const QByteArray &summaryData)
+{
+    return QCryptographicHash::hash(summaryData, QCryptographicHash::Sha1);
+}
+
+bool ContactsSnapshot::sync(ContactsMap *contacts,
+                            QSet<QString> *added,
+                            QSet<QString> *removed,
+                            QSet<QString> *changed)
+{
+    // only the summary details are built from the live contacts, the file is
+    // written later by save
+    const QList<QContactDetail::DetailType> types = summaryTypes();
+
+    QSet<QString> oldIds = QSet<QString>::fromList(m_digests.keys());
+    Q_FOREACH(ContactEntry *entry, contacts->values()) {
+        QIndividual *individual = entry->individual();
+        QString id = individual->id();
+        if (!m_digests.contains(id)) {
+            if (added) {
+                added->insert(id);
+            }
+            continue;
+        }
+
+        oldIds.remove(id);
+        if (changed) {
+            QContact summary = QIndividual::copy(individual->contact(types), types);
+            QByteArray digest = summaryDigest(ContactCodec::encode(QList<QContact>() << summary));
+            if (m_digests.value(id) != digest) {
+                changed->insert(id);
+            }
+        }
+    }
+
+    if (removed) {
+        *removed += oldIds;
+    }
+
+    return true;
+}
+
+bool ContactsSnapshot::save(ContactsMap *contacts)
+{
+    const QList<QContactDetail::DetailType> types = summaryTypes();
+
+    QByteArray records;
+    QList<quint32> offsets;
+    QDataStream recordStream(&records, QIODevice::WriteOnly);
+    recordStream.setVersion(QDataStream::Qt_5_0);
+
+    Q_FOREACH(ContactEntry *entry, contacts->values()) {
+        QIndividual *individual = entry->individual();
+        QContact contact = individual->contact();
+        QByteArray summaryData = ContactCodec::encode(QList<QContact>() << QIndividual::copy(contact, types));
+
+        offsets << records.size();
+        recordStream << individual->id()
+                     << individual->isVisible()
+                     << individual->deletedAt()
+                     << summaryDigest(summaryData)
+                     << summaryData
+                     << ContactCodec::encode(QList<QContact>() << contact);
+    }
+
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Fail to write contacts snapshot" << m_fileName << file.errorString();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << (quint32) SNAPSHOT_MAGIC
+           << (quint32) SNAPSHOT_VERSION
+           << (qint32) stream.version()
+           << (quint32) offsets.size();
+    Q_FOREACH(quint32 offset, offsets) {
+        stream << offset;
+    }
+    stream.writeRawData(records.constData(), records.size());
+
+    if (!file.commit()) {
+        qWarning() << "Fail to write contacts snapshot" << m_fileName << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void ContactsSnapshot::release()
+{
+    // the contacts can load details from the file, delete them first
+    if (m_contacts) {
+        delete m_contacts;
+        m_contacts = 0;
+    }
+    if (m_file) {
+        delete m_file;
+        m_file = 0;
+    }
+    m_records = 0;
+    m_recordsSize = 0;
+    m_offsets.clear();
+    m_digests.clear();
+}
+
+QString ContactsSnapshot::defaultFileName()
+{
+    return QString("%1/address-book-service/%2")
+            .arg(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation))
+            .arg(ADDRESS_BOOK_SNAPSHOT_FILE);
+}
+
+bool ContactsSnapshot::isEnabled()
+{
+    QByteArray envSnapshot = qgetenv(ADDRESS_BOOK_SNAPSHOT);
+    return (envSnapshot.isEmpty() || (envSnapshot.toLower() != "off"));
+}
+
+QList<QContactDetail::DetailType> ContactsSnapshot::summaryTypes()
+{
+    // details used by the default sort, the text index and the phone index,
+    // initialized once by the first thread calling it
+    static const QList<QContactDetail::DetailType> types =
+            QList<QContactDetail::DetailType>() << Filter::textDetailTypes()
+                                                << QContactDetail::TypeTag
+                                                << QContactDetail::TypePhoneNumber;
+    return types;
+}
+
+} //namespace
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_CONTACTS_SNAPSHOT_H__
+#define __GALERA_CONTACTS_SNAPSHOT_H__
+
+#include <QtCore/QString>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QByteArray>
+#include <QtCore/QVector>
+
+#include <QtContacts/QContact>
+#include <QtContacts/QContactDetail>
+
+class QFile;
+
+namespace galera
+{
+
+class ContactsMap;
+
+// On-disk copy of the contacts map used to answer queries while folks is
+// still loading the individuals.
+//
+// File layout (QDataStream, big endian):
+//   header:  magic, format version, QDataStream version, record count
+//   index:   one quint32 offset per record, relative to the first record
+//   records: contact id, visible flag, deleted date, summary digest,
+//            summary contact and full contact (both encoded by ContactCodec)
+//
+// Records are stored in the map sort order. Only the summary contacts (the
+// details used by the sort and by the map indexes) are decoded while loading,
+// the full contact is decoded from the mapped file on the first use.
+// sync only compares the summaries with the live contacts, save writes the file.
+class ContactsSnapshot
+{
+public:
+    ContactsSnapshot(const QString &fileName = defaultFileName());
+    ~ContactsSnapshot();
+
+    QString fileName() const;
+    ContactsMap *contacts() const;
+
+    bool load();
+    bool save(ContactsMap *contacts);
+    bool sync(ContactsMap *contacts,
+              QSet<QString> *added,
+              QSet<QString> *removed,
+              QSet<QString> *changed);
+    void release();
+
+    static QString defaultFileName();
+    static bool isEnabled();
+    // detail types stored on the summary contacts
+    static QList<QtContacts::QContactDetail::DetailType> summaryTypes();
+
+private:
+    QString m_fileName;
+    ContactsMap *m_contacts;
+    // the file is kept mapped while the contacts are used
+    QFile *m_file;
+    const char *m_records;
+    qint64 m_recordsSize;
+    int m_streamVersion;
+    QVector<quint32> m_offsets;
+    // summary digests loaded from disk, used to detect changes during the sync
+    QHash<QString, QByteArray> m_digests;
+
+    QtContacts::QContact loadContact(int index) const;
+
+    ContactsSnapshot(const ContactsSnapshot &);
+};
+
+} //namespace
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "eds-client-pool.h"
+
+#include "config.h"
+
+#include <QtCore/QDebug>
+
+#include <libebook/libebook.h>
+
+namespace galera
+{
+
+ESourceRegistry *EdsClientPool::m_registry = 0;
+QHash<QString, EdsClientPool::Connection*> EdsClientPool::m_connections;
+
+ESourceRegistry *EdsClientPool::registry()
+{
+    if (!m_registry) {
+        GError *error = NULL;
+        m_registry = e_source_registry_new_sync(NULL, &error);
+        if (error) {
+            qWarning() << "Fail to connect with source registry" << error->message;
+            g_error_free(error);
+            m_registry = 0;
+        }
+    }
+    return m_registry;
+}
+
+void EdsClientPool::client(ESource *source, const ClientCallback &callback)
+{
+    QString sourceUid = QString::fromUtf8(e_source_get_uid(source));
+    Connection *connection = m_connections.value(sourceUid, 0);
+    if (connection && connection->client) {
+        callback(connection->client);
+        return;
+    }
+
+    if (connection) {
+        connection->callbacks << callback;
+        return;
+    }
+
+    connection = new Connection;
+    connection->sourceUid = sourceUid;
+    connection->client = 0;
+    connection->callbacks << callback;
+    m_connections.insert(sourceUid, connection);
+    E_BOOK_CLIENT_CONNECT(source, NULL, (GAsyncReadyCallback) clientConnected, connection);
+}
+
+void EdsClientPool::invalidate(const QString &sourceUid)
+{
+    QList<Connection*> connections;
+    if (sourceUid.isEmpty()) {
+        connections = m_connections.values();
+        m_connections.clear();
+        if (m_registry) {
+            g_object_unref(m_registry);
+            m_registry = 0;
+        }
+    } else if (m_connections.contains(sourceUid)) {
+        connections << m_connections.take(sourceUid);
+    }
+
+    Q_FOREACH(Connection *connection, connections) {
+        // a connection still running is destroyed by clientConnected
+        if (connection->client) {
+            g_object_unref(connection->client);
+            delete connection;
+        }
+    }
+}
+
+void EdsClientPool::clientConnected(GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    Q_UNUSED(source);
+    Connection *connection = static_cast<Connection*>(userdata);
+
+    GError *error = NULL;
+    EClient *client = e_book_client_connect_finish(result, &error);
+    if (error) {
+        qWarning() << "Fail to connect with EDS" << error->message;
+        g_error_free(error);
+        client = 0;
+    }
+
+    // the requests done before an invalidation still receive the client
+    QList<ClientCallback> callbacks = connection->callbacks;
+    connection->callbacks.clear();
+    bool valid = (m_connections.value(connection->sourceUid, 0) == connection);
+    bool keep = (client && valid);
+    if (keep) {
+        connection->client = E_BOOK_CLIENT(client);
+    } else {
+        if (valid) {
+            // try again on the next request
+            m_connections.remove(connection->sourceUid);
+        }
+        delete connection;
+    }
+
+    Q_FOREACH(const ClientCallback &callback, callbacks) {
+        callback(client ? E_BOOK_CLIENT(client) : 0);
+    }
+
+    if (client && !keep) {
+        g_object_unref(client);
+    }
+}
+
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_EDS_CLIENT_POOL_H__
+#define __GALERA_EDS_CLIENT_POOL_H__
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+#include <functional>
+
+#include <glib-object.h>
+
+typedef struct _ESource ESource;
+typedef struct _ESourceRegistry ESourceRegistry;
+typedef struct _EBookClient EBookClient;
+
+namespace galera {
+
+// EDS objects shared by the whole service.
+// The source registry is created on the first use and the book clients are
+// connected asynchronously on the first request of each source (by source uid),
+// the requests done while the client is connecting wait for it. The objects are
+// dropped when the source changes or when EDS restarts.
+class EdsClientPool
+{
+public:
+    typedef std::function<void(EBookClient *client)> ClientCallback;
+
+    // returns 0 if the registry is not available, the pool keeps the reference
+    static ESourceRegistry *registry();
+    // the client is 0 if the connection fails, take a reference to keep it after the callback
+    static void client(ESource *source, const ClientCallback &callback);
+    // drop the client of the source, or all clients and the registry if the uid is empty
+    static void invalidate(const QString &sourceUid = QString());
+
+private:
+    class Connection
+    {
+    public:
+        QString sourceUid;
+        EBookClient *client;
+        // requests waiting for the client
+        QList<ClientCallback> callbacks;
+    };
+
+    static ESourceRegistry *m_registry;
+    static QHash<QString, Connection*> m_connections;
+
+    static void clientConnected(GObject *source, GAsyncResult *result, gpointer userdata);
+};
+
+}
+
+#endif
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "parallel-filter.h"
+#include "contact-sort-key.h"
+#include "contacts-map.h"
+#include "qindividual.h"
+
+#include <QtCore/QPair>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+// lists with less contacts than that are tested by a single thread
+#define PARALLEL_FILTER_MIN_CHUNK_SIZE  512
+
+namespace galera
+{
+
+// the chunk tasks never wait on each other so they do not share the global
+// thread pool with the view filters waiting for them
+Q_GLOBAL_STATIC(QThreadPool, filterPool)
+
+// strict weak ordering on the sort keys cached by the individuals, equal
+// contacts are not less than each other
+class SortKeyLessThan
+{
+public:
+    SortKeyLessThan(const SortClause &sort)
+        : m_sort(sort),
+          m_sortOrders(sort.toContactSortOrder()),
+          m_sortKeyName(ContactSortKey::name(sort))
+    {
+    }
+
+    ContactSortKey key(ContactEntry *entry) const
+    {
+        return entry->individual()->sortKey(m_sort, m_sortKeyName);
+    }
+
+    int compare(const ContactSortKey &a, const ContactSortKey &b) const
+    {
+        return a.compare(b, m_sortOrders);
+    }
+
+    bool operator()(ContactEntry *a, ContactEntry *b) const
+    {
+        return (compare(key(a), key(b)) < 0);
+    }
+
+private:
+    SortClause m_sort;
+    QList<QtContacts::QContactSortOrder> m_sortOrders;
+    QString m_sortKeyName;
+};
+
+class ParallelFilter::ChunkTask : public QRunnable
+{
+public:
+    ChunkTask(const ParallelFilter *filter, const QList<ContactEntry*> &candidates, Chunk *chunk,
+              const SortClause &sort, int maxCount, QSemaphore *done)
+        : m_filter(filter),
+          m_candidates(candidates),
+          m_chunk(chunk),
+          m_sort(sort),
+          m_maxCount(maxCount),
+          m_done(done)
+    {
+    }
+
+    void run()
+    {
+        m_filter->filterChunk(m_candidates, m_chunk, m_sort, m_maxCount);
+        m_done->release();
+    }
+
+private:
+    const ParallelFilter *m_filter;
+    const QList<ContactEntry*> &m_candidates;
+    Chunk *m_chunk;
+    const SortClause &m_sort;
+    int m_maxCount;
+    QSemaphore *m_done;
+};
+
+ParallelFilter::ParallelFilter(const AcceptFunction &accept, const CanceledFunction &isCanceled)
+    : m_accept(accept),
+      m_isCanceled(isCanceled)
+{
+}
+
+QList<ContactEntry*> ParallelFilter::filter(const QList<ContactEntry*> &candidates,
+                                            const SortClause &sort,
+                                            int maxCount) const
+{
+    int chunkCount = qMax(1, qMin(threadCount(), candidates.size() / PARALLEL_FILTER_MIN_CHUNK_SIZE));
+    int chunkSize = candidates.size() / chunkCount;
+    QList<Chunk> chunks;
+    for(int i = 0; i < chunkCount; i++) {
+        Chunk chunk;
+        chunk.begin = i * chunkSize;
+        chunk.end = (i == (chunkCount - 1)) ? candidates.size() : chunk.begin + chunkSize;
+        chunks << chunk;
+    }
+
+    QSemaphore done;
+    for(int i = 1; i < chunks.size(); i++) {
+        filterPool()->start(new ChunkTask(this, candidates, &chunks[i], sort, maxCount, &done));
+    }
+    filterChunk(candidates, &chunks[0], sort, maxCount);
+    done.acquire(chunks.size() - 1);
+
+    if (m_isCanceled()) {
+        return QList<ContactEntry*>();
+    }
+    return merge(chunks, sort, maxCount);
+}
+
+int ParallelFilter::threadCount()
+{
+    return filterPool()->maxThreadCount();
+}
+
+void ParallelFilter::setThreadCount(int count)
+{
+    filterPool()->setMaxThreadCount(qMax(1, count));
+}
+
+// a sorted chunk keeps only its first maxCount contacts, the others can not be in the result
+void ParallelFilter::filterChunk(const QList<ContactEntry*> &candidates, Chunk *chunk,
+                                 const SortClause &sort, int maxCount) const
+{
+    SortKeyLessThan lessThan(sort);
+    // bounded max heap of the first maxCount contacts, the position on the candidates
+    // list breaks the ties to give the same order as a stable sort
+    struct HeapItem {
+        ContactEntry *entry;
+        ContactSortKey key;
+        int pos;
+    };
+    QVector<HeapItem> heap;
+    auto heapLessThan = [&lessThan] (const HeapItem &a, const HeapItem &b) {
+        int r = lessThan.compare(a.key, b.key);
+        return (r < 0) || ((r == 0) && (a.pos < b.pos));
+    };
+    bool topK = !sort.isEmpty() && (maxCount > 0);
+    if (topK) {
+        heap.reserve(maxCount + 1);
+    }
+
+    for(int i = chunk->begin; i < chunk->end; i++) {
+        if (m_isCanceled()) {
+            return;
+        }
+
+        ContactEntry *entry = candidates[i];
+        if (!m_accept(entry)) {
+            continue;
+        }
+
+        if (topK) {
+            HeapItem item = { entry, lessThan.key(entry), i };
+            if ((heap.size() == maxCount) && !heapLessThan(item, heap.first())) {
+                continue;
+            }
+            heap.append(item);
+            std::push_heap(heap.begin(), heap.end(), heapLessThan);
+            if (heap.size() > maxCount) {
+                std::pop_heap(heap.begin(), heap.end(), heapLessThan);
+                heap.removeLast();
+            }
+        } else {
+            chunk->contacts.append(entry);
+            // the candidates are already in the requested order
+            if (sort.isEmpty() && (maxCount > 0) && (chunk->contacts.size() >= maxCount)) {
+                break;
+            }
+        }
+    }
+
+    if (topK) {
+        std::sort_heap(heap.begin(), heap.end(), heapLessThan);
+        chunk->contacts.reserve(heap.size());
+        Q_FOREACH(const HeapItem &item, heap) {
+            chunk->contacts.append(item.entry);
+        }
+    } else if (!sort.isEmpty()) {
+        qStableSort(chunk->contacts.begin(), chunk->contacts.end(), lessThan);
+    }
+}
+
+// equal contacts keep the candidates order
+QList<ContactEntry*> ParallelFilter::merge(const QList<Chunk> &chunks, const SortClause &sort, int maxCount)
+{
+    QList<ContactEntry*> result;
+    if (sort.isEmpty()) {
+        Q_FOREACH(const Chunk &chunk, chunks) {
+            result << chunk.contacts;
+        }
+    } else if (chunks.size() == 1) {
+        result = chunks[0].contacts;
+    } else {
+        // the first chunk wins the ties
+        SortKeyLessThan lessThan(sort);
+        QVector<int> heads(chunks.size(), 0);
+        while ((maxCount <= 0) || (result.size() < maxCount)) {
+            int next = -1;
+            for(int i = 0; i < chunks.size(); i++) {
+                if ((heads[i] < chunks[i].contacts.size()) &&
+                    ((next == -1) ||
+                     lessThan(chunks[i].contacts[heads[i]], chunks[next].contacts[heads[next]]))) {
+                    next = i;
+                }
+            }
+
+            if (next == -1) {
+                break;
+            }
+            result << chunks[next].contacts[heads[next]++];
+        }
+    }
+
+    if ((maxCount > 0) && (result.size() > maxCount)) {
+        result.erase(result.begin() + maxCount, result.end());
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_PARALLEL_FILTER_H__
+#define __GALERA_PARALLEL_FILTER_H__
+
+#include "common/sort-clause.h"
+
+#include <QtCore/QList>
+
+#include <functional>
+
+namespace galera {
+
+class ContactEntry;
+
+// Tests a list of contacts using all cores.
+// The list is split in one chunk per thread, the first chunk is tested on the calling
+// thread and the others on a dedicated thread pool. The partial results are merged
+// in the list order, or with a k-way merge when the results must be sorted.
+class ParallelFilter
+{
+public:
+    typedef std::function<bool(ContactEntry *entry)> AcceptFunction;
+    typedef std::function<bool()> CanceledFunction;
+
+    ParallelFilter(const AcceptFunction &accept, const CanceledFunction &isCanceled);
+
+    // returns at most maxCount (if > 0) accepted contacts sorted by sort clause,
+    // or in the candidates order if the sort clause is empty
+    QList<ContactEntry*> filter(const QList<ContactEntry*> &candidates,
+                                const SortClause &sort,
+                                int maxCount) const;
+
+    // number of threads used by a filter (default: number of cores)
+    static int threadCount();
+    static void setThreadCount(int count);
+
+private:
+    class Chunk
+    {
+    public:
+        int begin;
+        int end;
+        QList<ContactEntry*> contacts;
+    };
+    class ChunkTask;
+
+    AcceptFunction m_accept;
+    CanceledFunction m_isCanceled;
+
+    void filterChunk(const QList<ContactEntry*> &candidates, Chunk *chunk,
+                     const SortClause &sort, int maxCount) const;
+    static QList<ContactEntry*> merge(const QList<Chunk> &chunks, const SortClause &sort, int maxCount);
+};
+
+}
+
+#endif
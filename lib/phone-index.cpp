@@ -0,0 +1,351 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "phone-index.h"
+
+#include <QtCore/QSet>
+
+#include <phonenumbers/phonenumberutil.h>
+
+#include <algorithm>
+
+// number of digits used to match phone numbers (see: minimalNumber)
+#define PHONE_INDEX_MINIMAL_LENGTH  7
+// number of trie nodes on each page
+#define PHONE_TRIE_PAGE_SIZE        64
+
+namespace
+{
+
+bool childLessThan(const QPair<QChar, int> &child, QChar c)
+{
+    return child.first < c;
+}
+
+}
+
+namespace galera
+{
+
+//PhoneTrie
+PhoneTrie::PhoneTrie()
+    : m_nodeCount(0)
+{
+    clear();
+}
+
+void PhoneTrie::insert(const QString &key, ContactEntry *entry)
+{
+    int node = 0;
+    for(int i = 0; i < key.length(); i++) {
+        int next = child(node, key.at(i));
+        if (next == -1) {
+            next = addChild(node, key.at(i));
+        }
+        node = next;
+    }
+    writableNode(node).entries << entry;
+}
+
+void PhoneTrie::remove(const QString &key, ContactEntry *entry)
+{
+    QVector<int> path;
+    path.reserve(key.length() + 1);
+
+    int node = 0;
+    path << node;
+    for(int i = 0; i < key.length(); i++) {
+        node = child(node, key.at(i));
+        if (node == -1) {
+            return;
+        }
+        path << node;
+    }
+
+    if (!nodeAt(node).entries.contains(entry)) {
+        return;
+    }
+    writableNode(node).entries.removeOne(entry);
+
+    // release empty nodes, from the leaf to the root
+    for(int i = path.size() - 1; i > 0; i--) {
+        const Node &n = nodeAt(path[i]);
+        if (!n.children.isEmpty() || !n.entries.isEmpty()) {
+            break;
+        }
+
+        QVector<QPair<QChar, int> > &siblings = writableNode(path[i - 1]).children;
+        QVector<QPair<QChar, int> >::iterator it =
+                std::lower_bound(siblings.begin(), siblings.end(), key.at(i - 1), childLessThan);
+        siblings.erase(it);
+        m_freeNodes << path[i];
+    }
+}
+
+void PhoneTrie::clear()
+{
+    m_pages.clear();
+    m_freeNodes.clear();
+    // root
+    m_pages.append(QVector<Node>(PHONE_TRIE_PAGE_SIZE));
+    m_nodeCount = 1;
+}
+
+QList<ContactEntry*> PhoneTrie::exact(const QString &key) const
+{
+    int node = find(key);
+    if (node == -1) {
+        return QList<ContactEntry*>();
+    }
+    return nodeAt(node).entries;
+}
+
+QList<ContactEntry*> PhoneTrie::startsWith(const QString &key) const
+{
+    QList<ContactEntry*> result;
+    int node = find(key);
+    if (node != -1) {
+        collect(node, &result);
+    }
+    return result;
+}
+
+const PhoneTrie::Node &PhoneTrie::nodeAt(int node) const
+{
+    return m_pages.at(node / PHONE_TRIE_PAGE_SIZE).at(node % PHONE_TRIE_PAGE_SIZE);
+}
+
+PhoneTrie::Node &PhoneTrie::writableNode(int node)
+{
+    return m_pages[node / PHONE_TRIE_PAGE_SIZE][node % PHONE_TRIE_PAGE_SIZE];
+}
+
+int PhoneTrie::find(const QString &key) const
+{
+    int node = 0;
+    for(int i = 0; (i < key.length()) && (node != -1); i++) {
+        node = child(node, key.at(i));
+    }
+    return node;
+}
+
+int PhoneTrie::child(int node, QChar c) const
+{
+    const QVector<QPair<QChar, int> > &children = nodeAt(node).children;
+    QVector<QPair<QChar, int> >::const_iterator it =
+            std::lower_bound(children.begin(), children.end(), c, childLessThan);
+    if ((it != children.end()) && (it->first == c)) {
+        return it->second;
+    }
+    return -1;
+}
+
+int PhoneTrie::addChild(int node, QChar c)
+{
+    int newNode;
+    if (m_freeNodes.isEmpty()) {
+        newNode = m_nodeCount++;
+        if ((newNode % PHONE_TRIE_PAGE_SIZE) == 0) {
+            m_pages.append(QVector<Node>(PHONE_TRIE_PAGE_SIZE));
+        }
+    } else {
+        newNode = m_freeNodes.takeLast();
+    }
+
+    // the page list can be reallocated above, get the reference after that
+    QVector<QPair<QChar, int> > &children = writableNode(node).children;
+    QVector<QPair<QChar, int> >::iterator it =
+            std::lower_bound(children.begin(), children.end(), c, childLessThan);
+    children.insert(it, qMakePair(c, newNode));
+    return newNode;
+}
+
+void PhoneTrie::collect(int node, QList<ContactEntry*> *result) const
+{
+    const Node &n = nodeAt(node);
+    *result += n.entries;
+    for(int i = 0; i < n.children.size(); i++) {
+        collect(n.children[i].second, result);
+    }
+}
+
+//PhoneIndex
+PhoneIndex::PhoneIndex()
+    : m_size(0)
+{
+}
+
+void PhoneIndex::insert(ContactEntry *entry, const QStringList &numbers)
+{
+    QStringList normalizedNumbers;
+    Q_FOREACH(const QString &number, numbers) {
+        normalizedNumbers << normalize(number);
+    }
+    insertNormalized(entry, normalizedNumbers);
+}
+
+void PhoneIndex::insert(ContactEntry *entry, const QList<PhoneNumberRecord> &numbers)
+{
+    // the records already contain the diallable chars
+    QStringList normalizedNumbers;
+    Q_FOREACH(const PhoneNumberRecord &number, numbers) {
+        normalizedNumbers << number.diallable();
+    }
+    insertNormalized(entry, normalizedNumbers);
+}
+
+void PhoneIndex::update(ContactEntry *entry, const QStringList &numbers)
+{
+    remove(entry);
+    insert(entry, numbers);
+}
+
+void PhoneIndex::update(ContactEntry *entry, const QList<PhoneNumberRecord> &numbers)
+{
+    remove(entry);
+    insert(entry, numbers);
+}
+
+void PhoneIndex::insertNormalized(ContactEntry *entry, const QStringList &normalizedNumbers)
+{
+    QStringList indexedNumbers;
+    Q_FOREACH(const QString &normalized, normalizedNumbers) {
+        if (normalized.isEmpty()) {
+            continue;
+        }
+        m_reversed.insert(reversed(normalized), entry);
+        m_forward.insert(normalized, entry);
+        indexedNumbers << normalized;
+    }
+
+    if (!indexedNumbers.isEmpty()) {
+        m_entryNumbers[entry] += indexedNumbers;
+        m_size += indexedNumbers.size();
+    }
+}
+
+void PhoneIndex::remove(ContactEntry *entry)
+{
+    QStringList numbers = m_entryNumbers.take(entry);
+    Q_FOREACH(const QString &number, numbers) {
+        m_reversed.remove(reversed(number), entry);
+        m_forward.remove(number, entry);
+    }
+    m_size -= numbers.size();
+}
+
+void PhoneIndex::clear()
+{
+    m_reversed.clear();
+    m_forward.clear();
+    m_entryNumbers.clear();
+    m_size = 0;
+}
+
+int PhoneIndex::size() const
+{
+    return m_size;
+}
+
+QList<ContactEntry*> PhoneIndex::lookup(const QString &phone) const
+{
+    QString key = minimalNumber(phone);
+    if (key.isEmpty()) {
+        return QList<ContactEntry*>();
+    }
+
+    // numbers shorter than the minimal number need to match exactly
+    if (key.length() < PHONE_INDEX_MINIMAL_LENGTH) {
+        return unique(m_reversed.exact(reversed(key)));
+    } else {
+        return unique(m_reversed.startsWith(reversed(key)));
+    }
+}
+
+QList<ContactEntry*> PhoneIndex::exactMatch(const QString &phone) const
+{
+    QString normalized = normalize(phone);
+    if (normalized.isEmpty()) {
+        return QList<ContactEntry*>();
+    }
+    return unique(m_reversed.exact(reversed(normalized)));
+}
+
+QList<ContactEntry*> PhoneIndex::suffixMatch(const QString &suffix) const
+{
+    QString normalized = normalize(suffix);
+    if (normalized.isEmpty()) {
+        return QList<ContactEntry*>();
+    }
+    return unique(m_reversed.startsWith(reversed(normalized)));
+}
+
+QList<ContactEntry*> PhoneIndex::prefixMatch(const QString &prefix) const
+{
+    QString normalized = normalize(prefix);
+    if (normalized.isEmpty()) {
+        return QList<ContactEntry*>();
+    }
+    return unique(m_forward.startsWith(normalized));
+}
+
+QString PhoneIndex::normalize(const QString &phone)
+{
+    static i18n::phonenumbers::PhoneNumberUtil *phonenumberUtil = i18n::phonenumbers::PhoneNumberUtil::GetInstance();
+
+    std::string stdPreprocessedPhone(phone.toStdString());
+    phonenumberUtil->NormalizeDiallableCharsOnly(&stdPreprocessedPhone);
+    return QString::fromStdString(stdPreprocessedPhone);
+}
+
+QString PhoneIndex::minimalNumber(const QString &phone)
+{
+    QString normalized = normalize(phone);
+    if (normalized.length() <= PHONE_INDEX_MINIMAL_LENGTH) {
+        return normalized;
+    }
+
+    return normalized.right(PHONE_INDEX_MINIMAL_LENGTH);
+}
+
+QString PhoneIndex::reversed(const QString &value)
+{
+    QString result(value);
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+QList<ContactEntry*> PhoneIndex::unique(const QList<ContactEntry*> &entries)
+{
+    if (entries.size() < 2) {
+        return entries;
+    }
+
+    // the same contact can have more than one number matching
+    QList<ContactEntry*> result;
+    QSet<ContactEntry*> visited;
+    Q_FOREACH(ContactEntry *entry, entries) {
+        if (!visited.contains(entry)) {
+            visited.insert(entry);
+            result << entry;
+        }
+    }
+    return result;
+}
+
+} //namespace
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_PHONE_INDEX_H__
+#define __GALERA_PHONE_INDEX_H__
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+
+#include "common/phone-number-record.h"
+#include "chunked-hash.h"
+
+namespace galera
+{
+
+class ContactEntry;
+
+// Trie over the diallable chars of the phone numbers, nodes are allocated
+// from implicitly shared pages and the children are kept sorted by char.
+// A copy of the trie only copies the pages changed after it.
+class PhoneTrie
+{
+public:
+    PhoneTrie();
+
+    void insert(const QString &key, ContactEntry *entry);
+    void remove(const QString &key, ContactEntry *entry);
+    void clear();
+
+    // entries stored exactly on the key
+    QList<ContactEntry*> exact(const QString &key) const;
+    // entries stored on the key or on any longer key starting with it
+    QList<ContactEntry*> startsWith(const QString &key) const;
+
+private:
+    struct Node
+    {
+        QVector<QPair<QChar, int> > children;
+        QList<ContactEntry*> entries;
+    };
+
+    QVector<QVector<Node> > m_pages;
+    QVector<int> m_freeNodes;
+    int m_nodeCount;
+
+    const Node &nodeAt(int node) const;
+    // detaches the page of the node
+    Node &writableNode(int node);
+    int find(const QString &key) const;
+    int child(int node, QChar c) const;
+    int addChild(int node, QChar c);
+    void collect(int node, QList<ContactEntry*> *result) const;
+};
+
+class PhoneIndex
+{
+public:
+    PhoneIndex();
+
+    void insert(ContactEntry *entry, const QStringList &numbers);
+    void insert(ContactEntry *entry, const QList<PhoneNumberRecord> &numbers);
+    void update(ContactEntry *entry, const QStringList &numbers);
+    void update(ContactEntry *entry, const QList<PhoneNumberRecord> &numbers);
+    void remove(ContactEntry *entry);
+    void clear();
+    int size() const;
+
+    // entries with the same minimal number (the last 7 diallable chars)
+    QList<ContactEntry*> lookup(const QString &phone) const;
+
+    QList<ContactEntry*> exactMatch(const QString &phone) const;
+    QList<ContactEntry*> suffixMatch(const QString &suffix) const;
+    QList<ContactEntry*> prefixMatch(const QString &prefix) const;
+
+    static QString normalize(const QString &phone);
+    static QString minimalNumber(const QString &phone);
+
+private:
+    // numbers stored reversed, used for exact and suffix lookups
+    PhoneTrie m_reversed;
+    PhoneTrie m_forward;
+    // normalized numbers of each entry
+    ChunkedHash<ContactEntry*, QStringList> m_entryNumbers;
+    int m_size;
+
+    void insertNormalized(ContactEntry *entry, const QStringList &normalizedNumbers);
+
+    static QString reversed(const QString &value);
+    static QList<ContactEntry*> unique(const QList<ContactEntry*> &entries);
+};
+
+} //namespace
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "qindividual.h"
 #include "detail-context-parser.h"
+#include "eds-client-pool.h"
 #include "gee-utils.h"
 #include "update-contact-request.h"
 #include "e-source-ubuntu.h"
@@ -151,12 +152,15 @@ namespace galera
 {
 bool QIndividual::m_autoLink = false;
 QStringList QIndividual::m_supportedExtendedDetails;
+QHash<QByteArray, QList<QContactDetail::DetailType> > QIndividual::m_propertyDetails;
 
 QIndividual::QIndividual(FolksIndividual *individual, FolksIndividualAggregator *aggregator)
     : m_individual(0),
       m_aggregator(aggregator),
       m_contact(0),
+      m_revision(0),
       m_currentUpdate(0),
+      m_dirty(false),
       m_visible(true)
 {
     if (m_supportedExtendedDetails.isEmpty()) {
@@ -169,6 +173,51 @@ QIndividual::QIndividual(FolksIndividual *individual, FolksIndividualAggregator
     setIndividual(individual);
 }
 
+// Create a individual without folks data, used to hold contacts loaded from the snapshot
+QIndividual::QIndividual(const QString &id, const QContact &contact, const QDateTime &deletedAt)
+    : m_individual(0),
+      m_aggregator(0),
+      m_contact(new QContact(contact)),
+      m_revision(0),
+      m_currentUpdate(0),
+      m_id(id),
+      m_dirty(false),
+      m_deletedAt(deletedAt),
+      m_visible(true)
+{
+    m_contact->setId(QContactId("qtcontacts:galera:", m_id.toUtf8()));
+    m_phoneNumbers = PhoneNumberRecord::fromContact(*m_contact);
+    if (m_deletedAt.isNull()) {
+        // avoid check for the deleted date, there is no persona to check
+        m_deletedAt = QDateTime(QDate(), QTime(0, 0, 0));
+    }
+}
+
+QIndividual::QIndividual(const QString &id,
+                         const QContact &summary,
+                         const QList<QContactDetail::DetailType> &summaryTypes,
+                         const QDateTime &deletedAt,
+                         LoadFunction load)
+    : m_individual(0),
+      m_aggregator(0),
+      m_contact(0),
+      m_partialContact(summary),
+      m_partialTypes(summaryTypes),
+      m_revision(0),
+      m_currentUpdate(0),
+      m_id(id),
+      m_load(load),
+      m_dirty(false),
+      m_deletedAt(deletedAt),
+      m_visible(true)
+{
+    m_partialContact.setId(QContactId("qtcontacts:galera:", m_id.toUtf8()));
+    m_phoneNumbers = PhoneNumberRecord::fromContact(m_partialContact);
+    if (m_deletedAt.isNull()) {
+        m_deletedAt = QDateTime(QDate(), QTime(0, 0, 0));
+    }
+}
+
 void QIndividual::notifyUpdate()
 {
     for(int i=0; i < m_listeners.size(); i++) {
@@ -392,15 +441,26 @@ void QIndividual::folksIndividualChanged(FolksIndividual *individual,
                                          QIndividual *self)
 {
     Q_UNUSED(individual);
-    Q_UNUSED(pspec);
 
-    // skip update contact during a contact update, the update will be done after
-    if (self->m_contactLock.tryLock()) {
-        // invalidate contact
-        self->markAsDirty();
-        self->notifyUpdate();
-        self->m_contactLock.unlock();
+    // the details changed by the property
+    QList<QContactDetail::DetailType> types = m_propertyDetails.value(QByteArray(g_param_spec_get_name(pspec)));
+
+    // during a contact update the change is applied when the update finishes
+    if (self->m_currentUpdate) {
+        if (!self->m_dirty) {
+            self->m_dirtyTypes = types;
+        } else if (self->m_dirtyTypes.isEmpty() || types.isEmpty()) {
+            // reload the whole contact
+            self->m_dirtyTypes.clear();
+        } else {
+            self->m_dirtyTypes += types;
+        }
+        self->m_dirty = true;
+        return;
     }
+
+    self->markAsDirty(types);
+    self->notifyUpdate();
 }
 
 QString QIndividual::qStringFromGChar(const gchar *str)
@@ -877,18 +937,187 @@ QtContacts::QContact QIndividual::copy(const QContact &c, QList<QContactDetail::
     return result;
 }
 
-QtContacts::QContact &QIndividual::contact()
+QtContacts::QContact QIndividual::contact()
 {
-    if (!m_contact && m_individual) {
-        QMutexLocker locker(&m_contactLock);
-        updatePersonas();
-        // avoid change on m_contact pointer until the contact is fully loaded
-        QContact contact;
-        contact.setId(QContactId("qtcontacts:galera:", m_id.toUtf8()));
-        updateContact(&contact);
+    QMutexLocker locker(&m_contactLock);
+    if (m_contact || (!m_individual && !m_load)) {
+        return m_contact ? *m_contact : QContact();
+    }
+    uint revision = m_revision;
+    locker.unlock();
+
+    // the contact lock is not held while the details are read from folks
+    QContact contact = loadContact();
+    QList<PhoneNumberRecord> phoneNumbers = PhoneNumberRecord::fromContact(contact);
+
+    locker.relock();
+    if (m_contact) {
+        // loaded by other thread in the mean time
+        return *m_contact;
+    }
+    // the contact is not kept if the individual changed while it was loaded
+    if (revision == m_revision) {
         m_contact = new QContact(contact);
+        m_phoneNumbers = phoneNumbers;
+        m_partialContact = QContact();
+        m_partialTypes.clear();
+    }
+    return contact;
+}
+
+QtContacts::QContact QIndividual::contact(const QList<QContactDetail::DetailType> &types)
+{
+    if (types.isEmpty()) {
+        return contact();
+    }
+
+    QMutexLocker locker(&m_contactLock);
+    if (m_contact || (!m_individual && !m_load)) {
+        return m_contact ? *m_contact : QContact();
+    }
+
+    QList<QContactDetail::DetailType> missing;
+    Q_FOREACH(QContactDetail::DetailType type, types) {
+        if (!m_partialTypes.contains(type)) {
+            missing << type;
+        }
     }
-    return *m_contact;
+    if (missing.isEmpty()) {
+        return m_partialContact;
+    }
+
+    if (!m_individual) {
+        // the load function does not load part of the details
+        locker.unlock();
+        return contact();
+    }
+
+    // the details already loaded are loaded again to keep the details order
+    QList<QContactDetail::DetailType> loadTypes = m_partialTypes + missing;
+    uint revision = m_revision;
+    locker.unlock();
+
+    QContact contact = loadContact(loadTypes);
+    QList<PhoneNumberRecord> phoneNumbers = PhoneNumberRecord::fromContact(contact);
+
+    locker.relock();
+    if (m_contact) {
+        return *m_contact;
+    }
+    // keep the partial contact loaded by other thread if it has more details
+    bool keep = (revision == m_revision);
+    Q_FOREACH(QContactDetail::DetailType type, m_partialTypes) {
+        keep = keep && loadTypes.contains(type);
+    }
+    if (keep) {
+        m_phoneNumbers = phoneNumbers;
+        m_partialContact = contact;
+        m_partialTypes = loadTypes;
+    }
+    return contact;
+}
+
+QtContacts::QContact QIndividual::loadContact(const QList<QContactDetail::DetailType> &types)
+{
+    if (!m_individual) {
+        QContact contact = m_load();
+        contact.setId(QContactId("qtcontacts:galera:", m_id.toUtf8()));
+        return contact;
+    }
+
+    // the personas are shared by the threads loading the contact
+    QMutexLocker locker(&m_personasLock);
+    updatePersonas();
+    QContact contact;
+    contact.setId(QContactId("qtcontacts:galera:", m_id.toUtf8()));
+    updateContact(&contact, types);
+    return contact;
+}
+
+QList<PhoneNumberRecord> QIndividual::phoneNumbers()
+{
+    // the records are created with the contact, process the numbers again only
+    // if the contact changed after it was loaded
+    const QContact c = contact(QList<QContactDetail::DetailType>() << QContactDetail::TypePhoneNumber);
+    const QList<QContactPhoneNumber> numbers = c.details<QContactPhoneNumber>();
+
+    m_contactLock.lock();
+    bool changed = (numbers.size() != m_phoneNumbers.size());
+    for(int i = 0; !changed && (i < numbers.size()); i++) {
+        changed = (numbers[i].number() != m_phoneNumbers[i].number());
+    }
+    QList<PhoneNumberRecord> records = m_phoneNumbers;
+    m_contactLock.unlock();
+
+    if (changed) {
+        records = PhoneNumberRecord::fromContact(c);
+    }
+    return records;
+}
+
+QString QIndividual::vcard(const QString &fieldsKey) const
+{
+    return m_vcards.value(fieldsKey);
+}
+
+void QIndividual::setVcard(const QString &fieldsKey, const QString &vcard, uint revision)
+{
+    // the contact changed while the vcard was being created
+    if (revision != m_revision) {
+        return;
+    }
+    m_vcards.insert(fieldsKey, vcard);
+}
+
+uint QIndividual::revision() const
+{
+    return m_revision;
+}
+
+ContactSortKey QIndividual::sortKey(const SortClause &clause, const QString &name)
+{
+    // the contacts are sorted by the views on the filter thread
+    m_sortKeysLock.lock();
+    QHash<QString, ContactSortKey>::const_iterator i = m_sortKeys.constFind(name);
+    if (i != m_sortKeys.constEnd()) {
+        ContactSortKey key = i.value();
+        m_sortKeysLock.unlock();
+        return key;
+    }
+    uint revision = m_revision;
+    m_sortKeysLock.unlock();
+
+    // the key is created without the lock, loading the contact takes the contact
+    // lock and markAsDirty takes both locks in the opposite order
+    QList<QContactDetail::DetailType> types;
+    Q_FOREACH(const QContactSortOrder &order, clause.toContactSortOrder()) {
+        types << order.detailType();
+    }
+    ContactSortKey key(contact(types), clause);
+
+    QMutexLocker locker(&m_sortKeysLock);
+    i = m_sortKeys.constFind(name);
+    if (i != m_sortKeys.constEnd()) {
+        // created by other thread in the mean time
+        return i.value();
+    }
+    // the contact changed while the key was being created
+    if (revision == m_revision) {
+        m_sortKeys.insert(name, key);
+    }
+    return key;
+}
+
+QString QIndividual::vcardKey(const QList<QContactDetail::DetailType> &fields)
+{
+    // the same set of fields always produces the same vcard, no matter the order
+    QStringList key;
+    Q_FOREACH(QContactDetail::DetailType type, fields) {
+        key << QString::number(type);
+    }
+    key.sort();
+    key.removeDuplicates();
+    return key.join(",");
 }
 
 void QIndividual::updatePersonas()
@@ -896,6 +1125,7 @@ void QIndividual::updatePersonas()
     Q_FOREACH(FolksPersona *p, m_personas.values()) {
         g_object_unref(p);
     }
+    m_personas.clear();
 
     GeeSet *personas = folks_individual_get_personas(m_individual);
     if (!personas) {
@@ -912,12 +1142,20 @@ void QIndividual::updatePersonas()
     g_object_unref(iter);
 }
 
-void QIndividual::updateContact(QContact *contact) const
+// the details used by the display label are always loaded, the avatar is only
+// loaded if requested since it can be stored on the avatar cache
+void QIndividual::updateContact(QContact *contact,
+                                const QList<QContactDetail::DetailType> &types,
+                                const QContact *loaded) const
 {
     if (!m_individual) {
         return;
     }
 
+    auto load = [&types] (QContactDetail::DetailType type) {
+        return types.isEmpty() || types.contains(type);
+    };
+
     contact->appendDetail(getUid());
     Q_FOREACH(QContactDetail detail, getSyncTargets()) {
         contact->appendDetail(detail);
@@ -939,9 +1177,11 @@ void QIndividual::updateContact(QContact *contact) const
 
         // vcard only support one of these details by contact
         if (personaIndex == 1) {
-            appendDetailsForPersona(contact,
-                                    getTimeStamp(persona, personaIndex),
-                                    true);
+            if (load(QContactDetail::TypeTimestamp)) {
+                appendDetailsForPersona(contact,
+                                        getTimeStamp(persona, personaIndex),
+                                        true);
+            }
             appendDetailsForPersona(contact,
                                     getPersonaName(persona, personaIndex),
                                     !wPropList.contains("structured-name"));
@@ -951,15 +1191,27 @@ void QIndividual::updateContact(QContact *contact) const
             appendDetailsForPersona(contact,
                                     getPersonaNickName(persona, personaIndex),
                                     !wPropList.contains("structured-name"));
-            appendDetailsForPersona(contact,
-                                    getPersonaBirthday(persona, personaIndex),
-                                    !wPropList.contains("birthday"));
-            appendDetailsForPersona(contact,
-                                    getPersonaPhoto(persona, personaIndex),
-                                    !wPropList.contains("avatar"));
-            appendDetailsForPersona(contact,
-                                    getPersonaFavorite(persona, personaIndex),
-                                    !wPropList.contains("is-favourite"));
+            if (load(QContactDetail::TypeBirthday)) {
+                appendDetailsForPersona(contact,
+                                        getPersonaBirthday(persona, personaIndex),
+                                        !wPropList.contains("birthday"));
+            } else if (loaded) {
+                appendLoadedDetails(contact, *loaded, QContactDetail::TypeBirthday, personaIndex);
+            }
+            if (load(QContactDetail::TypeAvatar)) {
+                appendDetailsForPersona(contact,
+                                        getPersonaPhoto(persona, personaIndex),
+                                        !wPropList.contains("avatar"));
+            } else if (loaded) {
+                appendLoadedDetails(contact, *loaded, QContactDetail::TypeAvatar, personaIndex);
+            }
+            if (load(QContactDetail::TypeFavorite)) {
+                appendDetailsForPersona(contact,
+                                        getPersonaFavorite(persona, personaIndex),
+                                        !wPropList.contains("is-favourite"));
+            } else if (loaded) {
+                appendLoadedDetails(contact, *loaded, QContactDetail::TypeFavorite, personaIndex);
+            }
         }
 
         QList<QContactDetail> details;
@@ -985,26 +1237,38 @@ void QIndividual::updateContact(QContact *contact) const
                                 prefDetail,
                                 !wPropList.contains("phone-numbers"));
 
-        details = getPersonaAddresses(persona, &prefDetail, personaIndex);
-        appendDetailsForPersona(contact,
-                                details,
-                                VCardParser::PreferredActionNames[QContactAddress::Type],
-                                prefDetail,
-                                !wPropList.contains("postal-addresses"));
+        if (load(QContactDetail::TypeAddress)) {
+            details = getPersonaAddresses(persona, &prefDetail, personaIndex);
+            appendDetailsForPersona(contact,
+                                    details,
+                                    VCardParser::PreferredActionNames[QContactAddress::Type],
+                                    prefDetail,
+                                    !wPropList.contains("postal-addresses"));
+        } else if (loaded) {
+            appendLoadedDetails(contact, *loaded, QContactDetail::TypeAddress, personaIndex);
+        }
 
-        details = getPersonaIms(persona, &prefDetail, personaIndex);
-        appendDetailsForPersona(contact,
-                                details,
-                                VCardParser::PreferredActionNames[QContactOnlineAccount::Type],
-                                prefDetail,
-                                !wPropList.contains("im-addresses"));
+        if (load(QContactDetail::TypeOnlineAccount)) {
+            details = getPersonaIms(persona, &prefDetail, personaIndex);
+            appendDetailsForPersona(contact,
+                                    details,
+                                    VCardParser::PreferredActionNames[QContactOnlineAccount::Type],
+                                    prefDetail,
+                                    !wPropList.contains("im-addresses"));
+        } else if (loaded) {
+            appendLoadedDetails(contact, *loaded, QContactDetail::TypeOnlineAccount, personaIndex);
+        }
 
-        details = getPersonaUrls(persona, &prefDetail, personaIndex);
-        appendDetailsForPersona(contact,
-                                details,
-                                VCardParser::PreferredActionNames[QContactUrl::Type],
-                                prefDetail,
-                                !wPropList.contains("urls"));
+        if (load(QContactDetail::TypeUrl)) {
+            details = getPersonaUrls(persona, &prefDetail, personaIndex);
+            appendDetailsForPersona(contact,
+                                    details,
+                                    VCardParser::PreferredActionNames[QContactUrl::Type],
+                                    prefDetail,
+                                    !wPropList.contains("urls"));
+        } else if (loaded) {
+            appendLoadedDetails(contact, *loaded, QContactDetail::TypeUrl, personaIndex);
+        }
 
         details = getPersonaExtendedDetails (persona, personaIndex);
         appendDetailsForPersona(contact,
@@ -1044,29 +1308,56 @@ void QIndividual::updateContact(QContact *contact) const
     contact->saveDetail(&normalizedLabel);
 }
 
+void QIndividual::appendLoadedDetails(QContact *contact,
+                                      const QContact &loaded,
+                                      QContactDetail::DetailType type,
+                                      int personaIndex) const
+{
+    // the detail uri starts with the persona index
+    const QString prefix = QString("%1.").arg(personaIndex);
+    const QString action = VCardParser::PreferredActionNames.value(type);
+    const QContactDetail preferred = action.isEmpty() ? QContactDetail() : loaded.preferredDetail(action);
+    Q_FOREACH(const QContactDetail &detail, loaded.details(type)) {
+        if (detail.detailUri().startsWith(prefix)) {
+            contact->appendDetail(detail);
+            if (!preferred.isEmpty() && (detail == preferred)) {
+                contact->setPreferredDetail(action, detail);
+            }
+        }
+    }
+}
+
 bool QIndividual::update(const QtContacts::QContact &newContact, QObject *object, const char *slot)
 {
-    QContact &originalContact = contact();
+    QContact originalContact = contact();
     if (newContact != originalContact) {
-        m_currentUpdate = new UpdateContactRequest(newContact, this, object, slot);
-        if (!m_contactLock.tryLock(5000)) {
-            qWarning() << "Fail to lock contact to update";
-            m_currentUpdate->notifyError("Fail to update contact");
-            m_currentUpdate->deleteLater();
-            m_currentUpdate = 0;
+        if (m_currentUpdate) {
+            qWarning() << "Fail to update contact, other update is running";
+            UpdateContactRequest *request = new UpdateContactRequest(newContact, this, object, slot);
+            request->notifyError("Fail to update contact");
+            request->deleteLater();
             return false;
         }
 
+        m_currentUpdate = new UpdateContactRequest(newContact, this, object, slot);
         m_updateConnection = QObject::connect(m_currentUpdate,
                                               &UpdateContactRequest::done,
                                               [this] (const QString &errorMessage) {
 
+            // apply the folks changes received during the update
+            bool changed = m_dirty;
             if (errorMessage.isEmpty()) {
                 markAsDirty();
+            } else if (m_dirty) {
+                markAsDirty(m_dirtyTypes);
             }
+            m_dirty = false;
+            m_dirtyTypes.clear();
             m_currentUpdate->deleteLater();
             m_currentUpdate = 0;
-            m_contactLock.unlock();
+            if (changed) {
+                notifyUpdate();
+            }
         });
         m_currentUpdate->start();
         return true;
@@ -1089,6 +1380,7 @@ FolksIndividual *QIndividual::individual() const
 
 QList<FolksPersona *> QIndividual::personas() const
 {
+    QMutexLocker locker(&m_personasLock);
     return m_personas.values();
 }
 
@@ -1102,7 +1394,9 @@ void QIndividual::clearPersonas()
 
 void QIndividual::clear()
 {
+    m_personasLock.lock();
     clearPersonas();
+    m_personasLock.unlock();
     if (m_individual) {
         // disconnect any previous handler
         Q_FOREACH(int handlerId, m_notifyConnections) {
@@ -1113,10 +1407,19 @@ void QIndividual::clear()
         m_individual = 0;
     }
 
+    QMutexLocker locker(&m_contactLock);
     if (m_contact) {
         delete m_contact;
         m_contact = 0;
     }
+    m_partialContact = QContact();
+    m_partialTypes.clear();
+    m_phoneNumbers.clear();
+    m_vcards.clear();
+    m_sortKeysLock.lock();
+    m_sortKeys.clear();
+    m_revision++;
+    m_sortKeysLock.unlock();
 }
 
 void QIndividual::addListener(QObject *object, const char *slot)
@@ -1143,12 +1446,16 @@ void QIndividual::flush()
     markAsDirty();
 }
 
-bool QIndividual::markAsDeleted()
+QList<QPair<ESource*, EContact*> > QIndividual::edsContacts() const
 {
-    QString currentDate = QDateTime::currentDateTime().toString(Qt::ISODate);
+    QList<QPair<ESource*, EContact*> > result;
+    if (!m_individual) {
+        return result;
+    }
+
     GeeSet *personas = folks_individual_get_personas(m_individual);
     if (!personas) {
-        return false;
+        return result;
     }
 
     GeeIterator *iter = gee_iterable_iterator(GEE_ITERABLE(personas));
@@ -1156,45 +1463,35 @@ bool QIndividual::markAsDeleted()
         FolksPersona *persona = FOLKS_PERSONA(gee_iterator_get(iter));
         if (EDSF_IS_PERSONA(persona)) {
             FolksPersonaStore *store = folks_persona_get_store(persona);
-            if (!EDSF_IS_PERSONA_STORE(store)) {
-                continue;
-            }
-
-            GError *error = NULL;
-            ESource *source = edsf_persona_store_get_source(EDSF_PERSONA_STORE(store));
-            EClient *client = E_BOOK_CLIENT_CONNECT_SYNC(source, NULL, &error);
-            if (error) {
-                qWarning() << "Fail to connect with EDS" << error->message;
-                g_error_free(error);
-                continue;
+            if (EDSF_IS_PERSONA_STORE(store)) {
+                result << qMakePair(edsf_persona_store_get_source(EDSF_PERSONA_STORE(store)),
+                                    edsf_persona_get_contact(EDSF_PERSONA(persona)));
             }
-
-            EContact *c = edsf_persona_get_contact(EDSF_PERSONA(persona));
-            EVCardAttribute *attr = e_vcard_get_attribute(E_VCARD(c), X_DELETED_AT);
-            if (!attr) {
-                attr = e_vcard_attribute_new("", X_DELETED_AT);
-                e_vcard_add_attribute_with_value(E_VCARD(c), attr,
-                                                 currentDate.toUtf8().constData());
-            } else {
-                e_vcard_attribute_add_value(attr, currentDate.toUtf8().constData());
-            }
-
-            e_book_client_modify_contact_sync(E_BOOK_CLIENT(client), c, NULL, &error);
-            if (error) {
-                qWarning() << "Fail to update EDS contact:" << error->message;
-                g_error_free(error);
-            } else {
-                m_deletedAt = QDateTime::currentDateTime();
-                notifyUpdate();
-            }
-
-            g_object_unref(client);
         }
-        m_personas.insert(qStringFromGChar(folks_persona_get_iid(persona)), persona);
+        g_object_unref(persona);
     }
     g_object_unref(iter);
 
-    return m_deletedAt.isValid();
+    return result;
+}
+
+void QIndividual::markAsDeleted(EContact *contact, const QDateTime &deletedAt)
+{
+    QByteArray date = deletedAt.toString(Qt::ISODate).toUtf8();
+    EVCardAttribute *attr = e_vcard_get_attribute(E_VCARD(contact), X_DELETED_AT);
+    if (!attr) {
+        attr = e_vcard_attribute_new("", X_DELETED_AT);
+        e_vcard_add_attribute_with_value(E_VCARD(contact), attr, date.constData());
+    } else {
+        e_vcard_attribute_remove_values(attr);
+        e_vcard_attribute_add_value(attr, date.constData());
+    }
+}
+
+void QIndividual::setDeletedAt(const QDateTime &deletedAt)
+{
+    m_deletedAt = deletedAt;
+    notifyUpdate();
 }
 
 QDateTime QIndividual::deletedAt()
@@ -1246,8 +1543,6 @@ bool QIndividual::isVisible() const
 
 void QIndividual::setIndividual(FolksIndividual *individual)
 {
-    static QList<QByteArray> individualProperties;
-
     if (m_individual != individual) {
         clear();
 
@@ -1265,42 +1560,36 @@ void QIndividual::setIndividual(FolksIndividual *individual)
         if (m_individual) {
             g_object_ref(m_individual);
 
-            if (individualProperties.isEmpty()) {
-                individualProperties << "alias"
-                                     << "avatar"
-                                     << "birthday"
-                                     << "calendar-event-id"
-                                     << "call-interaction-count"
-                                     << "client-types"
-                                     << "email-addresses"
-                                     << "full-name"
-                                     << "gender"
-                                     << "groups"
-                                     << "id"
-                                     << "im-addresses"
-                                     << "im-interaction-count"
-                                     << "is-favourite"
-                                     << "is-user"
-                                     << "last-call-interaction-datetime"
-                                     << "last-im-interaction-datetime"
-                                     << "local-ids"
-                                     << "location"
-                                     << "nickname"
-                                     << "notes"
-                                     << "personas"
-                                     << "phone-numbers"
-                                     << "postal-addresses"
-                                     << "presence-message"
-                                     << "presence-status"
-                                     << "presence-type"
-                                     << "roles"
-                                     << "structured-name"
-                                     << "trust-level"
-                                     << "urls"
-                                     << "web-service-addresses";
+            if (m_propertyDetails.isEmpty()) {
+                // the properties not exposed on the contact are not monitored
+                // (presence, interactions, location, gender, notes, ...), their
+                // changes would only cause spurious contact updates
+                QList<QContactDetail::DetailType> label;
+                label << QContactDetail::TypeName
+                      << QContactDetail::TypeDisplayLabel
+                      << QContactDetail::TypeNickname;
+
+                // an empty list reloads the whole contact
+                m_propertyDetails.insert("alias", label);
+                m_propertyDetails.insert("avatar", QList<QContactDetail::DetailType>() << QContactDetail::TypeAvatar);
+                m_propertyDetails.insert("birthday", QList<QContactDetail::DetailType>() << QContactDetail::TypeBirthday);
+                m_propertyDetails.insert("email-addresses", QList<QContactDetail::DetailType>() << QContactDetail::TypeEmailAddress);
+                m_propertyDetails.insert("full-name", label);
+                m_propertyDetails.insert("groups", QList<QContactDetail::DetailType>() << QContactDetail::TypeExtendedDetail);
+                m_propertyDetails.insert("id", QList<QContactDetail::DetailType>());
+                m_propertyDetails.insert("im-addresses", QList<QContactDetail::DetailType>() << QContactDetail::TypeOnlineAccount);
+                m_propertyDetails.insert("is-favourite", QList<QContactDetail::DetailType>() << QContactDetail::TypeFavorite);
+                m_propertyDetails.insert("local-ids", QList<QContactDetail::DetailType>());
+                m_propertyDetails.insert("nickname", label);
+                m_propertyDetails.insert("personas", QList<QContactDetail::DetailType>());
+                m_propertyDetails.insert("phone-numbers", QList<QContactDetail::DetailType>() << QContactDetail::TypePhoneNumber);
+                m_propertyDetails.insert("postal-addresses", QList<QContactDetail::DetailType>() << QContactDetail::TypeAddress);
+                m_propertyDetails.insert("roles", QList<QContactDetail::DetailType>() << QContactDetail::TypeOrganization);
+                m_propertyDetails.insert("structured-name", label);
+                m_propertyDetails.insert("urls", QList<QContactDetail::DetailType>() << QContactDetail::TypeUrl);
             }
 
-            Q_FOREACH(const QByteArray &property, individualProperties) {
+            Q_FOREACH(const QByteArray &property, m_propertyDetails.keys()) {
                 uint signalHandler = g_signal_connect(G_OBJECT(m_individual), QByteArray("notify::") + property,
                                                       (GCallback) QIndividual::folksIndividualChanged,
                                                       const_cast<QIndividual*>(this));
@@ -1752,67 +2041,150 @@ QString QIndividual::displayName(const QContact &contact)
 
 void QIndividual::setExtendedDetails(FolksPersona *persona,
                                      const QList<QContactDetail> &xDetails,
-                                     const QDateTime &createdAtDate)
+                                     const QDateTime &createdAtDate,
+                                     const SaveCallback &callback)
 {
     FolksPersonaStore *store = folks_persona_get_store(persona);
     if (EDSF_IS_PERSONA_STORE(store)) {
-        GError *error = NULL;
         ESource *source = edsf_persona_store_get_source(EDSF_PERSONA_STORE(store));
-        EClient *client = E_BOOK_CLIENT_CONNECT_SYNC(source, NULL, &error);
-        if (error) {
-            qWarning() << "Fail to connect with EDS" << error->message;
-            g_error_free(error);
-        } else {
-            EContact *c = edsf_persona_get_contact(EDSF_PERSONA(persona));
+        EContact *c = edsf_persona_get_contact(EDSF_PERSONA(persona));
+
+        // create X-CREATED-AT if it does not exists
+        EVCardAttribute *attr = e_vcard_get_attribute(E_VCARD(c), X_CREATED_AT);
+        if (!attr) {
+            QDateTime createdAt = createdAtDate.isValid() ? createdAtDate : QDateTime::currentDateTime();
+            attr = e_vcard_attribute_new("", X_CREATED_AT);
+            e_vcard_add_attribute_with_value(E_VCARD(c),
+                                             attr,
+                                             createdAt.toUTC().toString(Qt::ISODate).toUtf8().constData());
+        }
+
+        Q_FOREACH(const QContactDetail &d, xDetails) {
+            QContactExtendedDetail xd = static_cast<QContactExtendedDetail>(d);
+            // X_CREATED_AT should not be updated
+            if (xd.name() == X_CREATED_AT) {
+                continue;
+            }
+
+            if (m_supportedExtendedDetails.contains(xd.name())) {
+                // Remove old attribute
+                attr = e_vcard_get_attribute(E_VCARD(c), xd.name().toUtf8().constData());
+                if (attr) {
+                    e_vcard_remove_attribute(E_VCARD(c), attr);
+                }
 
-            // create X-CREATED-AT if it does not exists
-            EVCardAttribute *attr = e_vcard_get_attribute(E_VCARD(c), X_CREATED_AT);
-            if (!attr) {
-                QDateTime createdAt = createdAtDate.isValid() ? createdAtDate : QDateTime::currentDateTime();
-                attr = e_vcard_attribute_new("", X_CREATED_AT);
+                attr = e_vcard_attribute_new("", xd.name().toUtf8().constData());
                 e_vcard_add_attribute_with_value(E_VCARD(c),
                                                  attr,
-                                                 createdAt.toUTC().toString(Qt::ISODate).toUtf8().constData());
+                                                 xd.data().toString().toUtf8().constData());
+            } else {
+                qWarning() << "Extended detail not supported" << xd.name();
             }
+        }
 
-            Q_FOREACH(const QContactDetail &d, xDetails) {
-                QContactExtendedDetail xd = static_cast<QContactExtendedDetail>(d);
-                // X_CREATED_AT should not be updated
-                if (xd.name() == X_CREATED_AT) {
-                    continue;
-                }
-
-                if (m_supportedExtendedDetails.contains(xd.name())) {
-                    // Remove old attribute
-                    attr = e_vcard_get_attribute(E_VCARD(c), xd.name().toUtf8().constData());
-                    if (attr) {
-                        e_vcard_remove_attribute(E_VCARD(c), attr);
-                    }
-
-                    attr = e_vcard_attribute_new("", xd.name().toUtf8().constData());
-                    e_vcard_add_attribute_with_value(E_VCARD(c),
-                                                     attr,
-                                                     xd.data().toString().toUtf8().constData());
-                } else {
-                    qWarning() << "Extended detail not supported" << xd.name();
+        // the persona contact already has the new values, the contact is
+        // saved when the source client is available
+        g_object_ref(c);
+        EdsClientPool::client(source, [c, callback] (EBookClient *client) {
+            if (client) {
+                e_book_client_modify_contact(client, c, NULL,
+                                             (GAsyncReadyCallback) QIndividual::edsContactModified,
+                                             new SaveCallback(callback));
+            } else {
+                qWarning() << "Fail to update EDS contact: no client for the source";
+                if (callback) {
+                    callback("Fail to connect with the contact source");
                 }
             }
+            g_object_unref(c);
+        });
+    } else if (callback) {
+        // nothing to save on other stores
+        callback(QString());
+    }
+}
 
-            e_book_client_modify_contact_sync(E_BOOK_CLIENT(client), c, NULL, &error);
-            if (error) {
-                qWarning() << "Fail to update EDS contact:" << error->message;
-                g_error_free(error);
-            }
-        }
-        g_object_unref(client);
+void QIndividual::edsContactModified(GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    SaveCallback *callback = static_cast<SaveCallback*>(userdata);
+    QString errorMessage;
+    GError *error = NULL;
+    e_book_client_modify_contact_finish(E_BOOK_CLIENT(source), result, &error);
+    if (error) {
+        qWarning() << "Fail to update EDS contact:" << error->message;
+        errorMessage = QString::fromUtf8(error->message);
+        g_error_free(error);
+    }
+    if (*callback) {
+        (*callback)(errorMessage);
     }
+    delete callback;
 }
 
 void QIndividual::markAsDirty()
 {
+    QMutexLocker locker(&m_contactLock);
     delete m_contact;
     m_contact = 0;
+    m_partialContact = QContact();
+    m_partialTypes.clear();
+    m_phoneNumbers.clear();
+    m_vcards.clear();
+    m_sortKeysLock.lock();
+    m_sortKeys.clear();
+    m_revision++;
+    m_sortKeysLock.unlock();
+    m_deletedAt = QDateTime();
+}
+
+void QIndividual::markAsDirty(const QList<QContactDetail::DetailType> &types)
+{
+    if (types.isEmpty()) {
+        markAsDirty();
+        return;
+    }
+
+    m_contactLock.lock();
+    QContact current = m_contact ? *m_contact : QContact();
+    bool loaded = (m_contact != 0);
+    m_contactLock.unlock();
+
+    if (loaded && m_individual) {
+        // the timestamp comes from the vcard revision and the other details
+        // are always loaded
+        QList<QContactDetail::DetailType> reloadTypes = types;
+        reloadTypes << QContactDetail::TypeTimestamp;
+
+        // the details not loaded again are copied from the current contact on the
+        // same position, the contact keeps the detail order of a full load
+        QContact contact;
+        contact.setId(current.id());
+        m_personasLock.lock();
+        updateContact(&contact, reloadTypes, &current);
+        m_personasLock.unlock();
+        QList<PhoneNumberRecord> phoneNumbers = PhoneNumberRecord::fromContact(contact);
+
+        // the contact returned before is not changed, other threads can be using it
+        m_contactLock.lock();
+        delete m_contact;
+        m_contact = new QContact(contact);
+        m_phoneNumbers = phoneNumbers;
+    } else {
+        m_contactLock.lock();
+        delete m_contact;
+        m_contact = 0;
+        m_phoneNumbers.clear();
+    }
+
+    m_partialContact = QContact();
+    m_partialTypes.clear();
+    m_vcards.clear();
+    m_sortKeysLock.lock();
+    m_sortKeys.clear();
+    m_revision++;
+    m_sortKeysLock.unlock();
     m_deletedAt = QDateTime();
+    m_contactLock.unlock();
 }
 
 void QIndividual::enableAutoLink(bool flag)
@@ -21,17 +21,27 @@
 
 #include <QtCore/QString>
 #include <QtCore/QList>
+#include <QtCore/QHash>
 #include <QtCore/QMultiHash>
 #include <QtCore/QMutex>
 #include <QtCore/QDateTime>
+#include <QtCore/QPair>
+
+#include <functional>
 
 #include <QVersitProperty>
 
+#include "common/phone-number-record.h"
+#include "contact-sort-key.h"
+
 #include <QtContacts/QContact>
 #include <QtContacts/QContactDetail>
 
 #include <folks/folks.h>
 
+typedef struct _ESource ESource;
+typedef struct _EContact EContact;
+
 namespace galera
 {
 typedef GHashTable* (*ParseDetailsFunc)(GHashTable*, const QList<QtContacts::QContactDetail> &);
@@ -41,11 +51,34 @@ class UpdateContactRequest;
 class QIndividual
 {
 public:
+    typedef std::function<QtContacts::QContact()> LoadFunction;
+    // called once the contact was saved, the error message is empty on success
+    typedef std::function<void(const QString &errorMessage)> SaveCallback;
+
     QIndividual(FolksIndividual *individual, FolksIndividualAggregator *aggregator);
+    QIndividual(const QString &id, const QtContacts::QContact &contact, const QDateTime &deletedAt);
+    // contact without folks individual, only the summary details are available until
+    // a missing detail is requested, then the whole contact is loaded by "load"
+    QIndividual(const QString &id,
+                const QtContacts::QContact &summary,
+                const QList<QtContacts::QContactDetail::DetailType> &summaryTypes,
+                const QDateTime &deletedAt,
+                LoadFunction load);
     ~QIndividual();
 
     QString id() const;
-    QtContacts::QContact &contact();
+    // the contact is loaded on the first call, it can be called from any thread
+    QtContacts::QContact contact();
+    // contact with at least the detail types (all if empty), the details are loaded
+    // on demand, only the ones used by the display label are always loaded
+    QtContacts::QContact contact(const QList<QtContacts::QContactDetail::DetailType> &types);
+    QList<PhoneNumberRecord> phoneNumbers();
+    // serialized contact cache, the key identifies the fields exported
+    QString vcard(const QString &fieldsKey) const;
+    void setVcard(const QString &fieldsKey, const QString &vcard, uint revision);
+    uint revision() const;
+    // sort values cache, the name identifies the sort clause (ContactSortKey::name)
+    ContactSortKey sortKey(const SortClause &clause, const QString &name);
     QtContacts::QContact copy(QList<QtContacts::QContactDetail::DetailType> fields);
     bool update(const QString &vcard, QObject *object, const char *slot);
     bool update(const QtContacts::QContact &contact, QObject *object, const char *slot);
@@ -55,17 +88,24 @@ public:
     void addListener(QObject *object, const char *slot);
     bool isValid() const;
     void flush();
-    bool markAsDeleted();
     QDateTime deletedAt();
+    void setDeletedAt(const QDateTime &deletedAt);
+    // EDS contacts of the individual personas with their sources, the contacts
+    // and sources are owned by the personas
+    QList<QPair<ESource*, EContact*> > edsContacts() const;
     bool setVisible(bool visible);
     bool isVisible() const;
 
     static QtContacts::QContact copy(const QtContacts::QContact &c, QList<QtContacts::QContactDetail::DetailType> fields);
+    static QString vcardKey(const QList<QtContacts::QContactDetail::DetailType> &fields);
     static GHashTable *parseDetails(const QtContacts::QContact &contact);
     static QString displayName(const QtContacts::QContact &contact);
     static void setExtendedDetails(FolksPersona *persona,
                                    const QList<QtContacts::QContactDetail> &xDetails,
-                                   const QDateTime &createdAt = QDateTime());
+                                   const QDateTime &createdAt,
+                                   const SaveCallback &callback);
+    // set the deleted date on the EDS contact, the contact still need to be saved
+    static void markAsDeleted(EContact *contact, const QDateTime &deletedAt);
 
     // enable or disable auto-link
     static void enableAutoLink(bool flag);
@@ -75,26 +115,58 @@ private:
     FolksIndividual *m_individual;
     FolksIndividualAggregator *m_aggregator;
     QtContacts::QContact *m_contact;
+    // contact with part of the details, used until the full contact is loaded
+    QtContacts::QContact m_partialContact;
+    QList<QtContacts::QContactDetail::DetailType> m_partialTypes;
+    QList<PhoneNumberRecord> m_phoneNumbers;
+    QHash<QString, QString> m_vcards;
+    QHash<QString, ContactSortKey> m_sortKeys;
+    QMutex m_sortKeysLock;
+    uint m_revision;
     UpdateContactRequest *m_currentUpdate;
     QList<QPair<QObject*, QMetaMethod> > m_listeners;
     QMap<QString, FolksPersona*> m_personas;
     QList<uint> m_notifyConnections;
     QString m_id;
     QMetaObject::Connection m_updateConnection;
+    // loads the contact of individuals created without folks individual
+    LoadFunction m_load;
+    // protects the loaded contact state (contacts, phone numbers and revision)
+    // it is never held while the details are read from folks
     QMutex m_contactLock;
+    // protects the personas used to load the contact
+    mutable QMutex m_personasLock;
+    // folks changes received during a contact update, empty types reload the whole contact
+    bool m_dirty;
+    QList<QtContacts::QContactDetail::DetailType> m_dirtyTypes;
     QDateTime m_deletedAt;
     bool m_visible;
     static bool m_autoLink;
     static QStringList m_supportedExtendedDetails;
+    // detail types changed by each folks individual property
+    static QHash<QByteArray, QList<QtContacts::QContactDetail::DetailType> > m_propertyDetails;
 
     QIndividual();
     QIndividual(const QIndividual &);
 
     void notifyUpdate();
+    // read the contact details from the personas
+    QtContacts::QContact loadContact(const QList<QtContacts::QContactDetail::DetailType> &types =
+                                     QList<QtContacts::QContactDetail::DetailType>());
+    static void edsContactModified(GObject *source, GAsyncResult *result, gpointer userdata);
 
     QMultiHash<QString, QString> parseDetails(FolksAbstractFieldDetails *details) const;
     void markAsDirty();
-    void updateContact(QtContacts::QContact *contact) const;
+    // reload only the details of the types (all if empty)
+    void markAsDirty(const QList<QtContacts::QContactDetail::DetailType> &types);
+    // the details of the types not loaded are copied from the loaded contact if any
+    void updateContact(QtContacts::QContact *contact,
+                       const QList<QtContacts::QContactDetail::DetailType> &types = QList<QtContacts::QContactDetail::DetailType>(),
+                       const QtContacts::QContact *loaded = 0) const;
+    void appendLoadedDetails(QtContacts::QContact *contact,
+                             const QtContacts::QContact &loaded,
+                             QtContacts::QContactDetail::DetailType type,
+                             int personaIndex) const;
     void updatePersonas();
     void clearPersonas();
     void clear();
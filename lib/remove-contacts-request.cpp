@@ -0,0 +1,250 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "remove-contacts-request.h"
+#include "eds-client-pool.h"
+#include "qindividual.h"
+
+#include <QtCore/QDebug>
+
+#include <folks/folks-eds.h>
+#include <libebook/libebook.h>
+
+// max number of contacts changed by each EDS call
+#define REMOVE_CONTACTS_BATCH_SIZE 100
+
+namespace galera
+{
+
+RemoveContactsRequest::RemoveContactsRequest(FolksIndividualAggregator *aggregator, bool softRemoval, QObject *parent)
+    : QObject(parent),
+      m_aggregator(FOLKS_INDIVIDUAL_AGGREGATOR(g_object_ref(aggregator))),
+      m_softRemoval(softRemoval),
+      m_pending(0)
+{
+}
+
+RemoveContactsRequest::~RemoveContactsRequest()
+{
+    Q_FOREACH(SourceBatch *batch, m_batches) {
+        Q_FOREACH(EContact *contact, batch->contacts) {
+            g_object_unref(contact);
+        }
+        if (batch->client) {
+            g_object_unref(batch->client);
+        }
+        g_object_unref(batch->source);
+        delete batch;
+    }
+    Q_FOREACH(FolksIndividual *individual, m_individuals) {
+        g_object_unref(individual);
+    }
+    g_object_unref(m_aggregator);
+}
+
+void RemoveContactsRequest::start(const QList<QIndividual*> &individuals)
+{
+    m_deletedAt = QDateTime::currentDateTime();
+
+    // keep the request running until all the operations are started
+    m_pending = 1;
+
+    Q_FOREACH(QIndividual *individual, individuals) {
+        QString id = individual->id();
+        if (!individual->individual() || m_individuals.contains(id)) {
+            continue;
+        }
+
+        QList<QPair<ESource*, EContact*> > contacts = individual->edsContacts();
+        if (contacts.isEmpty()) {
+            removeIndividual(id, individual->individual());
+            continue;
+        }
+
+        // kept for the removal through folks if a persona fails
+        m_individuals.insert(id, FOLKS_INDIVIDUAL(g_object_ref(individual->individual())));
+        m_pendingPersonas.insert(id, contacts.size());
+
+        for(int i = 0; i < contacts.size(); i++) {
+            ESource *source = contacts[i].first;
+            EContact *contact = contacts[i].second;
+            QString sourceId = QString::fromUtf8(e_source_get_uid(source));
+
+            SourceBatch *batch = m_batches.value(sourceId, 0);
+            if (!batch) {
+                batch = new SourceBatch;
+                batch->request = this;
+                batch->source = E_SOURCE(g_object_ref(source));
+                batch->client = 0;
+                batch->offset = 0;
+                batch->count = 0;
+                m_batches.insert(sourceId, batch);
+            }
+
+            if (m_softRemoval) {
+                // the persona contact only changes when EDS notifies the new version
+                EContact *copy = e_contact_duplicate(contact);
+                QIndividual::markAsDeleted(copy, m_deletedAt);
+                batch->contacts << copy;
+            } else {
+                batch->uids << QByteArray((const char*) e_contact_get_const(contact, E_CONTACT_UID));
+            }
+            batch->ids << id;
+        }
+    }
+
+    Q_FOREACH(SourceBatch *batch, m_batches) {
+        m_pending++;
+        EdsClientPool::client(batch->source, [batch] (EBookClient *client) {
+            if (client) {
+                batch->client = E_BOOK_CLIENT(g_object_ref(client));
+                batch->request->sendNext(batch);
+            } else {
+                // nothing was changed on the source
+                batch->count = batch->ids.size() - batch->offset;
+                batch->request->batchDone(batch, false);
+            }
+        });
+    }
+
+    operationDone();
+}
+
+void RemoveContactsRequest::removeIndividual(const QString &id, FolksIndividual *individual)
+{
+    IndividualRemoval *removal = new IndividualRemoval;
+    removal->request = this;
+    removal->id = id;
+    m_pending++;
+    folks_individual_aggregator_remove_individual(m_aggregator,
+                                                  individual,
+                                                  (GAsyncReadyCallback) individualRemoved,
+                                                  removal);
+}
+
+void RemoveContactsRequest::sendNext(SourceBatch *batch)
+{
+    int size = m_softRemoval ? batch->contacts.size() : batch->uids.size();
+    batch->count = qMin(REMOVE_CONTACTS_BATCH_SIZE, size - batch->offset);
+
+    GSList *items = 0;
+    for(int i = batch->offset + batch->count - 1; i >= batch->offset; i--) {
+        if (m_softRemoval) {
+            items = g_slist_prepend(items, batch->contacts[i]);
+        } else {
+            items = g_slist_prepend(items, (gpointer) batch->uids[i].constData());
+        }
+    }
+
+    if (m_softRemoval) {
+        e_book_client_modify_contacts(batch->client, items, NULL,
+                                      (GAsyncReadyCallback) contactsChanged, batch);
+    } else {
+        e_book_client_remove_contacts(batch->client, items, NULL,
+                                      (GAsyncReadyCallback) contactsChanged, batch);
+    }
+    g_slist_free(items);
+}
+
+void RemoveContactsRequest::batchDone(SourceBatch *batch, bool success)
+{
+    QStringList ids = batch->ids.mid(batch->offset, batch->count);
+    batch->offset += batch->count;
+    batch->count = 0;
+
+    // an individual is done when all its personas were changed, if any of them
+    // failed the individual is removed through folks
+    QStringList doneIds;
+    Q_FOREACH(const QString &id, ids) {
+        if (!success) {
+            m_failedIds << id;
+        }
+        if (--m_pendingPersonas[id] > 0) {
+            continue;
+        }
+        m_pendingPersonas.remove(id);
+        if (m_failedIds.contains(id)) {
+            removeIndividual(id, m_individuals.value(id));
+        } else {
+            doneIds << id;
+        }
+    }
+
+    if (!doneIds.isEmpty()) {
+        if (m_softRemoval) {
+            Q_EMIT contactsMarkedAsDeleted(doneIds, m_deletedAt);
+        }
+        m_removedIds += doneIds.toSet();
+    }
+
+    if (batch->offset < batch->ids.size()) {
+        sendNext(batch);
+    } else {
+        operationDone();
+    }
+}
+
+void RemoveContactsRequest::operationDone()
+{
+    if (--m_pending > 0) {
+        return;
+    }
+
+    Q_EMIT done(m_removedIds.size());
+    deleteLater();
+}
+
+void RemoveContactsRequest::contactsChanged(GObject *source, GAsyncResult *result, gpointer userdata)
+{
+    SourceBatch *batch = static_cast<SourceBatch*>(userdata);
+
+    GError *error = 0;
+    if (batch->request->m_softRemoval) {
+        e_book_client_modify_contacts_finish(E_BOOK_CLIENT(source), result, &error);
+    } else {
+        e_book_client_remove_contacts_finish(E_BOOK_CLIENT(source), result, &error);
+    }
+
+    bool success = true;
+    if (error) {
+        qWarning() << "Fail to remove EDS contacts:" << error->message;
+        g_error_free(error);
+        success = false;
+    }
+    batch->request->batchDone(batch, success);
+}
+
+void RemoveContactsRequest::individualRemoved(FolksIndividualAggregator *aggregator, GAsyncResult *result, gpointer userdata)
+{
+    IndividualRemoval *removal = static_cast<IndividualRemoval*>(userdata);
+
+    GError *error = 0;
+    folks_individual_aggregator_remove_individual_finish(aggregator, result, &error);
+    if (error) {
+        qWarning() << "Fail to remove contact:" << error->message;
+        g_error_free(error);
+    } else {
+        removal->request->m_removedIds << removal->id;
+    }
+
+    RemoveContactsRequest *request = removal->request;
+    delete removal;
+    request->operationDone();
+}
+
+}
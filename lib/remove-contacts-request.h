@@ -0,0 +1,107 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_REMOVE_CONTACTS_REQUEST_H__
+#define __GALERA_REMOVE_CONTACTS_REQUEST_H__
+
+#include <QtCore/QObject>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <folks/folks.h>
+
+typedef struct _ESource ESource;
+typedef struct _EContact EContact;
+typedef struct _EBookClient EBookClient;
+
+namespace galera {
+
+class QIndividual;
+
+// Removes a list of contacts.
+// The EDS contacts are grouped by source, the source clients are borrowed from
+// EdsClientPool and each source is changed with a few
+// e_book_client_modify_contacts (soft removal, the contacts are marked as deleted)
+// or e_book_client_remove_contacts calls, the contacts without EDS personas are
+// removed through folks, as are the contacts of a failed EDS call. All calls are
+// asynchronous and the object destroys itself after emitting done.
+class RemoveContactsRequest : public QObject
+{
+    Q_OBJECT
+
+public:
+    RemoveContactsRequest(FolksIndividualAggregator *aggregator, bool softRemoval, QObject *parent = 0);
+    ~RemoveContactsRequest();
+
+    void start(const QList<QIndividual*> &individuals);
+
+Q_SIGNALS:
+    // the contacts still exist on folks, they only have the deleted date set
+    void contactsMarkedAsDeleted(const QStringList &ids, const QDateTime &deletedAt);
+    void done(int removedCount);
+
+private:
+    class SourceBatch
+    {
+    public:
+        RemoveContactsRequest *request;
+        ESource *source;
+        EBookClient *client;
+        // copies of the contacts to modify on soft removal, the uids otherwise
+        QList<EContact*> contacts;
+        QList<QByteArray> uids;
+        // the contact id of each item
+        QStringList ids;
+        int offset;
+        int count;
+    };
+
+    class IndividualRemoval
+    {
+    public:
+        RemoveContactsRequest *request;
+        QString id;
+    };
+
+    FolksIndividualAggregator *m_aggregator;
+    bool m_softRemoval;
+    QDateTime m_deletedAt;
+    QHash<QString, SourceBatch*> m_batches;
+    // the individuals with EDS personas and the number of personas not changed yet
+    QHash<QString, FolksIndividual*> m_individuals;
+    QHash<QString, int> m_pendingPersonas;
+    QSet<QString> m_failedIds;
+    QSet<QString> m_removedIds;
+    int m_pending;
+
+    void removeIndividual(const QString &id, FolksIndividual *individual);
+    void sendNext(SourceBatch *batch);
+    void batchDone(SourceBatch *batch, bool success);
+    void operationDone();
+
+    static void contactsChanged(GObject *source, GAsyncResult *result, gpointer userdata);
+    static void individualRemoved(FolksIndividualAggregator *aggregator, GAsyncResult *result, gpointer userdata);
+};
+
+}
+
+#endif
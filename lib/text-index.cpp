@@ -0,0 +1,229 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "text-index.h"
+
+#include <QtCore/QSet>
+
+#include <algorithm>
+#include <iterator>
+
+#define TEXT_INDEX_GRAM_SIZE    3
+
+namespace galera
+{
+
+TextIndex::TextIndex()
+{
+}
+
+void TextIndex::insert(ContactEntry *entry, const QStringList &values)
+{
+    QSet<QString> entryTrigrams;
+    QSet<QString> entryWords;
+    Q_FOREACH(const QString &value, values) {
+        QString normalized = normalize(value);
+        entryTrigrams += QSet<QString>::fromList(trigrams(normalized));
+        entryWords += QSet<QString>::fromList(words(normalized));
+    }
+
+    Q_FOREACH(const QString &trigram, entryTrigrams) {
+        addPosting(&m_trigrams[trigram], entry);
+    }
+    Q_FOREACH(const QString &word, entryWords) {
+        addPosting(&m_words[wordChunk(word)][word], entry);
+    }
+
+    if (!entryTrigrams.isEmpty()) {
+        m_entryTrigrams.insert(entry, entryTrigrams.toList());
+    }
+    if (!entryWords.isEmpty()) {
+        m_entryWords.insert(entry, entryWords.toList());
+    }
+}
+
+void TextIndex::update(ContactEntry *entry, const QStringList &values)
+{
+    remove(entry);
+    insert(entry, values);
+}
+
+void TextIndex::remove(ContactEntry *entry)
+{
+    Q_FOREACH(const QString &trigram, m_entryTrigrams.take(entry)) {
+        if (m_trigrams.find(trigram)) {
+            QVector<ContactEntry*> &posting = m_trigrams[trigram];
+            removePosting(&posting, entry);
+            if (posting.isEmpty()) {
+                m_trigrams.remove(trigram);
+            }
+        }
+    }
+
+    Q_FOREACH(const QString &word, m_entryWords.take(entry)) {
+        QMap<QString, WordPostings>::iterator chunk = m_words.find(wordChunk(word));
+        if (chunk == m_words.end()) {
+            continue;
+        }
+        WordPostings::iterator it = chunk->find(word);
+        if (it != chunk->end()) {
+            removePosting(&it.value(), entry);
+            if (it.value().isEmpty()) {
+                chunk->erase(it);
+            }
+        }
+        if (chunk->isEmpty()) {
+            m_words.erase(chunk);
+        }
+    }
+}
+
+void TextIndex::clear()
+{
+    m_trigrams.clear();
+    m_words.clear();
+    m_entryTrigrams.clear();
+    m_entryWords.clear();
+}
+
+bool TextIndex::lookup(const QString &text, bool startsWith, QList<ContactEntry*> *result) const
+{
+    result->clear();
+
+    QString normalized = normalize(text);
+    if (normalized.isEmpty()) {
+        return false;
+    }
+
+    if (normalized.length() >= TEXT_INDEX_GRAM_SIZE) {
+        // intersect the posting lists starting with the smallest one
+        QList<const QVector<ContactEntry*>*> postings;
+        Q_FOREACH(const QString &trigram, trigrams(normalized)) {
+            const QVector<ContactEntry*> *posting = m_trigrams.find(trigram);
+            if (!posting) {
+                // no contact contains this trigram
+                return true;
+            }
+            postings << posting;
+        }
+        std::sort(postings.begin(), postings.end(),
+                  [] (const QVector<ContactEntry*> *a, const QVector<ContactEntry*> *b) {
+            return a->size() < b->size();
+        });
+
+        QVector<ContactEntry*> candidates = *postings.first();
+        for(int i = 1; (i < postings.size()) && !candidates.isEmpty(); i++) {
+            QVector<ContactEntry*> intersection;
+            std::set_intersection(candidates.constBegin(), candidates.constEnd(),
+                                  postings[i]->constBegin(), postings[i]->constEnd(),
+                                  std::back_inserter(intersection));
+            candidates = intersection;
+        }
+        *result = candidates.toList();
+        return true;
+    }
+
+    // small texts can only be used as word prefix
+    if (!startsWith) {
+        return false;
+    }
+    for(int i = 0; i < normalized.length(); i++) {
+        if (!normalized.at(i).isLetterOrNumber()) {
+            return false;
+        }
+    }
+
+    // a one char text can match the words of many chunks
+    QSet<ContactEntry*> candidates;
+    const QString prefix = wordChunk(normalized);
+    QMap<QString, WordPostings>::const_iterator chunk = m_words.lowerBound(prefix);
+    for(; (chunk != m_words.constEnd()) && chunk.key().startsWith(prefix); ++chunk) {
+        WordPostings::const_iterator it = chunk->lowerBound(normalized);
+        for(; (it != chunk->constEnd()) && it.key().startsWith(normalized); ++it) {
+            Q_FOREACH(ContactEntry *entry, it.value()) {
+                candidates.insert(entry);
+            }
+        }
+    }
+    *result = candidates.toList();
+    return true;
+}
+
+QString TextIndex::normalize(const QString &value)
+{
+    QString s2 = value.normalized(QString::NormalizationForm_D);
+    QString out;
+    out.reserve(s2.length());
+
+    for (int i=0, j=s2.length(); i<j; i++) {
+        // strip diacritic marks
+        if (s2.at(i).category() != QChar::Mark_NonSpacing &&
+            s2.at(i).category() != QChar::Mark_SpacingCombining) {
+            out.append(s2.at(i));
+        }
+    }
+    return out.toCaseFolded();
+}
+
+QStringList TextIndex::trigrams(const QString &value)
+{
+    QStringList result;
+    for(int i = 0; (i + TEXT_INDEX_GRAM_SIZE) <= value.length(); i++) {
+        result << value.mid(i, TEXT_INDEX_GRAM_SIZE);
+    }
+    return result;
+}
+
+QStringList TextIndex::words(const QString &value)
+{
+    QStringList result;
+    int start = -1;
+    for(int i = 0; i <= value.length(); i++) {
+        bool isWordChar = (i < value.length()) && value.at(i).isLetterOrNumber();
+        if (isWordChar && (start == -1)) {
+            start = i;
+        } else if (!isWordChar && (start != -1)) {
+            result << value.mid(start, i - start);
+            start = -1;
+        }
+    }
+    return result;
+}
+
+QString TextIndex::wordChunk(const QString &word)
+{
+    return word.left(2);
+}
+
+void TextIndex::addPosting(QVector<ContactEntry*> *posting, ContactEntry *entry)
+{
+    QVector<ContactEntry*>::iterator it = std::lower_bound(posting->begin(), posting->end(), entry);
+    if ((it == posting->end()) || (*it != entry)) {
+        posting->insert(it, entry);
+    }
+}
+
+void TextIndex::removePosting(QVector<ContactEntry*> *posting, ContactEntry *entry)
+{
+    QVector<ContactEntry*>::iterator it = std::lower_bound(posting->begin(), posting->end(), entry);
+    if ((it != posting->end()) && (*it == entry)) {
+        posting->erase(it);
+    }
+}
+
+} //namespace
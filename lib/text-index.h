@@ -0,0 +1,75 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_TEXT_INDEX_H__
+#define __GALERA_TEXT_INDEX_H__
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QVector>
+
+#include "chunked-hash.h"
+
+namespace galera
+{
+
+class ContactEntry;
+
+// Index used to find the contacts containing a text, the values are stored
+// unaccented and case folded.
+// Texts with 3 or more chars are looked up by the trigrams of the values, smaller
+// texts can only be looked up as the prefix of one of the value words.
+// The containers are split in small implicitly shared parts, a copy of the
+// index only copies the parts changed after it.
+class TextIndex
+{
+public:
+    TextIndex();
+
+    void insert(ContactEntry *entry, const QStringList &values);
+    void update(ContactEntry *entry, const QStringList &values);
+    void remove(ContactEntry *entry);
+    void clear();
+
+    // return false if the text can not be looked up on the index
+    bool lookup(const QString &text, bool startsWith, QList<ContactEntry*> *result) const;
+
+    static QString normalize(const QString &value);
+
+private:
+    typedef QMap<QString, QVector<ContactEntry*> > WordPostings;
+
+    // posting lists are kept sorted by entry address
+    ChunkedHash<QString, QVector<ContactEntry*> > m_trigrams;
+    // words grouped by their first two chars, see wordChunk
+    QMap<QString, WordPostings> m_words;
+    ChunkedHash<ContactEntry*, QStringList> m_entryTrigrams;
+    ChunkedHash<ContactEntry*, QStringList> m_entryWords;
+
+    static QStringList trigrams(const QString &value);
+    static QStringList words(const QString &value);
+    static QString wordChunk(const QString &word);
+    static void addPosting(QVector<ContactEntry*> *posting, ContactEntry *entry);
+    static void removePosting(QVector<ContactEntry*> *posting, ContactEntry *entry);
+};
+
+} //namespace
+
+#endif
@@ -48,10 +48,9 @@ UpdateContactRequest::UpdateContactRequest(QtContacts::QContact newContact, QInd
     : QObject(),
       m_parent(parent),
       m_object(listener),
-      m_currentPersona(0),
       m_eventLoop(0),
       m_newContact(newContact),
-      m_currentPersonaIndex(0)
+      m_pendingUpdates(0)
 {
     int slotIndex = listener->metaObject()->indexOfSlot(++slot);
     if (slotIndex == -1) {
@@ -64,7 +63,7 @@ UpdateContactRequest::UpdateContactRequest(QtContacts::QContact newContact, QInd
 UpdateContactRequest::~UpdateContactRequest()
 {
     // check if there is a operation running
-    if (m_currentPersona != 0) {
+    if (m_pendingUpdates > 0) {
         wait();
     }
 }
@@ -86,13 +85,36 @@ void UpdateContactRequest::invokeSlot(const QString &errorMessage)
     }
 }
 
+// only the detail types changed on each persona are updated, the changes are
+// started at the same time and the request is done when all of them finish
 void UpdateContactRequest::start()
 {
-    m_currentDetailType = QContactDetail::TypeAddress;
     m_originalContact = m_parent->contact();
     m_personas = m_parent->personas();
-    m_currentPersonaIndex = 0;
-    updatePersona();
+    m_errorMessage.clear();
+
+    // keep the request running until all the changes are started
+    m_pendingUpdates = 1;
+    for(int i = 0; i < m_personas.size(); i++) {
+        FolksPersona *persona = m_personas[i];
+        int index = i + 1;
+        QList<QContactDetail::DetailType> types = changedDetails(persona, index);
+
+        // the extended details are set on the persona contact before the other
+        // changes, the contact is saved asynchronously as one of the pending updates
+        if (types.removeOne(QContactDetail::TypeExtendedDetail)) {
+            updateDetail(persona, index, QContactDetail::TypeExtendedDetail, false);
+        }
+
+        // see updateDetailsDone, the online accounts are updated before the emails
+        bool updateEmailAfter = types.contains(QContactDetail::TypeOnlineAccount) &&
+                                types.removeOne(QContactDetail::TypeEmailAddress);
+        Q_FOREACH(QContactDetail::DetailType type, types) {
+            updateDetail(persona, index, type,
+                         updateEmailAfter && (type == QContactDetail::TypeOnlineAccount));
+        }
+    }
+    detailUpdateDone();
 }
 
 void UpdateContactRequest::wait()
@@ -237,20 +259,14 @@ QList<QtContacts::QContactDetail> UpdateContactRequest::detailsFromPersona(QtCon
     return detailsFromPersona(m_newContact, type, persona, (persona==1), pref);
 }
 
-void UpdateContactRequest::updateAddress()
+bool UpdateContactRequest::updateAddress(DetailUpdate *update)
 {
-    QContactDetail originalPref;
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeAddress,
-                                                                       m_currentPersonaIndex,
-                                                                       &originalPref);
     QContactDetail prefDetail;
     QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeAddress,
-                                                          m_currentPersonaIndex,
+                                                          update->index,
                                                           &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_POSTAL_ADDRESS_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_POSTAL_ADDRESS_DETAILS(update->persona)) {
         qDebug() << "Adderess diff";
         GeeSet *newSet = SET_AFD_NEW();
 
@@ -282,51 +298,26 @@ void UpdateContactRequest::updateAddress()
             g_object_unref(pa);
         }
 
-        folks_postal_address_details_change_postal_addresses(FOLKS_POSTAL_ADDRESS_DETAILS(m_currentPersona),
+        folks_postal_address_details_change_postal_addresses(FOLKS_POSTAL_ADDRESS_DETAILS(update->persona),
                                                              newSet,
                                                              (GAsyncReadyCallback) updateDetailsDone,
-                                                             this);
+                                                             update);
         g_object_unref(newSet);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateAvatar()
+bool UpdateContactRequest::updateAvatar(DetailUpdate *update)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeAvatar, m_currentPersonaIndex, 0);
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeAvatar, m_currentPersonaIndex, 0);
+    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeAvatar, update->index, 0);
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeAvatar, update->index, 0);
 
-    if (m_currentPersona &&
-        FOLKS_IS_AVATAR_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, newDetails)) {
+    if (FOLKS_IS_AVATAR_DETAILS(update->persona)) {
         qDebug() << "avatar diff:"
                  << "\n\t" << originalDetails.size() << (originalDetails.size() > 0 ? originalDetails[0] : QContactDetail()) << "\n"
                  << "\n\t" << newDetails.size() << (newDetails.size() > 0 ? newDetails[0] : QContactDetail());
 
-        // update avatar version if necessary
-        QContactExtendedDetail originalAvatarRev;
-        QContactExtendedDetail newAvatarRev;
-        Q_FOREACH(const QContactExtendedDetail &det,
-                  originalDetailsFromPersona(QContactDetail::TypeExtendedDetail, m_currentPersonaIndex, 0)) {
-            if (det.name() == "X-AVATAR-REV") {
-                originalAvatarRev = det;
-                break;
-            }
-        }
-        Q_FOREACH(const QContactExtendedDetail &det,
-                  detailsFromPersona(QContactDetail::TypeExtendedDetail, m_currentPersonaIndex, 0)) {
-            if (det.name() == "X-AVATAR-REV") {
-                newAvatarRev = det;
-                break;
-            }
-        }
-        // if the avatar changed and the rev still the same we need to reset it to force a sync
-        if (originalAvatarRev.data() == newAvatarRev.data()) {
-            newAvatarRev.setData("");
-            m_newContact.saveDetail(&newAvatarRev);
-        }
-
         //Only supports one avatar
         QUrl avatarUri;
         QUrl oldAvatarUri;
@@ -355,27 +346,49 @@ void UpdateContactRequest::updateAvatar()
                 }
             }
 
-            folks_avatar_details_change_avatar(FOLKS_AVATAR_DETAILS(m_currentPersona),
+            folks_avatar_details_change_avatar(FOLKS_AVATAR_DETAILS(update->persona),
                                                G_LOADABLE_ICON(avatarFileIcon),
                                                (GAsyncReadyCallback) updateDetailsDone,
-                                               this);
+                                               update);
             if (avatarFileIcon) {
                 g_object_unref(avatarFileIcon);
             }
-            return;
+            return true;
         }
     }
-    updateDetailsDone(0, 0, this);
+    return false;
 }
 
-void UpdateContactRequest::updateBirthday()
+void UpdateContactRequest::updateAvatarRevision(int persona)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeBirthday, m_currentPersonaIndex, 0);
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeBirthday, m_currentPersonaIndex, 0);
+    QContactExtendedDetail originalAvatarRev;
+    QContactExtendedDetail newAvatarRev;
+    Q_FOREACH(const QContactExtendedDetail &det,
+              originalDetailsFromPersona(QContactDetail::TypeExtendedDetail, persona, 0)) {
+        if (det.name() == "X-AVATAR-REV") {
+            originalAvatarRev = det;
+            break;
+        }
+    }
+    Q_FOREACH(const QContactExtendedDetail &det,
+              detailsFromPersona(QContactDetail::TypeExtendedDetail, persona, 0)) {
+        if (det.name() == "X-AVATAR-REV") {
+            newAvatarRev = det;
+            break;
+        }
+    }
+    // if the avatar changed and the rev still the same we need to reset it to force a sync
+    if (originalAvatarRev.data() == newAvatarRev.data()) {
+        newAvatarRev.setData("");
+        m_newContact.saveDetail(&newAvatarRev);
+    }
+}
+
+bool UpdateContactRequest::updateBirthday(DetailUpdate *update)
+{
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeBirthday, update->index, 0);
 
-    if (m_currentPersona &&
-        FOLKS_IS_BIRTHDAY_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, newDetails)) {
+    if (FOLKS_IS_BIRTHDAY_DETAILS(update->persona)) {
         qDebug() << "birthday diff";
         //Only supports one birthday
         QDateTime dateTimeBirthday;
@@ -390,54 +403,42 @@ void UpdateContactRequest::updateBirthday()
         if (dateTimeBirthday.isValid()) {
             dateTime = g_date_time_new_from_unix_utc(dateTimeBirthday.toMSecsSinceEpoch() / 1000);
         }
-        folks_birthday_details_change_birthday(FOLKS_BIRTHDAY_DETAILS(m_currentPersona),
+        folks_birthday_details_change_birthday(FOLKS_BIRTHDAY_DETAILS(update->persona),
                                                dateTime,
                                                (GAsyncReadyCallback) updateDetailsDone,
-                                               this);
+                                               update);
         if (dateTime) {
             g_date_time_unref(dateTime);
         }
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateFullName(const QString &fullName)
+bool UpdateContactRequest::updateFullName(DetailUpdate *update)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeDisplayLabel, m_currentPersonaIndex, 0);
-    if (m_currentPersona &&
-        FOLKS_IS_NAME_DETAILS(m_currentPersona) &&
-        originalDetails.size() > 0 &&
-        (originalDetails[0].value(QContactDisplayLabel::FieldLabel).toString() != fullName)) {
-        qDebug() << "Full Name diff:"
-                 << "\n\t" << originalDetails.size() << (originalDetails.size() > 0 ? originalDetails[0] : QContactDetail()) << "\n"
-                 << "\n\t" << fullName;
+    if (FOLKS_IS_NAME_DETAILS(update->persona)) {
+        QString fullName = QIndividual::displayName(m_newContact);
+        qDebug() << "Full Name diff:" << fullName;
         //Only supports one fullName
         QByteArray fullNameUtf8 = fullName.toUtf8();
-        folks_name_details_change_full_name(FOLKS_NAME_DETAILS(m_currentPersona),
+        folks_name_details_change_full_name(FOLKS_NAME_DETAILS(update->persona),
                                             fullNameUtf8.constData(),
                                             (GAsyncReadyCallback) updateDetailsDone,
-                                            this);
-    } else {
-        updateDetailsDone(0, 0, this);
+                                            update);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateEmail()
+bool UpdateContactRequest::updateEmail(DetailUpdate *update)
 {
-    QContactDetail originalPref;
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeEmailAddress,
-                                                                       m_currentPersonaIndex,
-                                                                       &originalPref);
-
     QContactDetail prefDetail;
     QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeEmailAddress,
-                                                          m_currentPersonaIndex,
+                                                          update->index,
                                                           &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_EMAIL_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_EMAIL_DETAILS(update->persona)) {
         qDebug() << "email diff";
         GeeSet *newSet = SET_AFD_NEW();
 
@@ -452,24 +453,21 @@ void UpdateContactRequest::updateEmail()
             g_object_unref(field);
         }
 
-        folks_email_details_change_email_addresses(FOLKS_EMAIL_DETAILS(m_currentPersona),
+        folks_email_details_change_email_addresses(FOLKS_EMAIL_DETAILS(update->persona),
                                                    newSet,
                                                    (GAsyncReadyCallback) updateDetailsDone,
-                                                   this);
+                                                   update);
         g_object_unref(newSet);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateName()
+bool UpdateContactRequest::updateName(DetailUpdate *update)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeName, m_currentPersonaIndex, 0);
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeName, m_currentPersonaIndex, 0);
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeName, update->index, 0);
 
-    if (m_currentPersona &&
-        FOLKS_IS_NAME_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, newDetails)) {
+    if (FOLKS_IS_NAME_DETAILS(update->persona)) {
         //Only supports one fullName
         FolksStructuredName *sn = 0;
         if (newDetails.count()) {
@@ -487,26 +485,23 @@ void UpdateContactRequest::updateName()
                                            suffix.constData());
         }
 
-        folks_name_details_change_structured_name(FOLKS_NAME_DETAILS(m_currentPersona),
+        folks_name_details_change_structured_name(FOLKS_NAME_DETAILS(update->persona),
                                                   sn,
                                                   (GAsyncReadyCallback) updateDetailsDone,
-                                                  this);
+                                                  update);
         if (sn) {
             g_object_unref(sn);
         }
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateNickname()
+bool UpdateContactRequest::updateNickname(DetailUpdate *update)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeNickname, m_currentPersonaIndex, 0);
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeNickname, m_currentPersonaIndex, 0);
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeNickname, update->index, 0);
 
-    if (m_currentPersona &&
-        FOLKS_IS_NAME_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, newDetails)) {
+    if (FOLKS_IS_NAME_DETAILS(update->persona)) {
         qDebug() << "Nickname diff";
         //Only supports one fullName
         QString nicknameValue;
@@ -516,25 +511,21 @@ void UpdateContactRequest::updateNickname()
         }
 
         QByteArray nicknameValueUtf8 = nicknameValue.toUtf8();
-        folks_name_details_change_nickname(FOLKS_NAME_DETAILS(m_currentPersona),
+        folks_name_details_change_nickname(FOLKS_NAME_DETAILS(update->persona),
                                            nicknameValueUtf8.constData(),
                                            (GAsyncReadyCallback) updateDetailsDone,
-                                           this);
-    } else {
-        updateDetailsDone(0, 0, this);
+                                           update);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateNote()
+bool UpdateContactRequest::updateNote(DetailUpdate *update)
 {
-    QContactDetail originalPref;
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeNote, m_currentPersonaIndex, &originalPref);
     QContactDetail prefDetail;
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeNote, m_currentPersonaIndex, &prefDetail);
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeNote, update->index, &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_EMAIL_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_NOTE_DETAILS(update->persona)) {
         qDebug() << "notes diff";
         GeeSet *newSet = SET_AFD_NEW();
 
@@ -549,30 +540,24 @@ void UpdateContactRequest::updateNote()
             g_object_unref(field);
         }
 
-        folks_note_details_change_notes(FOLKS_NOTE_DETAILS(m_currentPersona),
+        folks_note_details_change_notes(FOLKS_NOTE_DETAILS(update->persona),
                                         newSet,
                                         (GAsyncReadyCallback) updateDetailsDone,
-                                        this);
+                                        update);
         g_object_unref(newSet);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateOnlineAccount()
+bool UpdateContactRequest::updateOnlineAccount(DetailUpdate *update)
 {
-    QContactDetail originalPref;
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeOnlineAccount,
-                                                                       m_currentPersonaIndex,
-                                                                       &originalPref);
     QContactDetail prefDetail;
     QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeOnlineAccount,
-                                                          m_currentPersonaIndex,
+                                                          update->index,
                                                           &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_IM_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_IM_DETAILS(update->persona)) {
         qDebug() << "OnlineAccounts diff";
         GeeMultiMap *imMap = GEE_MULTI_MAP_AFD_NEW(FOLKS_TYPE_IM_FIELD_DETAILS);
 
@@ -593,31 +578,25 @@ void UpdateContactRequest::updateOnlineAccount()
             }
         }
 
-       folks_im_details_change_im_addresses(FOLKS_IM_DETAILS(m_currentPersona),
+       folks_im_details_change_im_addresses(FOLKS_IM_DETAILS(update->persona),
                                             imMap,
                                             (GAsyncReadyCallback) updateDetailsDone,
-                                            this);
+                                            update);
 
         g_object_unref(imMap);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateOrganization()
+bool UpdateContactRequest::updateOrganization(DetailUpdate *update)
 {
-    QContactDetail originalPref;
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeOrganization,
-                                                                       m_currentPersonaIndex,
-                                                                       &originalPref);
     QContactDetail prefDetail;
     QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeOrganization,
-                                                          m_currentPersonaIndex,
+                                                          update->index,
                                                           &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_ROLE_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_ROLE_DETAILS(update->persona)) {
         qDebug() << "Organization diff";
         GeeSet *newSet = SET_AFD_NEW();
 
@@ -640,31 +619,29 @@ void UpdateContactRequest::updateOrganization()
             g_object_unref(roleValue);
         }
 
-        folks_role_details_change_roles(FOLKS_ROLE_DETAILS(m_currentPersona),
+        folks_role_details_change_roles(FOLKS_ROLE_DETAILS(update->persona),
                                         newSet,
                                         (GAsyncReadyCallback) updateDetailsDone,
-                                        this);
+                                        update);
 
         g_object_unref(newSet);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updatePhone()
+bool UpdateContactRequest::updatePhone(DetailUpdate *update)
 {
     QContactDetail originalPref;
     QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypePhoneNumber,
-                                                                       m_currentPersonaIndex,
+                                                                       update->index,
                                                                        &originalPref);
     QContactDetail prefDetail;
     QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypePhoneNumber,
-                                                          m_currentPersonaIndex,
+                                                          update->index,
                                                           &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_PHONE_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_PHONE_DETAILS(update->persona)) {
         qDebug() << "Phone diff:"
                  << "\n\t" << originalDetails.size() << (originalDetails.size() > 0 ? originalDetails[0] : QContactDetail()) << "\n"
                  << "\n\t" << newDetails.size() << (newDetails.size() > 0 ? newDetails[0] : QContactDetail());
@@ -682,31 +659,25 @@ void UpdateContactRequest::updatePhone()
             g_object_unref(field);
         }
 
-        folks_phone_details_change_phone_numbers(FOLKS_PHONE_DETAILS(m_currentPersona),
+        folks_phone_details_change_phone_numbers(FOLKS_PHONE_DETAILS(update->persona),
                                                  newSet,
                                                  (GAsyncReadyCallback) updateDetailsDone,
-                                                 this);
+                                                 update);
         g_object_unref(newSet);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateUrl()
+bool UpdateContactRequest::updateUrl(DetailUpdate *update)
 {
-    QContactDetail originalPref;
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeUrl,
-                                                                       m_currentPersonaIndex,
-                                                                       &originalPref);
 
     QContactDetail prefDetail;
     QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeUrl,
-                                                          m_currentPersonaIndex,
+                                                          update->index,
                                                           &prefDetail);
 
-    if (m_currentPersona &&
-        FOLKS_IS_URL_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, originalPref, newDetails, prefDetail)) {
+    if (FOLKS_IS_URL_DETAILS(update->persona)) {
         qDebug() << "Url diff";
         GeeSet *newSet = SET_AFD_NEW();
 
@@ -721,20 +692,20 @@ void UpdateContactRequest::updateUrl()
             g_object_unref(field);
         }
 
-        folks_url_details_change_urls(FOLKS_URL_DETAILS(m_currentPersona),
+        folks_url_details_change_urls(FOLKS_URL_DETAILS(update->persona),
                                       newSet,
                                       (GAsyncReadyCallback) updateDetailsDone,
-                                      this);
+                                      update);
         g_object_unref(newSet);
-    } else {
-        updateDetailsDone(0, 0, this);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateFavorite()
+bool UpdateContactRequest::updateFavorite(DetailUpdate *update)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeFavorite, m_currentPersonaIndex, 0);
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeFavorite, m_currentPersonaIndex, 0);
+    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeFavorite, update->index, 0);
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeFavorite, update->index, 0);
 
     // as default all contacts has favorte set to false
     if (newDetails.isEmpty()) {
@@ -743,9 +714,7 @@ void UpdateContactRequest::updateFavorite()
         newDetails << fav;
     }
 
-    if (m_currentPersona &&
-        FOLKS_IS_FAVOURITE_DETAILS(m_currentPersona) &&
-        !isEqual(originalDetails, newDetails)) {
+    if (FOLKS_IS_FAVOURITE_DETAILS(update->persona)) {
         qDebug() << "Favorite diff:"
                  << "\n\t" << originalDetails.size() << (originalDetails.size() > 0 ? originalDetails[0] : QContactDetail()) << "\n"
                  << "\n\t" << newDetails.size() << (newDetails.size() > 0 ? newDetails[0] : QContactDetail());
@@ -756,44 +725,184 @@ void UpdateContactRequest::updateFavorite()
             QContactFavorite favorite = static_cast<QContactFavorite>(newDetails[0]);
             isFavorite = favorite.isFavorite();
         }
-        folks_favourite_details_change_is_favourite(FOLKS_FAVOURITE_DETAILS(m_currentPersona),
+        folks_favourite_details_change_is_favourite(FOLKS_FAVOURITE_DETAILS(update->persona),
                                                     isFavorite,
                                                     (GAsyncReadyCallback) updateDetailsDone,
-                                                    this);
-    } else {
-        updateDetailsDone(0, 0, this);
+                                                    update);
+        return true;
     }
+    return false;
 }
 
-void UpdateContactRequest::updateExtendedDetails()
+bool UpdateContactRequest::updateExtendedDetails(DetailUpdate *update)
 {
-    QList<QContactDetail> originalDetails = originalDetailsFromPersona(QContactDetail::TypeExtendedDetail, m_currentPersonaIndex, 0);
-    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeExtendedDetail, m_currentPersonaIndex, 0);
-    if (m_currentPersona &&
-        !isEqual(originalDetails, newDetails)) {
-        qDebug() << "Extended details diff";
-        QIndividual::setExtendedDetails(m_currentPersona, newDetails);
+    QList<QContactDetail> newDetails = detailsFromPersona(QContactDetail::TypeExtendedDetail, update->index, 0);
+    qDebug() << "Extended details diff";
+    // the callback can run before this returns, so the save is counted here and
+    // the update is released by updateDetail
+    m_pendingUpdates++;
+    QIndividual::setExtendedDetails(update->persona, newDetails, QDateTime(),
+                                    [this] (const QString &errorMessage) {
+        if (!errorMessage.isEmpty()) {
+            qWarning() << "Fail to update contact" << errorMessage;
+            if (m_errorMessage.isEmpty()) {
+                m_errorMessage = errorMessage;
+            }
+        }
+        detailUpdateDone();
+    });
+    return false;
+}
+
+QList<QContactDetail::DetailType> UpdateContactRequest::changedDetails(FolksPersona *persona, int index)
+{
+    static QList<QContactDetail::DetailType> supportedTypes;
+    if (supportedTypes.isEmpty()) {
+        // the avatar must be compared before the extended details, it can change the avatar revision
+        supportedTypes << QContactDetail::TypeAddress
+                       << QContactDetail::TypeAvatar
+                       << QContactDetail::TypeBirthday
+                       << QContactDetail::TypeDisplayLabel
+                       << QContactDetail::TypeEmailAddress
+                       << QContactDetail::TypeExtendedDetail
+                       << QContactDetail::TypeFavorite
+                       << QContactDetail::TypeName
+                       << QContactDetail::TypeNickname
+                       << QContactDetail::TypeNote
+                       << QContactDetail::TypeOnlineAccount
+                       << QContactDetail::TypeOrganization
+                       << QContactDetail::TypePhoneNumber
+                       << QContactDetail::TypeUrl;
+    }
+
+    QList<QContactDetail::DetailType> types;
+    Q_FOREACH(QContactDetail::DetailType type, supportedTypes) {
+        bool changed = false;
+        switch(type) {
+        case QContactDetail::TypeDisplayLabel:
+        {
+            QList<QContactDetail> originalDetails = originalDetailsFromPersona(type, index, 0);
+            changed = (originalDetails.size() > 0) &&
+                      (originalDetails[0].value(QContactDisplayLabel::FieldLabel).toString() !=
+                       QIndividual::displayName(m_newContact));
+            break;
+        }
+        case QContactDetail::TypeFavorite:
+        {
+            QList<QContactDetail> newDetails = detailsFromPersona(type, index, 0);
+            // as default all contacts has favorte set to false
+            if (newDetails.isEmpty()) {
+                QContactFavorite fav;
+                fav.setFavorite(false);
+                newDetails << fav;
+            }
+            changed = !isEqual(originalDetailsFromPersona(type, index, 0), newDetails);
+            break;
+        }
+        default:
+        {
+            QContactDetail originalPref;
+            QList<QContactDetail> originalDetails = originalDetailsFromPersona(type, index, &originalPref);
+            QContactDetail prefDetail;
+            QList<QContactDetail> newDetails = detailsFromPersona(type, index, &prefDetail);
+            changed = !isEqual(originalDetails, originalPref, newDetails, prefDetail);
+            break;
+        }
+        }
+
+        if (changed) {
+            types << type;
+            if ((type == QContactDetail::TypeAvatar) && FOLKS_IS_AVATAR_DETAILS(persona)) {
+                updateAvatarRevision(index);
+            }
+        }
     }
-    updateDetailsDone(0, 0, this);
+    return types;
 }
 
-void UpdateContactRequest::updatePersona()
+void UpdateContactRequest::updateDetail(FolksPersona *persona, int index,
+                                        QContactDetail::DetailType type,
+                                        bool updateEmailAfter)
 {
-    if (m_personas.size() <= m_currentPersonaIndex) {
-        m_currentPersona = 0;
-        if (m_parent) {
-            m_parent->flush();
-        }
-        invokeSlot();
+    DetailUpdate *update = new DetailUpdate;
+    update->request = this;
+    update->persona = FOLKS_PERSONA(g_object_ref(persona));
+    update->index = index;
+    update->type = type;
+    update->updateEmailAfter = updateEmailAfter;
+
+    bool started = false;
+    switch(type) {
+    case QContactDetail::TypeAddress:
+        started = updateAddress(update);
+        break;
+    case QContactDetail::TypeAvatar:
+        started = updateAvatar(update);
+        break;
+    case QContactDetail::TypeBirthday:
+        started = updateBirthday(update);
+        break;
+    case QContactDetail::TypeDisplayLabel:
+        started = updateFullName(update);
+        break;
+    case QContactDetail::TypeEmailAddress:
+        started = updateEmail(update);
+        break;
+    case QContactDetail::TypeExtendedDetail:
+        started = updateExtendedDetails(update);
+        break;
+    case QContactDetail::TypeFavorite:
+        started = updateFavorite(update);
+        break;
+    case QContactDetail::TypeName:
+        started = updateName(update);
+        break;
+    case QContactDetail::TypeNickname:
+        started = updateNickname(update);
+        break;
+    case QContactDetail::TypeNote:
+        started = updateNote(update);
+        break;
+    case QContactDetail::TypeOnlineAccount:
+        started = updateOnlineAccount(update);
+        break;
+    case QContactDetail::TypeOrganization:
+        started = updateOrganization(update);
+        break;
+    case QContactDetail::TypePhoneNumber:
+        started = updatePhone(update);
+        break;
+    case QContactDetail::TypeUrl:
+        started = updateUrl(update);
+        break;
+    default:
+        qWarning() << "Update not implemented for" << type;
+        break;
+    }
+
+    if (started) {
+        m_pendingUpdates++;
     } else {
-        m_currentPersona = m_personas[m_currentPersonaIndex];
-        g_object_ref(m_currentPersona);
-        m_currentDetailType = QContactDetail::TypeUndefined;
-        m_currentPersonaIndex++;
-        updateDetailsDone(0, 0, this);
+        g_object_unref(update->persona);
+        delete update;
+        if (updateEmailAfter) {
+            updateDetail(persona, index, QContactDetail::TypeEmailAddress, false);
+        }
     }
 }
 
+void UpdateContactRequest::detailUpdateDone()
+{
+    if (--m_pendingUpdates > 0) {
+        return;
+    }
+
+    if (m_errorMessage.isEmpty() && m_parent) {
+        m_parent->flush();
+    }
+    invokeSlot(m_errorMessage);
+}
+
 QString UpdateContactRequest::callDetailChangeFinish(QtContacts::QContactDetail::DetailType detailType,
                                                      FolksPersona *persona,
                                                      GAsyncResult *result)
@@ -855,98 +964,31 @@ QString UpdateContactRequest::callDetailChangeFinish(QtContacts::QContactDetail:
 
 void UpdateContactRequest::updateDetailsDone(GObject *detail, GAsyncResult *result, gpointer userdata)
 {
-    UpdateContactRequest *self = static_cast<UpdateContactRequest*>(userdata);
+    DetailUpdate *update = static_cast<DetailUpdate*>(userdata);
+    UpdateContactRequest *self = update->request;
 
     QString errorMessage;
-    if (detail && result) {
-        if (FOLKS_IS_PERSONA(detail)) {
-            // This is a normal field update
-            errorMessage = self->callDetailChangeFinish(static_cast<QContactDetail::DetailType>(self->m_currentDetailType),
-                                                        FOLKS_PERSONA(detail),
-                                                        result);
-        }
-
-        if (!errorMessage.isEmpty()) {
-            qWarning() << "Fail to update contact" << errorMessage;
-            self->invokeSlot(errorMessage);
-            return;
-        }
+    if (FOLKS_IS_PERSONA(detail)) {
+        errorMessage = self->callDetailChangeFinish(update->type, FOLKS_PERSONA(detail), result);
     }
 
-    self->m_currentDetailType += 1;
-    switch(static_cast<QContactDetail::DetailType>(self->m_currentDetailType)) {
-    case QContactDetail::TypeAddress:
-        self->updateAddress();
-        break;
-    case QContactDetail::TypeAvatar:
-        self->updateAvatar();
-        break;
-    case QContactDetail::TypeBirthday:
-        self->updateBirthday();
-        break;
-    case QContactDetail::TypeDisplayLabel:
-        self->updateFullName(QIndividual::displayName(self->m_newContact));
-        break;
-    case QContactDetail::TypeEmailAddress:
+    if (!errorMessage.isEmpty()) {
+        qWarning() << "Fail to update contact" << errorMessage;
+        if (self->m_errorMessage.isEmpty()) {
+            self->m_errorMessage = errorMessage;
+        }
+    } else if (update->updateEmailAfter) {
         //WORKAROUND: Folks automatically add online accounts based on e-mail address
         // for example user@gmail.com will create a jabber account, and this causes some
         // confusions on the service during the update, because of that we first update
-        // the online account and this will avoid problems with the automatic update ]
+        // the online account and this will avoid problems with the automatic update
         // from folks
-        self->updateOnlineAccount();
-        break;
-    case QContactDetail::TypeExtendedDetail:
-        self->updateExtendedDetails();
-        break;
-    case QContactDetail::TypeFavorite:
-        self->updateFavorite();
-        break;
-    case QContactDetail::TypeName:
-        self->updateName();
-        break;
-    case QContactDetail::TypeNickname:
-        self->updateNickname();
-        break;
-    case QContactDetail::TypeNote:
-        self->updateNote();
-        break;
-    case QContactDetail::TypeOnlineAccount:
-        //WORKAROUND: see TypeEmailAddress update clause
-        self->updateEmail();
-        break;
-    case QContactDetail::TypeOrganization:
-        self->updateOrganization();
-        break;
-    case QContactDetail::TypePhoneNumber:
-        self->updatePhone();
-        break;
-    case QContactDetail::TypeUrl:
-        self->updateUrl();
-        break;
-    case QContactDetail::TypeAnniversary:
-    case QContactDetail::TypeFamily:
-    case QContactDetail::TypeGender:
-    case QContactDetail::TypeGeoLocation:
-    case QContactDetail::TypeGlobalPresence:
-    case QContactDetail::TypeHobby:
-    case QContactDetail::TypeRingtone:
-    case QContactDetail::TypeTag:
-    case QContactDetail::TypeTimestamp:
-        //TODO
-    case QContactDetail::TypeGuid:
-    case QContactDetail::TypeType:
-        updateDetailsDone(0, 0, self);
-        break;
-    case QContactDetail::TypeVersion:
-        g_object_unref(self->m_currentPersona);
-        self->m_currentPersona = 0;
-        self->updatePersona();
-        break;
-    default:
-        qWarning() << "Update not implemented for" << self->m_currentDetailType;
-        updateDetailsDone(0, 0, self);
-        break;
+        self->updateDetail(update->persona, update->index, QContactDetail::TypeEmailAddress, false);
     }
+
+    g_object_unref(update->persona);
+    delete update;
+    self->detailUpdateDone();
 }
 
 } // namespace
@@ -56,17 +56,29 @@ Q_SIGNALS:
     void done(const QString &errorMessage);
 
 private:
+    // a detail change running on a persona
+    class DetailUpdate
+    {
+    public:
+        UpdateContactRequest *request;
+        FolksPersona *persona;
+        int index;
+        QtContacts::QContactDetail::DetailType type;
+        // the emails are updated after the online accounts
+        bool updateEmailAfter;
+    };
+
     QIndividual *m_parent;
     QObject *m_object;
-    FolksPersona *m_currentPersona;
     QEventLoop *m_eventLoop;
 
     QList<FolksPersona*> m_personas;
     QtContacts::QContact m_originalContact;
     QtContacts::QContact m_newContact;
-    int m_currentDetailType;
     QMetaMethod m_slot;
-    int m_currentPersonaIndex;
+    int m_pendingUpdates;
+    // first error of the detail changes
+    QString m_errorMessage;
 
     void invokeSlot(const QString &errorMessage = QString());
     static bool isEqual(QList<QtContacts::QContactDetail> listA,
@@ -91,21 +103,28 @@ private:
                                                          QtContacts::QContactDetail *pref) const;
 
 
-    void updatePersona();
-    void updateAddress();
-    void updateAvatar();
-    void updateBirthday();
-    void updateFullName(const QString &fullName);
-    void updateEmail();
-    void updateName();
-    void updateNickname();
-    void updateNote();
-    void updateOnlineAccount();
-    void updateOrganization();
-    void updatePhone();
-    void updateUrl();
-    void updateFavorite();
-    void updateExtendedDetails();
+    QList<QtContacts::QContactDetail::DetailType> changedDetails(FolksPersona *persona, int index);
+    void updateDetail(FolksPersona *persona, int index,
+                      QtContacts::QContactDetail::DetailType type,
+                      bool updateEmailAfter);
+    void detailUpdateDone();
+
+    // each function returns false if the change was not started
+    bool updateAddress(DetailUpdate *update);
+    bool updateAvatar(DetailUpdate *update);
+    void updateAvatarRevision(int persona);
+    bool updateBirthday(DetailUpdate *update);
+    bool updateFullName(DetailUpdate *update);
+    bool updateEmail(DetailUpdate *update);
+    bool updateName(DetailUpdate *update);
+    bool updateNickname(DetailUpdate *update);
+    bool updateNote(DetailUpdate *update);
+    bool updateOnlineAccount(DetailUpdate *update);
+    bool updateOrganization(DetailUpdate *update);
+    bool updatePhone(DetailUpdate *update);
+    bool updateUrl(DetailUpdate *update);
+    bool updateFavorite(DetailUpdate *update);
+    bool updateExtendedDetails(DetailUpdate *update);
 
     QString callDetailChangeFinish(QtContacts::QContactDetail::DetailType detailType,
                                    FolksPersona *persona,
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "update-scheduler.h"
+#include "contacts-map.h"
+#include "qindividual.h"
+
+#include "common/vcard-parser.h"
+
+#include <QtCore/QDebug>
+
+#include <QtDBus/QDBusConnection>
+
+#include <QtContacts/QContactGuid>
+
+using namespace QtContacts;
+
+namespace galera
+{
+
+UpdateScheduler::UpdateScheduler(QObject *parent)
+    : QObject(parent),
+      m_contacts(0)
+{
+}
+
+UpdateScheduler::~UpdateScheduler()
+{
+    failAll("Address book closed");
+}
+
+void UpdateScheduler::setContacts(ContactsMap *contacts)
+{
+    if (m_contacts != contacts) {
+        // the running updates belong to the old contacts
+        failAll("Address book reloaded");
+        m_contacts = contacts;
+    }
+}
+
+void UpdateScheduler::updateContacts(const QStringList &vcards, const QDBusMessage &message)
+{
+    if (vcards.isEmpty()) {
+        QDBusConnection::sessionBus().send(message.createReply(QStringList()));
+        return;
+    }
+
+    Call *call = new Call;
+    call->message = message;
+    call->result = vcards;
+    call->pending = vcards.size();
+
+    for(int i = 0; i < vcards.size(); i++) {
+        Job job;
+        job.call = call;
+        job.index = i;
+        job.contact = VCardParser::vcardToContact(vcards[i]);
+
+        QString contactId = job.contact.detail<QContactGuid>().guid();
+        if (!m_contacts || contactId.isEmpty() || !m_contacts->value(contactId)) {
+            qWarning() << "Contact not found for update:" << vcards[i];
+            finish(contactId, job, "Contact not found!");
+            continue;
+        }
+
+        m_queues[contactId] << job;
+        startNext(contactId);
+    }
+}
+
+void UpdateScheduler::contactRemoved(const QString &contactId)
+{
+    // the update request is detached from a removed contact and will not finish
+    m_running.remove(contactId);
+    Q_FOREACH(const Job &job, m_queues.take(contactId)) {
+        finish(contactId, job, "Contact removed");
+    }
+}
+
+bool UpdateScheduler::isIdle() const
+{
+    return m_queues.isEmpty();
+}
+
+void UpdateScheduler::onUpdateDone(const QString &contactId, const QString &error)
+{
+    if (!m_running.remove(contactId)) {
+        qWarning() << "Update done for a contact without updates" << contactId;
+        return;
+    }
+
+    Job job = m_queues[contactId].takeFirst();
+    finish(contactId, job, error);
+
+    // a failure during the start is handled by startNext
+    if (!m_starting.contains(contactId)) {
+        startNext(contactId);
+    }
+}
+
+void UpdateScheduler::startNext(const QString &contactId)
+{
+    while (!m_running.contains(contactId)) {
+        QHash<QString, QList<Job> >::iterator queue = m_queues.find(contactId);
+        if (queue == m_queues.end()) {
+            return;
+        }
+        if (queue->isEmpty()) {
+            m_queues.erase(queue);
+            return;
+        }
+
+        Job job = queue->first();
+        ContactEntry *entry = m_contacts ? m_contacts->value(contactId) : 0;
+        if (!entry) {
+            queue->removeFirst();
+            finish(contactId, job, "Contact not found!");
+            continue;
+        }
+
+        m_running << contactId;
+        m_starting << contactId;
+        bool started = entry->individual()->update(job.contact, this,
+                                                   SLOT(onUpdateDone(QString,QString)));
+        m_starting.remove(contactId);
+
+        // the contact did not change, if the update failed onUpdateDone was already called
+        if (!started && m_running.remove(contactId)) {
+            m_queues[contactId].removeFirst();
+            finish(contactId, job, QString(), false);
+        }
+    }
+}
+
+void UpdateScheduler::finish(const QString &contactId, const Job &job, const QString &error, bool changed)
+{
+    Call *call = job.call;
+    if (!error.isEmpty()) {
+        call->result[job.index] = error;
+    } else {
+        ContactEntry *entry = m_contacts ? m_contacts->value(contactId) : 0;
+        if (entry) {
+            call->result[job.index] = VCardParser::contactToVcard(entry->individual()->contact());
+            if (changed) {
+                call->updatedIds << contactId;
+                m_contacts->updatePosition(entry);
+            }
+        } else {
+            call->result[job.index] = "";
+        }
+    }
+
+    if (--call->pending == 0) {
+        QDBusConnection::sessionBus().send(call->message.createReply(call->result));
+        if (!call->updatedIds.isEmpty()) {
+            Q_EMIT contactsUpdated(call->updatedIds);
+        }
+        delete call;
+    }
+}
+
+void UpdateScheduler::failAll(const QString &error)
+{
+    QHash<QString, QList<Job> > queues = m_queues;
+    m_queues.clear();
+    m_running.clear();
+
+    // the contacts are not available anymore
+    ContactsMap *contacts = m_contacts;
+    m_contacts = 0;
+    QHash<QString, QList<Job> >::const_iterator queue = queues.constBegin();
+    for(; queue != queues.constEnd(); queue++) {
+        Q_FOREACH(const Job &job, queue.value()) {
+            finish(queue.key(), job, error);
+        }
+    }
+    m_contacts = contacts;
+}
+
+}
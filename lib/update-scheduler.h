@@ -0,0 +1,95 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GALERA_UPDATE_SCHEDULER_H__
+#define __GALERA_UPDATE_SCHEDULER_H__
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+#include <QtDBus/QDBusMessage>
+
+#include <QtContacts/QContact>
+
+namespace galera {
+
+class ContactsMap;
+
+// Runs the contact updates requested by the clients.
+// Each contact has a queue of updates, the updates of the same contact run in the
+// request order and the updates of different contacts run at the same time. Each
+// updateContacts call is replied when all its contacts are updated.
+class UpdateScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    UpdateScheduler(QObject *parent = 0);
+    ~UpdateScheduler();
+
+    // the pending updates fail if the contacts map changes
+    void setContacts(ContactsMap *contacts);
+    // the reply contains the updated vcards or the error message of each contact
+    void updateContacts(const QStringList &vcards, const QDBusMessage &message);
+    // fail the updates of a contact removed from the map
+    void contactRemoved(const QString &contactId);
+    bool isIdle() const;
+
+Q_SIGNALS:
+    void contactsUpdated(const QSet<QString> &ids);
+
+private Q_SLOTS:
+    void onUpdateDone(const QString &contactId, const QString &error);
+
+private:
+    class Call
+    {
+    public:
+        QDBusMessage message;
+        QStringList result;
+        int pending;
+        QSet<QString> updatedIds;
+    };
+
+    class Job
+    {
+    public:
+        Call *call;
+        int index;
+        QtContacts::QContact contact;
+    };
+
+    ContactsMap *m_contacts;
+    // pending updates by contact id, the first one runs if the contact is on m_running
+    QHash<QString, QList<Job> > m_queues;
+    QSet<QString> m_running;
+    // contacts starting an update, the update can fail before it starts
+    QSet<QString> m_starting;
+
+    void startNext(const QString &contactId);
+    void finish(const QString &contactId, const Job &job, const QString &error, bool changed = true);
+    void failAll(const QString &error);
+};
+
+}
+
+#endif
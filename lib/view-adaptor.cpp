@@ -59,6 +59,24 @@ QStringList ViewAdaptor::contactsDetails(const QStringList &fields, int startInd
     return QStringList();
 }
 
+QByteArray ViewAdaptor::contactsDetailsBinary(const QStringList &fields, int startIndex, int pageSize, const QDBusMessage &message)
+{
+    if (m_view) {
+        message.setDelayedReply(true);
+        m_view->contactsDetailsBinary(fields, startIndex, pageSize, message);
+    }
+    return QByteArray();
+}
+
+QDBusUnixFileDescriptor ViewAdaptor::contactsDetailsFile(const QStringList &fields, const QDBusMessage &message)
+{
+    if (m_view) {
+        message.setDelayedReply(true);
+        m_view->contactsDetailsFile(fields, message);
+    }
+    return QDBusUnixFileDescriptor();
+}
+
 int ViewAdaptor::count()
 {
     if (m_view) {
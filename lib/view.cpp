@@ -20,20 +20,27 @@
 #include "view-adaptor.h"
 #include "contacts-map.h"
 #include "contact-less-than.h"
+#include "contact-sort-key.h"
+#include "parallel-filter.h"
 #include "qindividual.h"
 
 #include "common/vcard-parser.h"
+#include "common/contact-codec.h"
 #include "common/filter.h"
+#include "common/filter-program.h"
 #include "common/fetch-hint.h"
 #include "common/dbus-service-defs.h"
 
 #include <QtContacts/QContact>
+#include <QtContacts/QContactGuid>
 
 #include <QtVersit/QVersitDocument>
 
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
 
+#include <unistd.h>
+
 using namespace QtContacts;
 using namespace QtVersit;
 
@@ -43,12 +50,14 @@ namespace galera
 class FilterThread: public QRunnable
 {
 public:
-    FilterThread(QString filter, QString sort, int maxCount, bool showInvisible, ContactsMap *allContacts, QObject *parent)
+    FilterThread(QString filter, QString sort, int maxCount, bool showInvisible, QObject *parent)
         : m_parent(parent),
           m_filter(filter),
+          m_program(m_filter),
+          m_detailTypes(m_program.detailTypes()),
           m_sortClause(sort),
+          m_snapshot(0),
           m_maxCount(maxCount),
-          m_allContacts(allContacts),
           m_showInvisible(showInvisible),
           m_canceled(false),
           m_running(false),
@@ -57,48 +66,176 @@ public:
         setAutoDelete(false);
     }
 
-    QList<QContact> result() const
+    ~FilterThread()
+    {
+        releaseSnapshot();
+    }
+
+    // the contacts are only valid while the contacts map is alive, the view must
+    // be notified about the removed contacts or restarted with a new contacts map
+    QList<ContactEntry*> result() const
     {
         if (isRunning()) {
-            return QList<QContact>();
+            return QList<ContactEntry*>();
         } else {
             return m_contacts;
         }
     }
 
-    bool appendContact(const QContact &contact, const QDateTime &deteletedAt)
+    bool acceptContact(ContactEntry *entry) const
+    {
+        return (m_filter.isValid() &&
+                (m_showInvisible || entry->individual()->isVisible()) &&
+                checkContact(entry->individual()->contact(m_detailTypes),
+                             entry->individual()->deletedAt(),
+                             entry->individual()->phoneNumbers()));
+    }
+
+    // insert the contact on its sorted position, returns the position or -1 if
+    // the contact does not fit in the view
+    int insertContact(ContactEntry *entry)
     {
-        if (checkContact(contact, deteletedAt)) {
-            addSorted(&m_contacts, contact, m_sortClause);
-            return true;
+        ContactSortKey key = sortKey(entry);
+        int pos = m_contacts.size();
+        if (!m_listSort.isEmpty()) {
+            pos = std::upper_bound(m_contacts.begin(), m_contacts.end(), key,
+                                   [this] (const ContactSortKey &k, ContactEntry *e) {
+                return (k.compare(m_keys.value(e), m_listSortOrders) < 0);
+            }) - m_contacts.begin();
         }
-        return false;
+
+        if ((m_maxCount > 0) && (pos >= m_maxCount)) {
+            return -1;
+        }
+
+        m_contacts.insert(pos, entry);
+        m_keys.insert(entry, key);
+        return pos;
+    }
+
+    // remove the contact from the view, returns its old position or -1
+    int takeContact(ContactEntry *entry)
+    {
+        int pos = indexOf(entry);
+        if (pos != -1) {
+            m_contacts.removeAt(pos);
+            m_keys.remove(entry);
+        }
+        return pos;
+    }
+
+    // remove the contacts over the view limit, returns the position of the first one removed or -1
+    int trim()
+    {
+        if ((m_maxCount <= 0) || (m_contacts.size() <= m_maxCount)) {
+            return -1;
+        }
+
+        for(int i = m_maxCount; i < m_contacts.size(); i++) {
+            m_keys.remove(m_contacts[i]);
+        }
+        m_contacts.erase(m_contacts.begin() + m_maxCount, m_contacts.end());
+        return m_maxCount;
+    }
+
+    bool isFull() const
+    {
+        return ((m_maxCount > 0) && (m_contacts.size() >= m_maxCount));
+    }
+
+    // add the next contact of the sort order when a contact leaves a full view,
+    // returns its position or -1; "removed" is skipped, it can still be in the map
+    int backfill(ContactsMap *allContacts, ContactEntry *removed)
+    {
+        if (!allContacts || (m_maxCount <= 0) || (m_contacts.size() >= m_maxCount)) {
+            return -1;
+        }
+
+        // the map keeps the contacts in the view order if the view sort was acquired
+        bool ordered = (!m_listSort.isEmpty() &&
+                        (allContacts->hasSort(m_listSort) ||
+                         (allContacts->sort().toContactSortOrder() == m_listSortOrders)));
+        QList<ContactEntry*> candidates = ordered ? allContacts->values(m_listSort) : allContacts->values();
+        QList<ContactEntry*>::const_iterator it = candidates.constBegin();
+        if (ordered && !m_contacts.isEmpty()) {
+            // the contacts before the last one of the view are in the view or not accepted
+            ContactSortKey last = m_keys.value(m_contacts.last());
+            it = std::lower_bound(candidates.constBegin(), candidates.constEnd(), last,
+                                  [this] (ContactEntry *e, const ContactSortKey &k) {
+                return (sortKey(e).compare(k, m_listSortOrders) < 0);
+            });
+        }
+
+        ContactEntry *next = 0;
+        ContactSortKey nextKey;
+        for(; it != candidates.constEnd(); it++) {
+            ContactEntry *entry = *it;
+            if ((entry == removed) || m_keys.contains(entry) || !acceptContact(entry)) {
+                continue;
+            }
+            if (ordered || m_listSort.isEmpty()) {
+                next = entry;
+                break;
+            }
+
+            // the map is in other order, keep the first contact of the view order
+            ContactSortKey key = sortKey(entry);
+            if (!next || (key.compare(nextKey, m_listSortOrders) < 0)) {
+                next = entry;
+                nextKey = key;
+            }
+        }
+        return next ? insertContact(next) : -1;
     }
 
-    bool removeContact(const QContact &contact)
+    int indexOf(ContactEntry *entry) const
     {
-        return m_contacts.removeAll(contact);
+        QHash<ContactEntry*, ContactSortKey>::const_iterator key = m_keys.constFind(entry);
+        if (key == m_keys.constEnd()) {
+            return -1;
+        }
+
+        if (!m_listSort.isEmpty()) {
+            // the view is ordered by the keys of the contacts when they were added,
+            // the contact is found in O(log n) even if its sort values changed since
+            auto lessThan = [this] (const ContactSortKey &a, const ContactSortKey &b) {
+                return (a.compare(b, m_listSortOrders) < 0);
+            };
+            QList<ContactEntry*>::const_iterator it = std::lower_bound(m_contacts.begin(), m_contacts.end(), key.value(),
+                                                                       [this, &lessThan] (ContactEntry *e, const ContactSortKey &k) {
+                return lessThan(m_keys.value(e), k);
+            });
+            for(; (it != m_contacts.end()) && !lessThan(key.value(), m_keys.value(*it)); it++) {
+                if (*it == entry) {
+                    return it - m_contacts.begin();
+                }
+            }
+        }
+        return m_contacts.indexOf(entry);
     }
 
     void chageSort(SortClause clause)
     {
         m_sortClause = clause;
         if (!clause.isEmpty()) {
-            ContactLessThan lessThan(m_sortClause);
+            setListSort(clause);
+            ContactEntryLessThan lessThan(m_sortClause);
             qSort(m_contacts.begin(), m_contacts.end(), lessThan);
+            updateKeys();
         }
     }
 
-    void addSorted(QList<QContact> *sorted, const QContact &toAdd, const SortClause& sortOrder)
+    // filter a snapshot of the contacts map, the changes done on the map after
+    // that must be applied on the result
+    void start(ContactsMap *allContacts)
     {
-        if (!sortOrder.isEmpty()) {
-            ContactLessThan lessThan(sortOrder);
-            QList<QContact>::iterator it(std::upper_bound(sorted->begin(), sorted->end(), toAdd, lessThan));
-            sorted->insert(it, toAdd);
-        } else {
-            // no sort order just add it to the end
-            sorted->append(toAdd);
-        }
+        releaseSnapshot();
+        m_snapshot = allContacts ? allContacts->snapshot() : 0;
+        m_contacts.clear();
+        m_keys.clear();
+        m_running = true;
+        m_done = false;
+        QThreadPool::globalInstance()->start(this);
     }
 
     void cancel()
@@ -108,6 +245,19 @@ public:
         m_canceledLock.unlock();
     }
 
+    bool isCanceled() const
+    {
+        QReadLocker locker(&m_canceledLock);
+        return m_canceled;
+    }
+
+    // the entries removed from the map after the start are deleted after that
+    void releaseSnapshot()
+    {
+        delete m_snapshot;
+        m_snapshot = 0;
+    }
+
     bool isRunning() const
     {
         return m_running;
@@ -128,104 +278,134 @@ protected:
 
     void run()
     {
-        if (m_canceled || !m_allContacts) {
+        if (m_canceled || !m_snapshot) {
             notifyFinished();
             return;
         }
 
-        m_allContacts->lockForRead();
         // only sort contacts if the contacts was stored in a different order into the contacts map
         bool needSort = (!m_sortClause.isEmpty() &&
-                         (m_sortClause.toContactSortOrder() != m_allContacts->sort().toContactSortOrder()));
+                         (m_sortClause.toContactSortOrder() != m_snapshot->sort().toContactSortOrder()));
+        // and if the contacts map does not keep an ordering for the view sort
+        SortClause mapSort = needSort ? m_sortClause : m_snapshot->sort();
+        bool sortResults = needSort && !m_snapshot->hasSort(m_sortClause);
+        setListSort(mapSort);
         // filter contacts if necessary
+        QList<ContactEntry *> preFilter;
+        ParallelFilter::AcceptFunction accept;
         if (m_filter.isValid() && m_filter.isEmpty()) {
-            Q_FOREACH(ContactEntry *entry, m_allContacts->values()) {
-                if ((m_showInvisible || entry->individual()->isVisible()) &&
-                    !entry->individual()->deletedAt().isValid()) {
-
-                    QContact contact = entry->individual()->contact();
-
-                    if (needSort) {
-                        addSorted(&m_contacts, contact, m_sortClause);
-                    } else {
-                        m_contacts.append(contact);
-                    }
-
-                    if ((m_maxCount > 0) && (m_maxCount >= m_contacts.size())) {
-                        break;
-                    }
-                }
-            }
+            preFilter = m_snapshot->values(mapSort);
+            accept = [this] (ContactEntry *entry) {
+                return ((m_showInvisible || entry->individual()->isVisible()) &&
+                        !entry->individual()->deletedAt().isValid());
+            };
         } else if (m_filter.isValid()) {
             // optmization
-            QList<ContactEntry *> preFilter;
-
             // check if is a query by id
             QStringList idsToFilter = m_filter.idsToFilter();
             if (!idsToFilter.isEmpty()) {
-                preFilter = m_allContacts->values(idsToFilter);
+                preFilter = m_snapshot->values(idsToFilter);
+                // the ids and phone lookups do not return the contacts in the map order
+                sortResults = needSort;
+                if (!needSort) {
+                    setListSort(SortClause(QString()));
+                }
             } else {
                 // check if is a phone number query
                 QString phoneToFilter = m_filter.phoneNumberToFilter();
                 if (!phoneToFilter.isEmpty()) {
-                    preFilter = m_allContacts->valueByPhone(phoneToFilter);
+                    preFilter = m_snapshot->valueByPhone(phoneToFilter);
+                    sortResults = needSort;
+                    if (!needSort) {
+                        setListSort(SortClause(QString()));
+                    }
                 } else {
-                    qDebug() << "Filter not optimized" << m_filter.toContactFilter();
-                    preFilter = m_allContacts->values();
-                }
-            }
-
-            Q_FOREACH(ContactEntry *entry, preFilter) {
-                m_canceledLock.lockForRead();
-                if (m_canceled) {
-                    m_canceledLock.unlock();
-                    m_allContacts->unlock();
-                    notifyFinished();
-                    return;
-                }
-
-                QContact contact = entry->individual()->contact();
-                QDateTime deletedAt = entry->individual()->deletedAt();
-                m_canceledLock.unlock();
-
-                if ((m_showInvisible || entry->individual()->isVisible()) &&
-                    checkContact(contact, deletedAt)) {
-                    if (needSort) {
-                        addSorted(&m_contacts, contact, m_sortClause);
+                    // check if is a text query (name, email, ...)
+                    bool startsWith = false;
+                    QString textToFilter = m_filter.textToFilter(&startsWith);
+                    if (!textToFilter.isEmpty()) {
+                        preFilter = m_snapshot->valueByText(textToFilter, startsWith, mapSort);
                     } else {
-                        m_contacts.append(contact);
-                    }
-                    if ((m_maxCount > 0) && (m_contacts.size() >= m_maxCount)) {
-                        break;
+                        qDebug() << "Filter not optimized" << m_filter.toContactFilter();
+                        preFilter = m_snapshot->values(mapSort);
                     }
                 }
             }
+            accept = [this] (ContactEntry *entry) { return acceptContact(entry); };
+        }
+
+        if (accept) {
+            // large lists are tested in parallel, if the candidates are not in the view
+            // order only the first maxCount contacts of the sort order are kept
+            ParallelFilter parallelFilter(accept, [this] () { return isCanceled(); });
+            m_contacts = parallelFilter.filter(preFilter,
+                                               sortResults ? m_sortClause : SortClause(QString()),
+                                               m_maxCount);
+            if (isCanceled()) {
+                m_contacts.clear();
+            }
         } else {
             // invalid filter
             m_contacts.clear();
         }
 
-        m_allContacts->unlock();
+        updateKeys();
         notifyFinished();
     }
 
 private:
     QObject *m_parent;
     Filter m_filter;
+    FilterProgram m_program;
+    // details necessary to run the filter program
+    QList<QContactDetail::DetailType> m_detailTypes;
     SortClause m_sortClause;
-    ContactsMap *m_allContacts;
-    QList<QContact> m_contacts;
+    // order of the contacts list
+    SortClause m_listSort;
+    QList<QContactSortOrder> m_listSortOrders;
+    QString m_listSortKeyName;
+    ContactsMapSnapshot *m_snapshot;
+    QList<ContactEntry*> m_contacts;
+    // sort key of each contact when it was added, the list stays ordered by these
+    // keys until the view is notified about the contact changes
+    QHash<ContactEntry*, ContactSortKey> m_keys;
 
     int m_maxCount;
     bool m_showInvisible;
     bool m_canceled;
-    QReadWriteLock m_canceledLock;
+    mutable QReadWriteLock m_canceledLock;
     bool m_running;
     bool m_done;
 
-    bool checkContact(const QContact &contact, const QDateTime &deletedAt)
+    void setListSort(const SortClause &clause)
+    {
+        m_listSort = clause;
+        m_listSortOrders = clause.toContactSortOrder();
+        m_listSortKeyName = ContactSortKey::name(clause);
+    }
+
+    ContactSortKey sortKey(ContactEntry *entry) const
+    {
+        if (m_listSort.isEmpty()) {
+            return ContactSortKey();
+        }
+        return entry->individual()->sortKey(m_listSort, m_listSortKeyName);
+    }
+
+    void updateKeys()
+    {
+        m_keys.clear();
+        m_keys.reserve(m_contacts.size());
+        Q_FOREACH(ContactEntry *entry, m_contacts) {
+            m_keys.insert(entry, sortKey(entry));
+        }
+    }
+
+    bool checkContact(const QContact &contact,
+                      const QDateTime &deletedAt,
+                      const QList<PhoneNumberRecord> &phoneNumbers) const
     {
-        return m_filter.test(contact, deletedAt);
+        return m_program.test(contact, deletedAt, phoneNumbers);
     }
 };
 
@@ -234,12 +414,16 @@ View::View(const QString &clause, const QString &sort, int maxCount, bool showIn
            QObject *parent)
     : QObject(parent),
       m_sources(sources),
-      m_filterThread(new FilterThread(clause, sort, maxCount, showInvisible, allContacts, this)),
+      m_allContacts(allContacts),
+      m_filterThread(new FilterThread(clause, sort, maxCount, showInvisible, this)),
       m_adaptor(0),
-      m_waiting(0)
+      m_waiting(0),
+      m_sortClause(sort)
 {
     if (allContacts) {
-        QThreadPool::globalInstance()->start(m_filterThread);
+        // the contacts map will keep the contacts in the view order while the view is open
+        allContacts->acquireSort(m_sortClause);
+        m_filterThread->start(allContacts);
     }
 }
 
@@ -267,6 +451,48 @@ void View::close()
         }
         delete m_filterThread;
         m_filterThread = 0;
+        m_pendingChanges.clear();
+
+        if (m_allContacts) {
+            m_allContacts->releaseSort(m_sortClause);
+        }
+    }
+}
+
+void View::setContacts(ContactsMap *contacts)
+{
+    if (m_allContacts == contacts) {
+        return;
+    }
+
+    // the current result points to the old contacts map entries
+    waitFilter();
+    if (!m_filterThread) {
+        m_allContacts = contacts;
+        return;
+    }
+
+    if (m_allContacts) {
+        m_allContacts->releaseSort(m_sortClause);
+    }
+    m_allContacts = contacts;
+    if (m_allContacts) {
+        m_allContacts->acquireSort(m_sortClause);
+    }
+
+    int count = m_filterThread->result().count();
+    if (isOpen() && (count > 0)) {
+        Q_EMIT m_adaptor->contactsRemoved(0, count);
+    }
+
+    m_filterThread->start(contacts);
+    waitFilter();
+
+    if (isOpen()) {
+        if (m_filterThread->result().count() > 0) {
+            Q_EMIT m_adaptor->contactsAdded(0, m_filterThread->result().count());
+        }
+        Q_EMIT countChanged(m_filterThread->result().count());
     }
 }
 
@@ -289,7 +515,7 @@ QStringList View::contactsDetails(const QStringList &fields, int startIndex, int
 
     waitFilter();
 
-    const QList<QContact> &contacts = m_filterThread->result();
+    const QList<ContactEntry*> contacts = m_filterThread->result();
     if (startIndex < 0) {
         startIndex = 0;
     }
@@ -298,23 +524,126 @@ QStringList View::contactsDetails(const QStringList &fields, int startIndex, int
         pageSize = contacts.count() - startIndex;
     }
 
+    // use the vcards cached by the individuals and only export the missing ones
+    QList<QContactDetail::DetailType> detailTypes = FetchHint::parseFieldNames(fields);
+    QString cacheKey = QIndividual::vcardKey(detailTypes);
+    QStringList vcards;
     QList<QContact> pageOfContacts;
+    QVariantList pagePositions;
+    QStringList pageIds;
+    QVariantList pageIndividuals;
+    QVariantList pageRevisions;
     for(int i = startIndex, iMax = (startIndex + pageSize); i < iMax; i++) {
-        pageOfContacts << QIndividual::copy(contacts.at(i), FetchHint::parseFieldNames(fields));
+        QIndividual *individual = contacts.at(i)->individual();
+        QString vcard = individual->vcard(cacheKey);
+        vcards << vcard;
+
+        if (vcard.isEmpty()) {
+            // export the current individual contact, the cache must match its revision
+            pageOfContacts << QIndividual::copy(individual->contact(detailTypes), detailTypes);
+            pagePositions << vcards.size() - 1;
+            pageIds << individual->id();
+            pageIndividuals << QVariant::fromValue<void*>(individual);
+            pageRevisions << individual->revision();
+        }
+    }
+
+    if (pageOfContacts.isEmpty()) {
+        QDBusConnection::sessionBus().send(message.createReply(vcards));
+        return QStringList();
     }
 
     VCardParser *parser = new VCardParser(this);
     parser->setProperty("DATA", QVariant::fromValue<QDBusMessage>(message));
+    parser->setProperty("VCARDS", vcards);
+    parser->setProperty("POSITIONS", pagePositions);
+    parser->setProperty("IDS", pageIds);
+    parser->setProperty("INDIVIDUALS", pageIndividuals);
+    parser->setProperty("REVISIONS", pageRevisions);
+    parser->setProperty("CACHE_KEY", cacheKey);
     connect(parser, &VCardParser::vcardParsed,
             this, &View::onVCardParsed);
     parser->contactToVcard(pageOfContacts);
     return QStringList();
 }
 
+QByteArray View::contactsDetailsBinary(const QStringList &fields, int startIndex, int pageSize, const QDBusMessage &message)
+{
+    if (!m_filterThread || !isOpen()) {
+        return QByteArray();
+    }
+
+    waitFilter();
+
+    QList<QContact> pageOfContacts = contactsPage(fields, startIndex, pageSize);
+    QDBusMessage reply = message.createReply(QVariant::fromValue<QByteArray>(ContactCodec::encode(pageOfContacts)));
+    QDBusConnection::sessionBus().send(reply);
+    return QByteArray();
+}
+
+QDBusUnixFileDescriptor View::contactsDetailsFile(const QStringList &fields, const QDBusMessage &message)
+{
+    if (!m_filterThread || !isOpen()) {
+        return QDBusUnixFileDescriptor();
+    }
+
+    waitFilter();
+
+    int fd = ContactCodec::encodeToFile(contactsPage(fields, 0, -1));
+    if (fd == -1) {
+        QDBusConnection::sessionBus().send(message.createErrorReply(QDBusError::NotSupported,
+                                                                    "Fail to create contacts file"));
+        return QDBusUnixFileDescriptor();
+    }
+
+    // QDBusUnixFileDescriptor keeps a duplicated fd
+    QDBusMessage reply = message.createReply(QVariant::fromValue<QDBusUnixFileDescriptor>(QDBusUnixFileDescriptor(fd)));
+    ::close(fd);
+    QDBusConnection::sessionBus().send(reply);
+    return QDBusUnixFileDescriptor();
+}
+
+QList<QContact> View::contactsPage(const QStringList &fields, int startIndex, int pageSize) const
+{
+    const QList<ContactEntry*> contacts = m_filterThread->result();
+    if (startIndex < 0) {
+        startIndex = 0;
+    }
+
+    if ((pageSize < 0) || ((startIndex + pageSize) >= contacts.count())) {
+        pageSize = contacts.count() - startIndex;
+    }
+
+    QList<QContactDetail::DetailType> detailTypes = FetchHint::parseFieldNames(fields);
+    QList<QContact> pageOfContacts;
+    for(int i = startIndex, iMax = (startIndex + pageSize); i < iMax; i++) {
+        pageOfContacts << QIndividual::copy(contacts.at(i)->individual()->contact(detailTypes), detailTypes);
+    }
+    return pageOfContacts;
+}
+
 void View::onVCardParsed(const QStringList &vcards)
 {
     QObject *sender = QObject::sender();
-    QDBusMessage reply = sender->property("DATA").value<QDBusMessage>().createReply(vcards);
+    QStringList page = sender->property("VCARDS").toStringList();
+    QVariantList positions = sender->property("POSITIONS").toList();
+    QStringList ids = sender->property("IDS").toStringList();
+    QVariantList individuals = sender->property("INDIVIDUALS").toList();
+    QVariantList revisions = sender->property("REVISIONS").toList();
+    QString cacheKey = sender->property("CACHE_KEY").toString();
+
+    for(int i = 0; (i < vcards.size()) && (i < positions.size()); i++) {
+        page[positions[i].toInt()] = vcards[i];
+
+        // store the new vcard on the cache of the exported individual only, the
+        // contacts map can be replaced while the vcards are exported
+        ContactEntry *entry = (m_allContacts && !ids[i].isEmpty()) ? m_allContacts->value(ids[i]) : 0;
+        if (entry && (entry->individual() == individuals[i].value<void*>())) {
+            entry->individual()->setVcard(cacheKey, vcards[i], revisions[i].toUInt());
+        }
+    }
+
+    QDBusMessage reply = sender->property("DATA").value<QDBusMessage>().createReply(page);
     QDBusConnection::sessionBus().send(reply);
     sender->deleteLater();
 }
@@ -324,6 +653,8 @@ void View::onFilterDone()
     if (m_waiting) {
         m_waiting->quit();
         m_waiting = 0;
+    } else {
+        applyPendingChanges();
     }
 }
 
@@ -334,6 +665,36 @@ void View::waitFilter()
         m_waiting = &loop;
         loop.exec();
     }
+    applyPendingChanges();
+}
+
+void View::applyPendingChanges()
+{
+    if (!m_filterThread || !m_filterThread->done()) {
+        return;
+    }
+
+    // the filter result is based on the contacts map at the filter start,
+    // the changes must not wait for the filter again: that would release the
+    // snapshot while the removed entries are still in use
+    QList<QPair<ChangeType, ContactEntry*> > changes = m_pendingChanges;
+    m_pendingChanges.clear();
+    for(int i = 0; i < changes.size(); i++) {
+        switch(changes[i].first) {
+        case ChangeAppend:
+            appendContactImpl(changes[i].second);
+            break;
+        case ChangeRemove:
+            removeContactImpl(changes[i].second);
+            break;
+        case ChangeUpdate:
+            updateContactImpl(changes[i].second);
+            break;
+        }
+    }
+
+    // the removed contacts are not used anymore
+    m_filterThread->releaseSnapshot();
 }
 
 int View::count()
@@ -353,6 +714,13 @@ void View::sort(const QString &field)
         return;
     }
 
+    waitFilter();
+
+    // the view is sorted by itself from now on
+    if (m_allContacts) {
+        m_allContacts->releaseSort(m_sortClause);
+    }
+    m_sortClause = SortClause(QString());
     m_filterThread->chageSort(SortClause(field));
 }
 
@@ -396,12 +764,35 @@ bool View::appendContact(ContactEntry *entry)
         return false;
     }
 
-    if (m_filterThread->appendContact(entry->individual()->contact(),
-                                      entry->individual()->deletedAt())) {
-        Q_EMIT countChanged(m_filterThread->result().count());
-        return true;
+    // do not wait for the filter, the change is applied on the result later
+    if (!m_filterThread->done()) {
+        m_pendingChanges << qMakePair(ChangeAppend, entry);
+        return false;
     }
-    return false;
+
+    waitFilter();
+    return appendContactImpl(entry);
+}
+
+bool View::appendContactImpl(ContactEntry *entry)
+{
+    if (m_filterThread->indexOf(entry) != -1) {
+        return updateContactImpl(entry);
+    }
+
+    if (!m_filterThread->acceptContact(entry)) {
+        return false;
+    }
+
+    int pos = m_filterThread->insertContact(entry);
+    if (pos == -1) {
+        return false;
+    }
+
+    Q_EMIT m_adaptor->contactsAdded(pos, 1);
+    notifyTrim();
+    Q_EMIT countChanged(m_filterThread->result().count());
+    return true;
 }
 
 bool View::removeContact(ContactEntry *entry)
@@ -410,11 +801,98 @@ bool View::removeContact(ContactEntry *entry)
         return false;
     }
 
-    if (m_filterThread->removeContact(entry->individual()->contact())) {
+    // do not wait for the filter, the change is applied on the result later
+    if (!m_filterThread->done()) {
+        m_pendingChanges << qMakePair(ChangeRemove, entry);
+        return false;
+    }
+
+    waitFilter();
+    return removeContactImpl(entry);
+}
+
+bool View::removeContactImpl(ContactEntry *entry)
+{
+    bool full = m_filterThread->isFull();
+    int pos = m_filterThread->takeContact(entry);
+    if (pos == -1) {
+        return false;
+    }
+
+    Q_EMIT m_adaptor->contactsRemoved(pos, 1);
+    if (full) {
+        // the contact is removed from the contacts map after the views
+        notifyBackfill(entry);
+    }
+    Q_EMIT countChanged(m_filterThread->result().count());
+    return true;
+}
+
+bool View::updateContact(ContactEntry *entry)
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    // do not wait for the filter, the change is applied on the result later
+    if (!m_filterThread->done()) {
+        m_pendingChanges << qMakePair(ChangeUpdate, entry);
+        return false;
+    }
+
+    waitFilter();
+    return updateContactImpl(entry);
+}
+
+bool View::updateContactImpl(ContactEntry *entry)
+{
+    int count = m_filterThread->result().count();
+    bool full = m_filterThread->isFull();
+    int oldPos = m_filterThread->takeContact(entry);
+    int newPos = m_filterThread->acceptContact(entry) ?
+                m_filterThread->insertContact(entry) : -1;
+
+    if ((oldPos == -1) && (newPos == -1)) {
+        return false;
+    }
+
+    if (oldPos == newPos) {
+        Q_EMIT m_adaptor->contactsUpdated(newPos, 1);
+    } else {
+        if (oldPos != -1) {
+            Q_EMIT m_adaptor->contactsRemoved(oldPos, 1);
+        }
+        if (newPos != -1) {
+            Q_EMIT m_adaptor->contactsAdded(newPos, 1);
+            notifyTrim();
+        }
+    }
+
+    // the contact left a full view
+    if (full && !m_filterThread->isFull()) {
+        notifyBackfill();
+    }
+
+    if (count != m_filterThread->result().count()) {
         Q_EMIT countChanged(m_filterThread->result().count());
-        return true;
     }
-    return false;
+    return true;
+}
+
+void View::notifyTrim()
+{
+    int pos = m_filterThread->trim();
+    if (pos != -1) {
+        Q_EMIT m_adaptor->contactsRemoved(pos, 1);
+    }
+}
+
+void View::notifyBackfill(ContactEntry *removed)
+{
+    int pos = m_filterThread->backfill(m_allContacts, removed);
+    if (pos != -1) {
+        Q_EMIT m_adaptor->contactsAdded(pos, 1);
+    }
 }
 
 QObject *View::adaptor() const
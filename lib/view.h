@@ -54,6 +54,7 @@ public:
     // contacts
     bool appendContact(ContactEntry *entry);
     bool removeContact(ContactEntry *entry);
+    bool updateContact(ContactEntry *entry);
 
     // Adaptor
     QString contactDetails(const QStringList &fields, const QString &id);
@@ -62,9 +63,14 @@ public:
     void close();
 
     bool isOpen() const;
+    void waitFilter();
+    // filter the contacts of a new contacts map, the current one will be destroyed
+    void setContacts(ContactsMap *contacts);
 
 public Q_SLOTS:
     QStringList contactsDetails(const QStringList &fields, int startIndex, int pageSize, const QDBusMessage &message);
+    QByteArray contactsDetailsBinary(const QStringList &fields, int startIndex, int pageSize, const QDBusMessage &message);
+    QDBusUnixFileDescriptor contactsDetailsFile(const QStringList &fields, const QDBusMessage &message);
     void onFilterDone();
 
 private Q_SLOTS:
@@ -76,11 +82,28 @@ Q_SIGNALS:
 
 private:
     QStringList m_sources;
+    ContactsMap *m_allContacts;
     FilterThread *m_filterThread;
     ViewAdaptor *m_adaptor;
     QEventLoop *m_waiting;
-
-    void waitFilter();
+    // sort kept by the contacts map for this view
+    SortClause m_sortClause;
+    // changes done on the contacts map while the filter is running
+    enum ChangeType {
+        ChangeAppend,
+        ChangeRemove,
+        ChangeUpdate
+    };
+    QList<QPair<ChangeType, ContactEntry*> > m_pendingChanges;
+
+    void notifyTrim();
+    void notifyBackfill(ContactEntry *removed = 0);
+    void applyPendingChanges();
+    // apply a change on the filter result, the filter must be done
+    bool appendContactImpl(ContactEntry *entry);
+    bool removeContactImpl(ContactEntry *entry);
+    bool updateContactImpl(ContactEntry *entry);
+    QList<QtContacts::QContact> contactsPage(const QStringList &fields, int startIndex, int pageSize) const;
 };
 
 } //namespace
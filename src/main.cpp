@@ -43,9 +43,7 @@ void onServiceReady(galera::AddressBook *book)
         if (demoFileData.open(QFile::ReadOnly)) {
             QByteArray demoData = demoFileData.readAll();
             QStringList vcards = galera::VCardParser::splitVcards(demoData);
-            Q_FOREACH(const QString &vcard, vcards) {
-                book->createContact(vcard, "");
-            }
+            book->createContacts(vcards, "");
         }
     }
 }
@@ -240,6 +240,44 @@ private Q_SLOTS:
         QCOMPARE(addedContactSpy.count(), 0);
     }
 
+    void testCreateContacts()
+    {
+        // spy 'contactsAdded' signal
+        QSignalSpy addedContactSpy(m_serverIface, SIGNAL(contactsAdded(QStringList)));
+
+        QStringList vcards;
+        for(int i = 0; i < 20; i++) {
+            vcards << QString(m_basicVcard).replace("Fulano_", QString("Fulano_%1").arg(i));
+        }
+        vcards.insert(10, "INVALID VCARD");
+
+        // create all contacts with a single call
+        QDBusReply<QStringList> reply = m_serverIface->call("createContacts", vcards, "dummy-store");
+        QStringList result = reply.value();
+
+        // the result has one item for each vcard in the same order
+        QCOMPARE(result.size(), vcards.size());
+        QVERIFY(result[10].isEmpty());
+        result.removeAt(10);
+        for(int i = 0; i < result.size(); i++) {
+            QtContacts::QContact newContact = galera::VCardParser::vcardToContact(result[i]);
+            QCOMPARE(newContact.detail<QtContacts::QContactName>().firstName(),
+                     QString("Fulano_%1").arg(i));
+        }
+
+        QDBusReply<QStringList> reply2 = m_dummyIface->call("listContacts");
+        QCOMPARE(reply2.value().count(), 20);
+
+        // check if the signal "contactAdded" was fired for all contacts
+        QTRY_VERIFY(addedContactSpy.count() > 0);
+        QTest::qWait(500);
+        QStringList ids;
+        Q_FOREACH(const QList<QVariant> &args, addedContactSpy) {
+            ids << args[0].toStringList();
+        }
+        QCOMPARE(ids.size(), 20);
+    }
+
     void testRemoveContact()
     {
         // create a basic contact
@@ -314,6 +352,80 @@ private Q_SLOTS:
         contactUpdatedResult = contacts[0];
         compareContact(contactUpdatedResult, contactUpdated);
     }
+
+    void testConcurrentUpdateContacts()
+    {
+        QSignalSpy addedContactSpy(m_serverIface, SIGNAL(contactsAdded(QStringList)));
+        QDBusReply<QString> replyAdd = m_serverIface->call("createContact", m_basicVcard, "dummy-store");
+        QString vcardA = replyAdd.value();
+        replyAdd = m_serverIface->call("createContact", QString(m_basicVcard).replace("Fulano_", "Beltrano_"), "dummy-store");
+        QString vcardB = replyAdd.value();
+        QTRY_COMPARE(addedContactSpy.count(), 2);
+
+        // the calls do not wait for each other, the updates of the same contact run in order
+        QList<QDBusPendingCall> calls;
+        calls << m_serverIface->asyncCall("updateContacts", QStringList() << QString(vcardA).replace("8888888", "1111111"));
+        calls << m_serverIface->asyncCall("updateContacts", QStringList() << QString(vcardB).replace("8888888", "2222222"));
+        calls << m_serverIface->asyncCall("updateContacts", QStringList() << QString(vcardA).replace("8888888", "3333333"));
+
+        QStringList numbers;
+        numbers << "1111111" << "2222222" << "3333333";
+        for(int i = 0; i < calls.size(); i++) {
+            QDBusPendingReply<QStringList> reply(calls[i]);
+            reply.waitForFinished();
+            QVERIFY(reply.isValid());
+            QCOMPARE(reply.value().size(), 1);
+            QVERIFY(reply.value().first().contains(numbers[i]));
+        }
+
+        // the last update wins
+        QDBusReply<QStringList> replyList = m_dummyIface->call("listContacts");
+        QString result = replyList.value().join("");
+        QVERIFY(result.contains("3333333"));
+        QVERIFY(result.contains("2222222"));
+        QVERIFY(!result.contains("1111111"));
+    }
+
+    /*
+     * Several clients updating different contacts at the same time
+     */
+    void benchmarkConcurrentUpdateContacts()
+    {
+        const int clients = 4;
+        const int contactsByClient = 25;
+
+        QSignalSpy addedContactSpy(m_serverIface, SIGNAL(contactsAdded(QStringList)));
+        QStringList vcards;
+        for(int i = 0; i < (clients * contactsByClient); i++) {
+            QDBusReply<QString> replyAdd = m_serverIface->call("createContact",
+                                                               QString(m_basicVcard).replace("Fulano_", QString("Fulano_%1").arg(i)),
+                                                               "dummy-store");
+            vcards << replyAdd.value();
+        }
+        QTRY_COMPARE(addedContactSpy.count(), vcards.size());
+
+        QList<QDBusInterface*> interfaces;
+        for(int c = 0; c < clients; c++) {
+            interfaces << new QDBusInterface(m_serverIface->service(),
+                                             m_serverIface->path(),
+                                             m_serverIface->interface());
+        }
+
+        int round = 0;
+        QBENCHMARK {
+            round++;
+            QList<QDBusPendingCall> calls;
+            for(int i = 0; i < vcards.size(); i++) {
+                QString vcard = QString(vcards[i]).replace("8888888", QString("8888%1").arg(round));
+                calls << interfaces[i % clients]->asyncCall("updateContacts", QStringList() << vcard);
+            }
+            Q_FOREACH(QDBusPendingCall call, calls) {
+                call.waitForFinished();
+            }
+        }
+
+        qDeleteAll(interfaces);
+    }
 };
 
 QTEST_MAIN(AddressBookTest)
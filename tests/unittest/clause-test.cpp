@@ -284,6 +284,37 @@ private Q_SLOTS:
         QCOMPARE(ids.size(), 0);
     }
 
+    void testExtractText()
+    {
+        QContactDetailFilter labelFilter;
+        labelFilter.setDetailType(QContactDisplayLabel::Type, QContactDisplayLabel::FieldLabel);
+        labelFilter.setValue("Fulano");
+        labelFilter.setMatchFlags(QContactFilter::MatchStartsWith);
+
+        QContactDetailFilter emailFilter;
+        emailFilter.setDetailType(QContactEmailAddress::Type, QContactEmailAddress::FieldEmailAddress);
+        emailFilter.setValue("fulano");
+        emailFilter.setMatchFlags(QContactFilter::MatchContains);
+
+        bool startsWith = false;
+        QCOMPARE(Filter(labelFilter).textToFilter(&startsWith), QStringLiteral("Fulano"));
+        QVERIFY(startsWith);
+
+        // all union terms need to look for the same text
+        QCOMPARE(Filter(labelFilter | emailFilter).textToFilter(&startsWith), QStringLiteral("fulano"));
+        QVERIFY(!startsWith);
+
+        QContactDetailFilter favoriteFilter;
+        favoriteFilter.setDetailType(QContactFavorite::Type, QContactFavorite::FieldFavorite);
+        favoriteFilter.setValue(true);
+        QVERIFY(Filter(favoriteFilter).textToFilter().isEmpty());
+        QVERIFY(Filter(labelFilter | favoriteFilter).textToFilter().isEmpty());
+        QCOMPARE(Filter(labelFilter & favoriteFilter).textToFilter(), QStringLiteral("Fulano"));
+
+        // phone numbers use the phone index
+        QVERIFY(Filter(QContactPhoneNumber::match("12345678")).textToFilter().isEmpty());
+    }
+
     void testIncludeDeleted()
     {
         QContactChangeLogFilter removedFilter;
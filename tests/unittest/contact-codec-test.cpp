@@ -0,0 +1,206 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtContacts>
+
+#include <unistd.h>
+
+#include "common/contact-codec.h"
+#include "common/vcard-parser.h"
+
+using namespace QtContacts;
+using namespace galera;
+
+class ContactCodecTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<QContact> m_contacts;
+
+    QContact createContact(int index)
+    {
+        QContact c;
+        c.setId(QContactId::fromString(QString("qtcontacts:memory::%1").arg(index)));
+
+        QContactGuid guid;
+        guid.setGuid(QString::number(index));
+        c.saveDetail(&guid);
+
+        QContactName name;
+        name.setFirstName(QString("Fulano %1").arg(index));
+        name.setLastName("de Tal");
+        name.setDetailUri("1.1");
+        c.saveDetail(&name);
+
+        QContactDisplayLabel label;
+        label.setLabel(QString("Fulano %1 de Tal").arg(index));
+        c.saveDetail(&label);
+
+        QContactTimestamp timestamp;
+        timestamp.setLastModified(QDateTime(QDate(2015, 4, 16), QTime(15, 26, 50), Qt::UTC));
+        timestamp.setCreated(QDateTime(QDate(2015, 4, 14), QTime(16, 16, 44), Qt::UTC));
+        c.saveDetail(&timestamp);
+
+        QContactBirthday birthday;
+        birthday.setDate(QDate(1980, 1, 1).addDays(index));
+        c.saveDetail(&birthday);
+
+        QContactFavorite favorite;
+        favorite.setFavorite((index % 2) == 0);
+        c.saveDetail(&favorite);
+
+        QContactEmailAddress email;
+        email.setEmailAddress(QString("fulano%1@ubuntu.com").arg(index));
+        email.setContexts(QContactDetail::ContextHome);
+        email.setDetailUri("1.1");
+        c.saveDetail(&email);
+
+        QContactPhoneNumber phone;
+        phone.setNumber(QString("555-%1").arg(index, 4, 10, QChar('0')));
+        phone.setSubTypes(QList<int>() << QContactPhoneNumber::SubTypeMobile);
+        phone.setDetailUri("1.2");
+        QContactManagerEngine::setDetailAccessConstraints(&phone, QContactDetail::ReadOnly);
+        c.saveDetail(&phone);
+        c.setPreferredDetail("TEL", phone);
+
+        QContactAvatar avatar;
+        avatar.setImageUrl(QUrl(QString("file:///tmp/avatar%1.png").arg(index)));
+        c.saveDetail(&avatar);
+
+        QContactSyncTarget target;
+        target.setDetailUri("1.ADDRESSBOOKID0");
+        target.setSyncTarget("ADDRESSBOOKNAME0");
+        target.setValue(QContactSyncTarget::FieldSyncTarget + 1, "source-id");
+        c.saveDetail(&target);
+
+        QContactExtendedDetail xDet;
+        xDet.setName("X-REMOTE-ID");
+        xDet.setData(QString("remote-%1").arg(index));
+        c.saveDetail(&xDet);
+
+        return c;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        // necessary to create the contact id
+        QContactManager manager("memory");
+        for(int i = 0; i < 50; i++) {
+            m_contacts << createContact(i);
+        }
+    }
+
+    void testEncodeDecode()
+    {
+        QContactManager manager("memory");
+        QList<QContact> contacts;
+        QVERIFY(ContactCodec::decode(ContactCodec::encode(m_contacts), &contacts));
+        QCOMPARE(contacts.size(), m_contacts.size());
+        for(int i = 0; i < contacts.size(); i++) {
+            QCOMPARE(contacts[i].id(), m_contacts[i].id());
+            QCOMPARE(contacts[i].details(), m_contacts[i].details());
+            QCOMPARE(contacts[i].preferredDetails(), m_contacts[i].preferredDetails());
+        }
+
+        QContactPhoneNumber phone = contacts[0].detail<QContactPhoneNumber>();
+        QVERIFY(phone.accessConstraints().testFlag(QContactDetail::ReadOnly));
+        QCOMPARE(phone.subTypes(), QList<int>() << QContactPhoneNumber::SubTypeMobile);
+    }
+
+    void testEncodeDecodeFile()
+    {
+        QContactManager manager("memory");
+        int fd = ContactCodec::encodeToFile(m_contacts);
+        if (fd == -1) {
+            QSKIP("memfd not supported");
+        }
+
+        // the file is sealed
+        QCOMPARE(write(fd, "a", 1), ssize_t(-1));
+
+        QList<QContact> contacts;
+        QVERIFY(ContactCodec::decodeFromFile(fd, &contacts));
+        close(fd);
+        QCOMPARE(contacts.size(), m_contacts.size());
+        for(int i = 0; i < contacts.size(); i++) {
+            QCOMPARE(contacts[i].id(), m_contacts[i].id());
+            QCOMPARE(contacts[i].details(), m_contacts[i].details());
+        }
+    }
+
+    void testEmptyList()
+    {
+        QList<QContact> contacts;
+        contacts << QContact();
+        QVERIFY(ContactCodec::decode(ContactCodec::encode(QList<QContact>()), &contacts));
+        QVERIFY(contacts.isEmpty());
+    }
+
+    void testInvalidData()
+    {
+        QList<QContact> contacts;
+        QVERIFY(!ContactCodec::decode(QByteArray("BEGIN:VCARD"), &contacts));
+
+        // truncated data
+        QByteArray data = ContactCodec::encode(m_contacts);
+        data.truncate(data.size() / 2);
+        QVERIFY(!ContactCodec::decode(data, &contacts));
+        QVERIFY(contacts.isEmpty());
+    }
+
+    /*
+     * Compare the size and the time necessary to send a page of contacts
+     * as vcards or using the binary format
+     */
+    void benchmarkPage_data()
+    {
+        QTest::addColumn<bool>("binary");
+
+        QTest::newRow("vcard") << false;
+        QTest::newRow("binary") << true;
+    }
+
+    void benchmarkPage()
+    {
+        QFETCH(bool, binary);
+
+        if (binary) {
+            qDebug() << "Page size in bytes:" << ContactCodec::encode(m_contacts).size();
+            QBENCHMARK {
+                QList<QContact> contacts;
+                ContactCodec::decode(ContactCodec::encode(m_contacts), &contacts);
+            }
+        } else {
+            qDebug() << "Page size in bytes:"
+                     << VCardParser::contactToVcardSync(m_contacts).join("").toUtf8().size();
+            QBENCHMARK {
+                VCardParser::vcardToContactSync(VCardParser::contactToVcardSync(m_contacts));
+            }
+        }
+    }
+};
+
+QTEST_MAIN(ContactCodecTest)
+
+#include "contact-codec-test.moc"
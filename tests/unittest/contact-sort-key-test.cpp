@@ -0,0 +1,194 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lib/contacts-map.h"
+#include "lib/contact-less-than.h"
+#include "lib/contact-sort-key.h"
+#include "lib/qindividual.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtContacts>
+
+using namespace QtContacts;
+
+class ContactSortKeyTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<galera::ContactEntry*> m_entries;
+
+    QContact createContact(int index)
+    {
+        static const QStringList names = QStringList()
+                << "Renato" << "renato" << "José" << "Jose" << "Álvaro" << "alvaro"
+                << "Zeca" << "Érica" << "erica" << "Ömer" << "" << "Bob" << "bob" << "1-800";
+
+        QContact contact;
+        QContactName name;
+        name.setFirstName(names[index % names.size()]);
+        name.setLastName(names[(index / names.size()) % names.size()]);
+        contact.saveDetail(&name);
+
+        if ((index % 7) != 0) {
+            QContactDisplayLabel label;
+            label.setLabel(QString("%1 %2").arg(name.firstName()).arg(name.lastName()).trimmed());
+            contact.saveDetail(&label);
+        }
+
+        if ((index % 3) == 0) {
+            QContactTag tag;
+            tag.setTag(name.firstName().left(1).toUpper());
+            contact.saveDetail(&tag);
+        }
+
+        if ((index % 5) != 0) {
+            QContactBirthday birthday;
+            birthday.setDate(QDate(1980, 1, 1).addDays(index % 11));
+            contact.saveDetail(&birthday);
+        }
+
+        return contact;
+    }
+
+    galera::ContactEntry *newEntry(const QContact &contact)
+    {
+        QString id = QString::number(m_entries.size());
+        galera::ContactEntry *entry =
+                new galera::ContactEntry(new galera::QIndividual(id, contact, QDateTime()));
+        m_entries << entry;
+        return entry;
+    }
+
+    static int sign(int value)
+    {
+        return (value > 0) - (value < 0);
+    }
+
+private Q_SLOTS:
+    void cleanup()
+    {
+        qDeleteAll(m_entries);
+        m_entries.clear();
+    }
+
+    void testCompare_data()
+    {
+        QTest::addColumn<QString>("sortClause");
+
+        QTest::newRow("default") << QString();
+        QTest::newRow("first name") << QString("FIRST_NAME");
+        QTest::newRow("last name desc") << QString("LAST_NAME DESC, FIRST_NAME ASC");
+        QTest::newRow("birthday") << QString("BIRTHDAY DESC, FULL_NAME");
+    }
+
+    void testCompare()
+    {
+        QFETCH(QString, sortClause);
+
+        galera::SortClause clause = sortClause.isEmpty() ?
+                    galera::ContactsMap::defaultSort() : galera::SortClause(sortClause);
+        QList<QContactSortOrder> sortOrders = clause.toContactSortOrder();
+
+        QList<QContact> contacts;
+        QList<galera::ContactSortKey> keys;
+        for(int i = 0; i < 200; i++) {
+            contacts << createContact(i);
+            keys << galera::ContactSortKey(contacts.last(), clause);
+        }
+
+        // the keys must sort the contacts as QContactManagerEngine
+        for(int a = 0; a < contacts.size(); a++) {
+            for(int b = 0; b < contacts.size(); b++) {
+                int expected = QContactManagerEngine::compareContact(contacts[a], contacts[b], sortOrders);
+                int result = keys[a].compare(keys[b], sortOrders);
+                if (sign(expected) != sign(result)) {
+                    qWarning() << contacts[a] << contacts[b];
+                    QCOMPARE(sign(result), sign(expected));
+                }
+            }
+        }
+    }
+
+    void testSortKeyCache()
+    {
+        galera::SortClause clause("FIRST_NAME");
+        QString name = galera::ContactSortKey::name(clause);
+
+        QContact contactA = createContact(0);   // Renato
+        QContact contactB = createContact(2);   // José
+        galera::ContactEntry *a = newEntry(contactA);
+        galera::ContactEntry *b = newEntry(contactB);
+
+        galera::ContactEntryLessThan lessThan(clause);
+        QVERIFY(lessThan(b, a));
+        QVERIFY(!lessThan(a, b));
+        QVERIFY(!a->individual()->sortKey(clause, name).isEmpty());
+
+        // descending order uses the same key
+        QCOMPARE(galera::ContactSortKey::name(galera::SortClause("FIRST_NAME DESC")), name);
+        galera::ContactEntryLessThan greaterThan(galera::SortClause("FIRST_NAME DESC"));
+        QVERIFY(greaterThan(a, b));
+    }
+
+    /*
+     * Compare the time necessary to sort the contacts using QContactManagerEngine::compareContact
+     * and using the cached sort keys
+     */
+    void benchmarkSort_data()
+    {
+        QTest::addColumn<bool>("sortKeys");
+
+        QTest::newRow("compare contact") << false;
+        QTest::newRow("sort keys") << true;
+    }
+
+    void benchmarkSort()
+    {
+        QFETCH(bool, sortKeys);
+
+        galera::SortClause clause = galera::ContactsMap::defaultSort();
+        QList<QContact> contacts;
+        QList<galera::ContactEntry*> entries;
+        for(int i = 0; i < 20000; i++) {
+            contacts << createContact(i);
+            entries << newEntry(contacts.last());
+        }
+
+        if (sortKeys) {
+            QBENCHMARK {
+                QList<galera::ContactEntry*> sorted = entries;
+                galera::ContactEntryLessThan lessThan(clause);
+                qSort(sorted.begin(), sorted.end(), lessThan);
+            }
+        } else {
+            QBENCHMARK {
+                QList<QContact> sorted = contacts;
+                galera::ContactLessThan lessThan(clause);
+                qSort(sorted.begin(), sorted.end(), lessThan);
+            }
+        }
+    }
+};
+
+QTEST_MAIN(ContactSortKeyTest)
+
+#include "contact-sort-key-test.moc"
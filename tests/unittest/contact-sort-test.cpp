@@ -202,6 +202,94 @@ private Q_SLOTS:
         QCOMPARE(contactsCreated[4].detail<QtContacts::QContactDisplayLabel>().label(), QStringLiteral("(999) 999-9999"));
         QCOMPARE(contactsCreated[5].detail<QtContacts::QContactDisplayLabel>().label(), QStringLiteral("555-5555"));
     }
+
+    /*
+     * Test if a open view notifies the position of the contacts changed
+     */
+    void testViewNotifyChanges()
+    {
+        m_serverIface->call("createContact", createContact("Foo Bar"), "dummy-store");
+        QDBusReply<QString> replyAdd = m_serverIface->call("createContact", createContact("Renato Araujo"), "dummy-store");
+        QString renatoId = galera::VCardParser::vcardToContact(replyAdd.value()).detail<QContactGuid>().guid();
+
+        QDBusMessage result = m_serverIface->call("query", "", "", 0, false, QStringList());
+        QDBusObjectPath viewObjectPath = result.arguments()[0].value<QDBusObjectPath>();
+        QDBusInterface *view = new QDBusInterface(m_serverIface->service(),
+                                                  viewObjectPath.path(),
+                                                  CPIM_ADDRESSBOOK_VIEW_IFACE_NAME);
+        QCOMPARE(view->property("count").toInt(), 2);
+
+        QSignalSpy addedSpy(view, SIGNAL(contactsAdded(int,int)));
+        QSignalSpy removedSpy(view, SIGNAL(contactsRemoved(int,int)));
+
+        // Baz Quux, Foo Bar, Renato Araujo
+        replyAdd = m_serverIface->call("createContact", createContact("Baz Quux"), "dummy-store");
+        QTRY_COMPARE(addedSpy.count(), 1);
+        QCOMPARE(addedSpy.takeFirst(), QList<QVariant>() << 0 << 1);
+        QCOMPARE(view->property("count").toInt(), 3);
+
+        // Baz Quux, Foo Bar
+        m_serverIface->call("removeContacts", QStringList() << renatoId);
+        QTRY_COMPARE(removedSpy.count(), 1);
+        QCOMPARE(removedSpy.takeFirst(), QList<QVariant>() << 2 << 1);
+        QCOMPARE(view->property("count").toInt(), 2);
+
+        // Foo Bar, Zed Quux
+        QString vcard = replyAdd.value();
+        m_serverIface->call("updateContacts", QStringList() << vcard.replace("Baz", "Zed"));
+        QTRY_VERIFY(addedSpy.count() > 0);
+        QCOMPARE(removedSpy.takeFirst(), QList<QVariant>() << 0 << 1);
+        QCOMPARE(addedSpy.takeFirst(), QList<QVariant>() << 1 << 1);
+
+        QDBusReply<QStringList> reply = view->call("contactsDetails", QStringList(), 0, 100);
+        QList<QtContacts::QContact> contacts = galera::VCardParser::vcardToContactSync(reply.value());
+        QCOMPARE(contacts.count(), 2);
+        QCOMPARE(contacts[0].detail<QtContacts::QContactDisplayLabel>().label(), QStringLiteral("Foo Bar"));
+        QCOMPARE(contacts[1].detail<QtContacts::QContactDisplayLabel>().label(), QStringLiteral("Zed Quux"));
+        delete view;
+    }
+
+    /*
+     * Test if a full view is filled with the next contact when a contact is removed
+     */
+    void testFullViewRemoveContact()
+    {
+        QDBusReply<QString> replyAdd = m_serverIface->call("createContact", createContact("Baz Quux"), "dummy-store");
+        QString bazId = galera::VCardParser::vcardToContact(replyAdd.value()).detail<QContactGuid>().guid();
+        replyAdd = m_serverIface->call("createContact", createContact("Foo Bar"), "dummy-store");
+        QString fooId = galera::VCardParser::vcardToContact(replyAdd.value()).detail<QContactGuid>().guid();
+        m_serverIface->call("createContact", createContact("Renato Araujo"), "dummy-store");
+
+        QDBusMessage result = m_serverIface->call("query", "", "", 2, false, QStringList());
+        QDBusObjectPath viewObjectPath = result.arguments()[0].value<QDBusObjectPath>();
+        QDBusInterface *view = new QDBusInterface(m_serverIface->service(),
+                                                  viewObjectPath.path(),
+                                                  CPIM_ADDRESSBOOK_VIEW_IFACE_NAME);
+        QCOMPARE(view->property("count").toInt(), 2);
+
+        QSignalSpy addedSpy(view, SIGNAL(contactsAdded(int,int)));
+        QSignalSpy removedSpy(view, SIGNAL(contactsRemoved(int,int)));
+
+        // Foo Bar, Renato Araujo
+        m_serverIface->call("removeContacts", QStringList() << bazId);
+        QTRY_COMPARE(addedSpy.count(), 1);
+        QCOMPARE(removedSpy.takeFirst(), QList<QVariant>() << 0 << 1);
+        QCOMPARE(addedSpy.takeFirst(), QList<QVariant>() << 1 << 1);
+        QCOMPARE(view->property("count").toInt(), 2);
+
+        // the removed contact is not added back: Renato Araujo
+        m_serverIface->call("removeContacts", QStringList() << fooId);
+        QTRY_COMPARE(removedSpy.count(), 1);
+        QCOMPARE(removedSpy.takeFirst(), QList<QVariant>() << 0 << 1);
+        QCOMPARE(addedSpy.count(), 0);
+        QCOMPARE(view->property("count").toInt(), 1);
+
+        QDBusReply<QStringList> reply = view->call("contactsDetails", QStringList(), 0, 100);
+        QList<QtContacts::QContact> contacts = galera::VCardParser::vcardToContactSync(reply.value());
+        QCOMPARE(contacts.count(), 1);
+        QCOMPARE(contacts[0].detail<QtContacts::QContactDisplayLabel>().label(), QStringLiteral("Renato Araujo"));
+        delete view;
+    }
 };
 
 QTEST_MAIN(ContactSortTest)
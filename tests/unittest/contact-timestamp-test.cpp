@@ -306,6 +306,49 @@ private Q_SLOTS:
         QCOMPARE(ids.at(0), contact.id());
     }
 
+    void testRemoveContactsDeletedFilter()
+    {
+        QDateTime currentDate = QDateTime::currentDateTime();
+        // wait one sec to cause a create date later
+        QTest::qWait(1000);
+        QList<QContact> contacts;
+        for(int i = 0; i < 10; i++) {
+            contacts << galera::VCardParser::vcardToContact(QString("BEGIN:VCARD\r\n"
+                                                                    "VERSION:3.0\r\n"
+                                                                    "N:;Fulano %1;;;\r\n"
+                                                                    "EMAIL:fulano%1@gmail.com\r\n"
+                                                                    "END:VCARD\r\n").arg(i));
+        }
+
+        // create the contacts
+        bool result = m_manager->saveContacts(&contacts);
+        QCOMPARE(result, true);
+
+        QList<QContactId> contactIds;
+        Q_FOREACH(const QContact &contact, contacts) {
+            contactIds << contact.id();
+        }
+
+        // wait one more sec to remove the contacts
+        QTest::qWait(1000);
+
+        // all contacts are marked as deleted with a single request
+        result = m_manager->removeContacts(contactIds);
+        QVERIFY(result);
+
+        QContactChangeLogFilter fDeleted(QContactChangeLogFilter::EventRemoved);
+        fDeleted.setSince(currentDate);
+
+        QList<QContactId> ids = m_manager->contactIds(fDeleted);
+        QCOMPARE(ids.size(), contactIds.size());
+        Q_FOREACH(const QContactId &id, contactIds) {
+            QVERIFY(ids.contains(id));
+        }
+
+        // removed contacts are not returned anymore
+        QCOMPARE(m_manager->contactIds().size(), 0);
+    }
+
 };
 
 QTEST_MAIN(ContactTimeStampTest)
@@ -20,6 +20,7 @@
 #include "dummy-backend.h"
 #include "scoped-loop.h"
 
+#include "lib/contact-less-than.h"
 #include "lib/contacts-map.h"
 #include "lib/qindividual.h"
 
@@ -181,6 +182,157 @@ private Q_SLOTS:
         m_map.insert(entry);
     }
 
+    void testSortOrdering()
+    {
+        galera::SortClause clause("FIRST_NAME DESC");
+        galera::ContactEntryLessThan lessThan(clause);
+        QVERIFY(!m_map.hasSort(clause));
+
+        m_map.acquireSort(clause);
+        m_map.acquireSort(clause);
+        QVERIFY(m_map.hasSort(clause));
+
+        QList<galera::ContactEntry*> entries = m_map.values(clause);
+        QCOMPARE(entries.size(), m_map.size());
+        for(int i = 1; i < entries.size(); i++) {
+            QVERIFY(!lessThan(entries[i], entries[i - 1]));
+        }
+
+        // the ordering follows the map changes
+        FolksIndividual *individual = randomIndividual();
+        galera::ContactEntry *entry = m_map.take(individual);
+        QVERIFY(!m_map.values(clause).contains(entry));
+        m_map.insert(entry);
+        QCOMPARE(m_map.values(clause), entries);
+
+        // the ordering is kept until the last release
+        m_map.releaseSort(clause);
+        QVERIFY(m_map.hasSort(clause));
+        m_map.releaseSort(clause);
+        QVERIFY(!m_map.hasSort(clause));
+    }
+
+    void testSnapshot()
+    {
+        galera::ContactsMap map;
+        for(int i = 0; i < 3; i++) {
+            QtContacts::QContact contact;
+            QtContacts::QContactName name;
+            name.setFirstName(QString("Fulano_%1").arg(i));
+            contact.saveDetail(&name);
+            map.insert(new galera::ContactEntry(new galera::QIndividual(QString::number(i), contact, QDateTime())));
+        }
+
+        // the snapshot is not a lock, the map can change while a filter reads it
+        galera::ContactsMapSnapshot *snapshot = map.snapshot();
+        map.remove("0");
+        QtContacts::QContact contact;
+        map.insert(new galera::ContactEntry(new galera::QIndividual("3", contact, QDateTime())));
+        QCOMPARE(map.size(), 3);
+        QVERIFY(!map.contains(QString("0")));
+
+        // the snapshot keeps the contacts of its version
+        QList<galera::ContactEntry*> entries = snapshot->values(map.sort());
+        QCOMPARE(entries.size(), 3);
+        QCOMPARE(snapshot->values(QStringList() << "0" << "3").size(), 1);
+        // and the removed entry is still valid
+        QCOMPARE(snapshot->values(QStringList() << "0").first()->individual()->id(), QString("0"));
+
+        galera::ContactsMapSnapshot *newSnapshot = map.snapshot();
+        QVERIFY(newSnapshot->version() > snapshot->version());
+        QCOMPARE(newSnapshot->values(QStringList() << "0" << "3").size(), 1);
+        QCOMPARE(newSnapshot->values(QStringList() << "3").first()->individual()->id(), QString("3"));
+
+        delete snapshot;
+        delete newSnapshot;
+    }
+
+    void testBatch()
+    {
+        galera::ContactsMap map;
+        galera::ContactsMap expected;
+        for(int i = 0; i < 10; i++) {
+            QtContacts::QContact contact;
+            QtContacts::QContactName name;
+            name.setFirstName(QString("Fulano_%1").arg(9 - i));
+            contact.saveDetail(&name);
+            map.insert(new galera::ContactEntry(new galera::QIndividual(QString::number(i), contact, QDateTime())));
+            expected.insert(new galera::ContactEntry(new galera::QIndividual(QString::number(i), contact, QDateTime())));
+        }
+
+        map.beginBatch();
+        map.remove("0");
+        galera::ContactEntry *entry = map.take(QString("5"));
+        QtContacts::QContact contact;
+        QtContacts::QContactName name;
+        name.setFirstName("Beltrano");
+        contact.saveDetail(&name);
+        map.insert(new galera::ContactEntry(new galera::QIndividual("10", contact, QDateTime())));
+        map.insert(entry);
+
+        // the id lookups are updated during the batch
+        QVERIFY(!map.contains(QString("0")));
+        QVERIFY(map.contains(QString("10")));
+        map.commitBatch();
+
+        expected.remove("0");
+        expected.insert(new galera::ContactEntry(new galera::QIndividual("10", contact, QDateTime())));
+
+        QCOMPARE(map.size(), expected.size());
+        QList<galera::ContactEntry*> entries = map.values();
+        QList<galera::ContactEntry*> expectedEntries = expected.values();
+        QCOMPARE(entries.size(), expectedEntries.size());
+        for(int i = 0; i < entries.size(); i++) {
+            QCOMPARE(entries[i]->individual()->id(), expectedEntries[i]->individual()->id());
+        }
+        QCOMPARE(map.valueByText("Beltrano", true).size(), 1);
+    }
+
+    void testPartialContact()
+    {
+        galera::QIndividual individual(randomIndividual(), m_dummy->aggregator());
+        QtContacts::QContact partial = individual.contact(QList<QtContacts::QContactDetail::DetailType>()
+                                                          << QtContacts::QContactDetail::TypePhoneNumber);
+        QtContacts::QContact full = individual.contact();
+
+        QCOMPARE(partial.id(), full.id());
+        QCOMPARE(partial.details<QtContacts::QContactPhoneNumber>(),
+                 full.details<QtContacts::QContactPhoneNumber>());
+        QCOMPARE(partial.detail<QtContacts::QContactDisplayLabel>(),
+                 full.detail<QtContacts::QContactDisplayLabel>());
+        QVERIFY(partial.details().size() <= full.details().size());
+    }
+
+    /*
+     * Compare the time necessary to load the full contact with the time
+     * necessary to load only the details used by a phone number filter
+     */
+    void benchmarkContact_data()
+    {
+        QTest::addColumn<bool>("partial");
+
+        QTest::newRow("full") << false;
+        QTest::newRow("phone number") << true;
+    }
+
+    void benchmarkContact()
+    {
+        QFETCH(bool, partial);
+
+        QList<QtContacts::QContactDetail::DetailType> types;
+        types << QtContacts::QContactDetail::TypePhoneNumber;
+        QBENCHMARK {
+            Q_FOREACH(FolksIndividual *individual, m_individuals) {
+                galera::QIndividual qIndividual(individual, m_dummy->aggregator());
+                if (partial) {
+                    qIndividual.contact(types);
+                } else {
+                    qIndividual.contact();
+                }
+            }
+        }
+    }
+
     void testLookupByVcard()
     {
         FolksIndividual *individual = randomIndividual();
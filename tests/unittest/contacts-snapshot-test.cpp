@@ -0,0 +1,265 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "lib/contacts-map.h"
+#include "lib/contacts-snapshot.h"
+#include "lib/qindividual.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+#include <QTemporaryDir>
+
+#include <QtContacts>
+
+using namespace QtContacts;
+
+class ContactsSnapshotTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir m_tmpDir;
+
+    QString snapshotFile() const
+    {
+        return m_tmpDir.path() + "/" + ADDRESS_BOOK_SNAPSHOT_FILE;
+    }
+
+    galera::ContactEntry *createEntry(const QString &id, const QString &name, const QString &phoneNumber)
+    {
+        QContact contact;
+        QContactGuid guid;
+        guid.setGuid(id);
+        contact.saveDetail(&guid);
+
+        QContactName cName;
+        cName.setFirstName(name);
+        contact.saveDetail(&cName);
+
+        QContactDisplayLabel label;
+        label.setLabel(name);
+        contact.saveDetail(&label);
+
+        QContactTag tag;
+        tag.setTag(name.left(1).toUpper());
+        contact.saveDetail(&tag);
+
+        QContactPhoneNumber phone;
+        phone.setNumber(phoneNumber);
+        contact.saveDetail(&phone);
+
+        return new galera::ContactEntry(new galera::QIndividual(id, contact, QDateTime()));
+    }
+
+    void fillMap(galera::ContactsMap *map)
+    {
+        map->insert(createEntry("id-3", "Charlie", "33331410"));
+        map->insert(createEntry("id-1", "Alice", "87042155"));
+        map->insert(createEntry("id-2", "Bob", "12345678"));
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QVERIFY(m_tmpDir.isValid());
+    }
+
+    void cleanup()
+    {
+        QFile::remove(snapshotFile());
+    }
+
+    void testLoadWithoutFile()
+    {
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(!snapshot.load());
+        QVERIFY(snapshot.contacts() == 0);
+    }
+
+    void testSaveAndLoad()
+    {
+        galera::ContactsMap map;
+        fillMap(&map);
+
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(snapshot.save(&map));
+        QVERIFY(snapshot.load());
+
+        galera::ContactsMap *contacts = snapshot.contacts();
+        QVERIFY(contacts);
+        QCOMPARE(contacts->size(), map.size());
+
+        // keep the map order
+        QList<galera::ContactEntry*> entries = contacts->values();
+        QCOMPARE(entries[0]->individual()->id(), QStringLiteral("id-1"));
+        QCOMPARE(entries[1]->individual()->id(), QStringLiteral("id-2"));
+        QCOMPARE(entries[2]->individual()->id(), QStringLiteral("id-3"));
+        QCOMPARE(entries[1]->individual()->contact().detail<QContactName>().firstName(),
+                 QStringLiteral("Bob"));
+
+        // indexes are rebuilt
+        QVERIFY(contacts->value("id-2"));
+        QCOMPARE(contacts->valueByPhone("87042155").size(), 1);
+        QCOMPARE(contacts->valueByPhone("87042155").first()->individual()->id(),
+                 QStringLiteral("id-1"));
+        QVERIFY(!contacts->value("id-2")->individual()->deletedAt().isValid());
+
+        snapshot.release();
+        QVERIFY(snapshot.contacts() == 0);
+    }
+
+    void testVcardCache()
+    {
+        galera::ContactsMap map;
+        fillMap(&map);
+
+        galera::QIndividual *individual = map.value("id-1")->individual();
+
+        // vcards created for an old revision are ignored
+        const QString nameFields = galera::QIndividual::vcardKey(QList<QContactDetail::DetailType>()
+                                                                 << QContactDetail::TypeName
+                                                                 << QContactDetail::TypeAvatar);
+        individual->setVcard(nameFields, "BEGIN:VCARD\r\nEND:VCARD\r\n", individual->revision() + 1);
+        QVERIFY(individual->vcard(nameFields).isEmpty());
+        individual->setVcard(nameFields, "BEGIN:VCARD\r\nEND:VCARD\r\n", individual->revision());
+        QVERIFY(!individual->vcard(nameFields).isEmpty());
+
+        // the key does not depend on the fields order
+        QCOMPARE(galera::QIndividual::vcardKey(QList<QContactDetail::DetailType>()
+                                               << QContactDetail::TypeAvatar
+                                               << QContactDetail::TypeName
+                                               << QContactDetail::TypeName),
+                 nameFields);
+    }
+
+    void testLoadOnDemand()
+    {
+        galera::ContactsMap map;
+        fillMap(&map);
+
+        QContact contact = map.value("id-2")->individual()->contact();
+        QContactBirthday birthday;
+        birthday.setDate(QDate(1980, 5, 12));
+        contact.saveDetail(&birthday);
+        map.insert(new galera::ContactEntry(new galera::QIndividual("id-5", contact, QDateTime())));
+
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(snapshot.save(&map));
+        QVERIFY(snapshot.load());
+
+        // only the summary details are decoded while loading
+        galera::QIndividual *individual = snapshot.contacts()->value("id-5")->individual();
+        QContact summary = individual->contact(QList<QContactDetail::DetailType>() << QContactDetail::TypeName);
+        QCOMPARE(summary.detail<QContactName>().firstName(), QStringLiteral("Bob"));
+        QVERIFY(summary.detail<QContactBirthday>().isEmpty());
+
+        // the full contact is decoded from the file
+        QContact full = individual->contact(QList<QContactDetail::DetailType>() << QContactDetail::TypeBirthday);
+        QCOMPARE(full.detail<QContactBirthday>().date(), QDate(1980, 5, 12));
+        QCOMPARE(full.detail<QContactPhoneNumber>().number(), QStringLiteral("12345678"));
+        QCOMPARE(full.id(), QContactId("qtcontacts:galera:", QByteArray("id-5")));
+    }
+
+    void testSyncWithoutChanges()
+    {
+        galera::ContactsMap map;
+        fillMap(&map);
+
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(snapshot.save(&map));
+        QVERIFY(snapshot.load());
+
+        // the contacts are compared by content
+        QSet<QString> added;
+        QSet<QString> removed;
+        QSet<QString> changed;
+        QVERIFY(snapshot.sync(&map, &added, &removed, &changed));
+        QVERIFY(added.isEmpty());
+        QVERIFY(removed.isEmpty());
+        QVERIFY(changed.isEmpty());
+    }
+
+    void testInvalidFile()
+    {
+        QFile file(snapshotFile());
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("BEGIN:VCARD\r\nEND:VCARD\r\n");
+        file.close();
+
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(!snapshot.load());
+        QVERIFY(snapshot.contacts() == 0);
+    }
+
+    void testTruncatedFile()
+    {
+        galera::ContactsMap map;
+        fillMap(&map);
+
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(snapshot.save(&map));
+
+        // the last record offset is past the end of the file
+        QFile file(snapshotFile());
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.resize(file.size() / 2));
+        file.close();
+
+        QVERIFY(!snapshot.load());
+        QVERIFY(snapshot.contacts() == 0);
+    }
+
+    void testSync()
+    {
+        galera::ContactsMap map;
+        fillMap(&map);
+
+        galera::ContactsSnapshot snapshot(snapshotFile());
+        QVERIFY(snapshot.save(&map));
+        QVERIFY(snapshot.load());
+
+        // simulate the changes received from folks
+        map.remove("id-3");
+        map.insert(createEntry("id-4", "Dave", "32634146"));
+        galera::ContactEntry *entry = map.take("id-2");
+        delete entry;
+        map.insert(createEntry("id-2", "Bob", "32634911"));
+
+        QSet<QString> added;
+        QSet<QString> removed;
+        QSet<QString> changed;
+        QVERIFY(snapshot.sync(&map, &added, &removed, &changed));
+        QCOMPARE(added, QSet<QString>() << "id-4");
+        QCOMPARE(removed, QSet<QString>() << "id-3");
+        QCOMPARE(changed, QSet<QString>() << "id-2");
+
+        // the new file contains the live contacts
+        QVERIFY(snapshot.save(&map));
+        QVERIFY(snapshot.load());
+        QCOMPARE(snapshot.contacts()->size(), 3);
+        QVERIFY(snapshot.contacts()->value("id-4"));
+        QVERIFY(!snapshot.contacts()->value("id-3"));
+    }
+};
+
+QTEST_MAIN(ContactsSnapshotTest)
+
+#include "contacts-snapshot-test.moc"
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtContacts>
+
+#include "common/filter.h"
+#include "common/filter-program.h"
+
+using namespace QtContacts;
+using namespace galera;
+
+class FilterProgramTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<QContact> m_contacts;
+
+    QContact createContact(const QString &firstName, const QString &lastName,
+                           const QString &phoneNumber, bool favorite)
+    {
+        QContact c;
+        QContactName name;
+        name.setFirstName(firstName);
+        name.setLastName(lastName);
+        c.saveDetail(&name);
+
+        QContactPhoneNumber phone;
+        phone.setNumber(phoneNumber);
+        c.saveDetail(&phone);
+
+        QContactFavorite fav;
+        fav.setFavorite(favorite);
+        c.saveDetail(&fav);
+        return c;
+    }
+
+    // a filter similar to the ones used by the contacts app search
+    QContactFilter searchFilter()
+    {
+        QContactDetailFilter nameFilter;
+        nameFilter.setDetailType(QContactName::Type, QContactName::FieldFirstName);
+        nameFilter.setMatchFlags(QContactFilter::MatchContains);
+        nameFilter.setValue("fulano 99");
+
+        QContactDetailFilter favFilter;
+        favFilter.setDetailType(QContactFavorite::Type, QContactFavorite::FieldFavorite);
+        favFilter.setValue(true);
+
+        return QContactPhoneNumber::match("555-0199") | (favFilter & nameFilter);
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        for(int i = 0; i < 1000; i++) {
+            m_contacts << createContact(QString("Fulano %1").arg(i),
+                                        QString("de Tal"),
+                                        QString("555-%1").arg(i, 4, 10, QChar('0')),
+                                        (i % 10) == 0);
+        }
+    }
+
+    void testSameResultAsFilter_data()
+    {
+        QTest::addColumn<QString>("query");
+        QTest::addColumn<int>("flags");
+
+        QTest::newRow("phone match") << "5550042" << int(QContactFilter::MatchPhoneNumber);
+        QTest::newRow("phone contains") << "004" << int(QContactFilter::MatchPhoneNumber | QContactFilter::MatchContains);
+        QTest::newRow("phone starts with") << "5550" << int(QContactFilter::MatchPhoneNumber | QContactFilter::MatchStartsWith);
+        QTest::newRow("phone ends with") << "0042" << int(QContactFilter::MatchPhoneNumber | QContactFilter::MatchEndsWith);
+        QTest::newRow("name contains") << "ANO 4" << int(QContactFilter::MatchContains);
+        QTest::newRow("name starts with") << "fulano 1" << int(QContactFilter::MatchStartsWith);
+        QTest::newRow("name ends with") << "42" << int(QContactFilter::MatchEndsWith);
+        QTest::newRow("name fixed string") << "fulano 7" << int(QContactFilter::MatchFixedString);
+        QTest::newRow("name case sensitive") << "fulano 7" << int(QContactFilter::MatchFixedString | QContactFilter::MatchCaseSensitive);
+    }
+
+    void testSameResultAsFilter()
+    {
+        QFETCH(QString, query);
+        QFETCH(int, flags);
+
+        QContactDetailFilter f;
+        if (flags & QContactFilter::MatchPhoneNumber) {
+            f.setDetailType(QContactPhoneNumber::Type, QContactPhoneNumber::FieldNumber);
+        } else {
+            f.setDetailType(QContactName::Type, QContactName::FieldFirstName);
+        }
+        f.setMatchFlags(QContactFilter::MatchFlags(QFlag(flags)));
+        f.setValue(query);
+
+        Filter filter(f);
+        FilterProgram program(filter);
+        Q_FOREACH(const QContact &c, m_contacts) {
+            QCOMPARE(program.test(c), filter.test(c));
+        }
+    }
+
+    void testCombinedFilter()
+    {
+        Filter filter(searchFilter());
+        FilterProgram program(filter);
+
+        int matches = 0;
+        Q_FOREACH(const QContact &c, m_contacts) {
+            bool result = program.test(c);
+            QCOMPARE(result, filter.test(c));
+            if (result) {
+                matches++;
+            }
+        }
+        // "555-0199" by phone and the favorite "Fulano 990" by name
+        QCOMPARE(matches, 2);
+    }
+
+    void testPresenceAndEmptyFilters()
+    {
+        QContactDetailFilter presence;
+        presence.setDetailType(QContactNickname::Type);
+        FilterProgram presenceProgram((Filter(presence)));
+        QVERIFY(!presenceProgram.test(m_contacts.first()));
+
+        presence.setDetailType(QContactName::Type);
+        presenceProgram = FilterProgram(Filter(presence));
+        QVERIFY(presenceProgram.test(m_contacts.first()));
+
+        FilterProgram emptyUnion((Filter(QContactUnionFilter())));
+        QVERIFY(!emptyUnion.test(m_contacts.first()));
+
+        FilterProgram all((Filter(QContactFilter())));
+        QVERIFY(all.test(m_contacts.first()));
+    }
+
+    void testDeletedContact()
+    {
+        QContact c = m_contacts.first();
+
+        QContactDetailFilter favFilter;
+        favFilter.setDetailType(QContactFavorite::Type, QContactFavorite::FieldFavorite);
+        favFilter.setValue(true);
+
+        FilterProgram favorites((Filter(favFilter)));
+        QVERIFY(favorites.test(c));
+        QVERIFY(!favorites.test(c, QDateTime::currentDateTime()));
+
+        QContactChangeLogFilter removedFilter;
+        removedFilter.setEventType(QContactChangeLogFilter::EventRemoved);
+        removedFilter.setSince(QDateTime::currentDateTime().addDays(-1));
+
+        FilterProgram removedFavorites(Filter(favFilter & removedFilter));
+        QVERIFY(!removedFavorites.test(c));
+        QVERIFY(removedFavorites.test(c, QDateTime::currentDateTime()));
+    }
+
+    void testIdFilter()
+    {
+        QContact c = m_contacts.first();
+        c.setId(QContactId("qtcontacts:galera:", QByteArray("42")));
+
+        QContactIdFilter idFilter;
+        idFilter.setIds(QList<QContactId>() << c.id());
+
+        FilterProgram program((Filter(idFilter)));
+        QVERIFY(program.test(c));
+        QVERIFY(!program.test(m_contacts.last()));
+    }
+
+    void testPhoneNumberRecords()
+    {
+        Filter filter(QContactPhoneNumber::match("+1 555-0042"));
+        FilterProgram program(filter);
+        Q_FOREACH(const QContact &c, m_contacts) {
+            QCOMPARE(program.test(c, QDateTime(), PhoneNumberRecord::fromContact(c)),
+                     filter.test(c));
+        }
+    }
+
+    void testPhoneFilterWithoutValue()
+    {
+        QContactDetailFilter f;
+        f.setDetailType(QContactPhoneNumber::Type, QContactPhoneNumber::FieldNumber);
+        f.setMatchFlags(QContactFilter::MatchPhoneNumber);
+
+        QContact noPhone;
+        QContactName name;
+        name.setFirstName("Ciclano");
+        noPhone.saveDetail(&name);
+
+        Filter filter(f);
+        FilterProgram program(filter);
+        Q_FOREACH(const QContact &c, m_contacts + (QList<QContact>() << noPhone)) {
+            QCOMPARE(program.test(c), filter.test(c));
+            QCOMPARE(program.test(c, QDateTime(), PhoneNumberRecord::fromContact(c)),
+                     filter.test(c));
+        }
+    }
+
+    void benchmarkFilter_data()
+    {
+        QTest::addColumn<bool>("compiled");
+
+        QTest::newRow("filter") << false;
+        QTest::newRow("compiled program") << true;
+    }
+
+    void benchmarkFilter()
+    {
+        QFETCH(bool, compiled);
+
+        Filter filter(searchFilter());
+        FilterProgram program(filter);
+
+        if (compiled) {
+            QBENCHMARK {
+                Q_FOREACH(const QContact &c, m_contacts) {
+                    program.test(c);
+                }
+            }
+        } else {
+            QBENCHMARK {
+                Q_FOREACH(const QContact &c, m_contacts) {
+                    filter.test(c);
+                }
+            }
+        }
+    }
+
+    void benchmarkPhoneNumberRecords_data()
+    {
+        QTest::addColumn<bool>("useRecords");
+
+        QTest::newRow("phone numbers processed by comparison") << false;
+        QTest::newRow("phone number records") << true;
+    }
+
+    void benchmarkPhoneNumberRecords()
+    {
+        QFETCH(bool, useRecords);
+
+        QList<QList<PhoneNumberRecord> > records;
+        Q_FOREACH(const QContact &c, m_contacts) {
+            records << PhoneNumberRecord::fromContact(c);
+        }
+
+        FilterProgram program(Filter(QContactPhoneNumber::match("+1 555-0042")));
+        if (useRecords) {
+            QBENCHMARK {
+                for(int i = 0; i < m_contacts.size(); i++) {
+                    program.test(m_contacts[i], QDateTime(), records[i]);
+                }
+            }
+        } else {
+            QBENCHMARK {
+                Q_FOREACH(const QContact &c, m_contacts) {
+                    program.test(c);
+                }
+            }
+        }
+    }
+};
+
+QTEST_MAIN(FilterProgramTest)
+
+#include "filter-program-test.moc"
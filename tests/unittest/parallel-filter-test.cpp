@@ -0,0 +1,201 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lib/contact-less-than.h"
+#include "lib/parallel-filter.h"
+#include "lib/qindividual.h"
+
+#include "common/filter.h"
+#include "common/filter-program.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtContacts>
+
+using namespace QtContacts;
+
+class ParallelFilterTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<galera::ContactEntry*> m_entries;
+    int m_threadCount;
+
+    QContact createContact(int index)
+    {
+        QContact contact;
+        QContactName name;
+        name.setFirstName(QString("Fulano %1").arg(qrand() % 1000));
+        name.setLastName("de Tal");
+        contact.saveDetail(&name);
+
+        QContactDisplayLabel label;
+        label.setLabel(QString("%1 %2").arg(name.firstName()).arg(name.lastName()));
+        contact.saveDetail(&label);
+
+        QContactFavorite favorite;
+        favorite.setFavorite((index % 3) == 0);
+        contact.saveDetail(&favorite);
+
+        QContactPhoneNumber phone;
+        phone.setNumber(QString("555-%1").arg(index, 5, 10, QChar('0')));
+        contact.saveDetail(&phone);
+
+        return contact;
+    }
+
+    galera::ParallelFilter programFilter(const galera::FilterProgram &program) const
+    {
+        return galera::ParallelFilter([&program] (galera::ContactEntry *entry) {
+                                          return program.test(entry->individual()->contact());
+                                      },
+                                      [] () { return false; });
+    }
+
+    static bool isSorted(const QList<galera::ContactEntry*> &entries, const galera::SortClause &sort)
+    {
+        galera::ContactEntryLessThan lessThan(sort);
+        for(int i = 1; i < entries.size(); i++) {
+            if (lessThan(entries[i], entries[i - 1])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        m_threadCount = galera::ParallelFilter::threadCount();
+        for(int i = 0; i < 20000; i++) {
+            m_entries << new galera::ContactEntry(new galera::QIndividual(QString::number(i),
+                                                                          createContact(i),
+                                                                          QDateTime()));
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        galera::ParallelFilter::setThreadCount(m_threadCount);
+        qDeleteAll(m_entries);
+        m_entries.clear();
+    }
+
+    void cleanup()
+    {
+        galera::ParallelFilter::setThreadCount(m_threadCount);
+    }
+
+    void testSameResultAsSingleThread_data()
+    {
+        QTest::addColumn<QString>("sort");
+        QTest::addColumn<int>("maxCount");
+
+        QTest::newRow("list order") << "" << 0;
+        QTest::newRow("list order max count") << "" << 100;
+        QTest::newRow("sorted") << "FIRST_NAME" << 0;
+        QTest::newRow("sorted max count") << "FIRST_NAME" << 100;
+    }
+
+    void testSameResultAsSingleThread()
+    {
+        QFETCH(QString, sort);
+        QFETCH(int, maxCount);
+
+        galera::SortClause clause(sort);
+        galera::FilterProgram program((galera::Filter(QContactFavorite::match())));
+        galera::ParallelFilter filter(programFilter(program));
+
+        galera::ParallelFilter::setThreadCount(1);
+        QList<galera::ContactEntry*> expected = filter.filter(m_entries, clause, maxCount);
+        QCOMPARE(expected.size(), maxCount > 0 ? maxCount : (m_entries.size() + 2) / 3);
+        QVERIFY(isSorted(expected, clause));
+
+        galera::ParallelFilter::setThreadCount(4);
+        QCOMPARE(filter.filter(m_entries, clause, maxCount), expected);
+    }
+
+    void testTopK_data()
+    {
+        QTest::addColumn<int>("threads");
+
+        QTest::newRow("1 thread") << 1;
+        QTest::newRow("4 threads") << 4;
+    }
+
+    void testTopK()
+    {
+        QFETCH(int, threads);
+
+        galera::ParallelFilter::setThreadCount(threads);
+        galera::SortClause clause("FIRST_NAME DESC");
+        galera::FilterProgram program((galera::Filter(QContactFavorite::match())));
+        galera::ParallelFilter filter(programFilter(program));
+
+        // the first contacts of the sort order, not the first ones of the list
+        QList<galera::ContactEntry*> all = filter.filter(m_entries, clause, 0);
+        QCOMPARE(filter.filter(m_entries, clause, 20), all.mid(0, 20));
+        QCOMPARE(filter.filter(m_entries, clause, 1), all.mid(0, 1));
+
+        // the first contacts of the list if there is no sort
+        QList<galera::ContactEntry*> first = filter.filter(m_entries, galera::SortClause(QString()), 20);
+        QCOMPARE(first.size(), 20);
+        QCOMPARE(first.first(), m_entries.first());
+    }
+
+    void testCancel()
+    {
+        galera::ParallelFilter::setThreadCount(4);
+        galera::ParallelFilter filter([] (galera::ContactEntry *) { return true; },
+                                      [] () { return true; });
+        QVERIFY(filter.filter(m_entries, galera::SortClause(QString()), 0).isEmpty());
+    }
+
+    /*
+     * Compare the time necessary to filter the contacts using 1, 2, 4 and 8 threads
+     */
+    void benchmarkFilter_data()
+    {
+        QTest::addColumn<int>("threads");
+
+        QTest::newRow("1 thread") << 1;
+        QTest::newRow("2 threads") << 2;
+        QTest::newRow("4 threads") << 4;
+        QTest::newRow("8 threads") << 8;
+    }
+
+    void benchmarkFilter()
+    {
+        QFETCH(int, threads);
+
+        galera::SortClause clause("FIRST_NAME");
+        galera::FilterProgram program((galera::Filter(QContactFavorite::match())));
+        galera::ParallelFilter filter(programFilter(program));
+        galera::ParallelFilter::setThreadCount(threads);
+        QBENCHMARK {
+            filter.filter(m_entries, clause, 0);
+        }
+    }
+};
+
+QTEST_MAIN(ParallelFilterTest)
+
+#include "parallel-filter-test.moc"
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lib/contacts-map.h"
+#include "lib/phone-index.h"
+#include "lib/qindividual.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtContacts>
+
+class PhoneIndexTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<galera::ContactEntry*> m_entries;
+
+    galera::ContactEntry *newEntry()
+    {
+        QString id = QString::number(m_entries.size());
+        galera::ContactEntry *entry =
+                new galera::ContactEntry(new galera::QIndividual(id, QtContacts::QContact(), QDateTime()));
+        m_entries << entry;
+        return entry;
+    }
+
+private Q_SLOTS:
+    void cleanup()
+    {
+        qDeleteAll(m_entries);
+        m_entries.clear();
+    }
+
+    void testMinimalNumber()
+    {
+        QCOMPARE(galera::PhoneIndex::minimalNumber("+55(81)87042155"), QStringLiteral("7042155"));
+        QCOMPARE(galera::PhoneIndex::minimalNumber("1234-5678"), QStringLiteral("2345678"));
+        QCOMPARE(galera::PhoneIndex::minimalNumber("190"), QStringLiteral("190"));
+        QCOMPARE(galera::PhoneIndex::minimalNumber("abcdefg"), QString());
+    }
+
+    void testPhoneNumberRecord()
+    {
+        galera::PhoneNumberRecord international("+55 (81) 8704-2155");
+        QCOMPARE(international.diallable(), QStringLiteral("+558187042155"));
+        QVERIFY(international.isParsed());
+        QCOMPARE(international.e164(), QStringLiteral("+558187042155"));
+
+        // numbers without country code can not be parsed without a region
+        galera::PhoneNumberRecord local("8704-2155");
+        QCOMPARE(local.diallable(), QStringLiteral("87042155"));
+        QVERIFY(!local.isParsed());
+        QVERIFY(local.e164().isEmpty());
+
+        QtContacts::QContactFilter::MatchFlags flags(QtContacts::QContactFilter::MatchPhoneNumber);
+        QVERIFY(galera::PhoneNumberRecord::compare(local, international, flags));
+        QVERIFY(galera::PhoneNumberRecord::compare(international, local, flags));
+        QVERIFY(!galera::PhoneNumberRecord::compare(galera::PhoneNumberRecord("abcdefg"), local, flags));
+    }
+
+    void testRecordsInsert()
+    {
+        galera::PhoneIndex index;
+        galera::ContactEntry *a = newEntry();
+
+        index.insert(a, QList<galera::PhoneNumberRecord>()
+                     << galera::PhoneNumberRecord("+55(81)87042155")
+                     << galera::PhoneNumberRecord("abcdefg"));
+        QCOMPARE(index.size(), 1);
+        QCOMPARE(index.lookup("8704-2155"), QList<galera::ContactEntry*>() << a);
+    }
+
+    void testLookup()
+    {
+        galera::PhoneIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+        galera::ContactEntry *c = newEntry();
+
+        index.insert(a, QStringList() << "+55(81)87042155" << "190");
+        index.insert(b, QStringList() << "(81)87042155");
+        index.insert(c, QStringList() << "87042155" << "8704-2155");
+        QCOMPARE(index.size(), 5);
+
+        // match the last 7 digits
+        QCOMPARE(index.lookup("87042155").size(), 3);
+        QCOMPARE(index.lookup("7042155").size(), 3);
+        // short numbers need to match exactly
+        QCOMPARE(index.lookup("190"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(index.lookup("90").size(), 0);
+        QCOMPARE(index.lookup("").size(), 0);
+    }
+
+    void testExactSuffixAndPrefix()
+    {
+        galera::PhoneIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+
+        index.insert(a, QStringList() << "+55(81)87042155");
+        index.insert(b, QStringList() << "(81)87042155");
+
+        QCOMPARE(index.exactMatch("8187042155"), QList<galera::ContactEntry*>() << b);
+        QCOMPARE(index.exactMatch("+55 81 8704 2155"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(index.suffixMatch("2155").size(), 2);
+        QCOMPARE(index.prefixMatch("+55"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(index.prefixMatch("81"), QList<galera::ContactEntry*>() << b);
+        QCOMPARE(index.prefixMatch("9").size(), 0);
+    }
+
+    void testUpdateAndRemove()
+    {
+        galera::PhoneIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+
+        index.insert(a, QStringList() << "12345678");
+        index.insert(b, QStringList() << "12345678" << "911");
+
+        index.update(a, QStringList() << "33331410");
+        QCOMPARE(index.lookup("12345678"), QList<galera::ContactEntry*>() << b);
+        QCOMPARE(index.lookup("33331410"), QList<galera::ContactEntry*>() << a);
+
+        index.remove(b);
+        QCOMPARE(index.size(), 1);
+        QCOMPARE(index.lookup("12345678").size(), 0);
+        QCOMPARE(index.lookup("911").size(), 0);
+        QCOMPARE(index.prefixMatch("1").size(), 0);
+
+        // removed nodes are reused
+        index.insert(b, QStringList() << "12345678");
+        QCOMPARE(index.lookup("12345678"), QList<galera::ContactEntry*>() << b);
+    }
+
+    void testCopy()
+    {
+        galera::PhoneIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+
+        // enough numbers to use more than one trie page
+        for(int i = 0; i < 100; i++) {
+            index.insert(a, QStringList() << QString("5550%1").arg(i, 3, 10, QChar('0')));
+        }
+        index.insert(b, QStringList() << "12345678");
+
+        // the copy keeps the old values after the original changes
+        galera::PhoneIndex copy(index);
+        index.remove(a);
+        index.insert(a, QStringList() << "33331410");
+
+        QCOMPARE(copy.size(), 101);
+        QCOMPARE(copy.lookup("5550042"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(copy.lookup("33331410").size(), 0);
+        QCOMPARE(copy.lookup("12345678"), QList<galera::ContactEntry*>() << b);
+
+        QCOMPARE(index.size(), 2);
+        QCOMPARE(index.lookup("5550042").size(), 0);
+        QCOMPARE(index.lookup("33331410"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(index.lookup("12345678"), QList<galera::ContactEntry*>() << b);
+    }
+
+    void testContactsMapLookup()
+    {
+        galera::ContactsMap map;
+        QtContacts::QContact contact;
+        QtContacts::QContactPhoneNumber phone;
+        phone.setNumber("+352 691 123456");
+        contact.saveDetail(&phone);
+        map.insert(new galera::ContactEntry(new galera::QIndividual("1", contact, QDateTime())));
+
+        QCOMPARE(map.valueByPhone("691123456").size(), 1);
+
+        galera::ContactEntry *entry = map.value("1");
+        phone.setNumber("32634146");
+        entry->individual()->contact().saveDetail(&phone);
+        map.updatePosition(entry);
+
+        QCOMPARE(map.valueByPhone("691123456").size(), 0);
+        QCOMPARE(map.valueByPhone("32634146").size(), 1);
+    }
+
+    void benchmarkLookup()
+    {
+        galera::PhoneIndex index;
+        for(int i = 0; i < 50000; i++) {
+            index.insert(newEntry(), QStringList() << QString("+55 81 9%1").arg(i, 8, 10, QChar('0')));
+        }
+
+        QList<galera::ContactEntry*> result;
+        QBENCHMARK {
+            result = index.lookup("+55 81 900025000");
+        }
+        QCOMPARE(result.size(), 1);
+    }
+};
+
+QTEST_MAIN(PhoneIndexTest)
+
+#include "phone-index-test.moc"
@@ -589,6 +589,57 @@ private Q_SLOTS:
         QCOMPARE(result, true);
         QTRY_COMPARE(spyContactAdded.count(), 1);
     }
+
+    /*
+     * Compare the time necessary to fetch all contacts using pages of contacts
+     * or a single file with all contacts
+     */
+    void benchmarkFetchAllContacts_data()
+    {
+        QTest::addColumn<bool>("fileTransport");
+
+        QTest::newRow("paged") << false;
+        QTest::newRow("file") << true;
+    }
+
+    void benchmarkFetchAllContacts()
+    {
+        QFETCH(bool, fileTransport);
+
+        QList<QContact> newContacts;
+        for(int i = 0; i < 100; i++) {
+            QContact contact = testContact();
+            QContactName name = contact.detail<QContactName>();
+            name.setFirstName(QString("Fulano %1").arg(i, 3, 10, QChar('0')));
+            contact.saveDetail(&name);
+            newContacts << contact;
+        }
+
+        QSignalSpy spyContactAdded(m_manager, SIGNAL(contactsAdded(QList<QContactId>)));
+        QVERIFY(m_manager->saveContacts(&newContacts));
+        QTRY_COMPARE(spyContactAdded.count(), newContacts.size());
+
+        // the transport is selected when the manager is created
+        delete m_manager;
+        qputenv("CANONICAL_PIM_SERVICE_FILE_TRANSPORT", fileTransport ? "1" : "0");
+        m_manager = new QContactManager("galera");
+        qunsetenv("CANONICAL_PIM_SERVICE_FILE_TRANSPORT");
+
+        QContactSortOrder sortFirstName;
+        sortFirstName.setDetailType(QContactName::Type, QContactName::FieldFirstName);
+
+        QList<QContact> contacts = m_manager->contacts(QContactFilter(), QList<QContactSortOrder>() << sortFirstName);
+        QCOMPARE(contacts.size(), newContacts.size());
+        for(int i = 0; i < contacts.size(); i++) {
+            QCOMPARE(contacts[i].detail<QContactName>().firstName(),
+                     newContacts[i].detail<QContactName>().firstName());
+            QVERIFY(!contacts[i].id().isNull());
+        }
+
+        QBENCHMARK {
+            m_manager->contacts(QContactFilter());
+        }
+    }
 };
 
 QTEST_MAIN(QContactsTest)
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This file is part of contact-service-app.
+ *
+ * contact-service-app is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * contact-service-app is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lib/contacts-map.h"
+#include "lib/text-index.h"
+#include "lib/qindividual.h"
+
+#include <QObject>
+#include <QtTest>
+#include <QDebug>
+
+#include <QtContacts>
+
+class TextIndexTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QList<galera::ContactEntry*> m_entries;
+
+    galera::ContactEntry *newEntry()
+    {
+        QString id = QString::number(m_entries.size());
+        galera::ContactEntry *entry =
+                new galera::ContactEntry(new galera::QIndividual(id, QtContacts::QContact(), QDateTime()));
+        m_entries << entry;
+        return entry;
+    }
+
+    QList<galera::ContactEntry*> lookup(const galera::TextIndex &index, const QString &text, bool startsWith = false)
+    {
+        QList<galera::ContactEntry*> result;
+        if (!index.lookup(text, startsWith, &result)) {
+            qWarning() << "Text not indexed" << text;
+        }
+        return result;
+    }
+
+private Q_SLOTS:
+    void cleanup()
+    {
+        qDeleteAll(m_entries);
+        m_entries.clear();
+    }
+
+    void testNormalize()
+    {
+        QCOMPARE(galera::TextIndex::normalize("José Araújo"), QStringLiteral("jose araujo"));
+        QCOMPARE(galera::TextIndex::normalize("FULANO"), QStringLiteral("fulano"));
+    }
+
+    void testContains()
+    {
+        galera::TextIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+
+        index.insert(a, QStringList() << "José Araújo" << "jose@ubuntu.com");
+        index.insert(b, QStringList() << "Maria Jose" << "maria@canonical.com");
+
+        QCOMPARE(lookup(index, "jos").size(), 2);
+        QCOMPARE(lookup(index, "JOSÉ").size(), 2);
+        QCOMPARE(lookup(index, "araujo"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(lookup(index, "ria jo"), QList<galera::ContactEntry*>() << b);
+        QCOMPARE(lookup(index, "ubuntu"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(lookup(index, "xyz").size(), 0);
+    }
+
+    void testSmallText()
+    {
+        galera::TextIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+
+        index.insert(a, QStringList() << "José Araújo");
+        index.insert(b, QStringList() << "Maria Jose");
+
+        QList<galera::ContactEntry*> result;
+        // small texts can not be used on contains queries
+        QVERIFY(!index.lookup("ar", false, &result));
+
+        // but can be used as word prefix
+        QVERIFY(index.lookup("ar", true, &result));
+        QCOMPARE(result, QList<galera::ContactEntry*>() << a);
+        QCOMPARE(lookup(index, "j", true).size(), 2);
+        QCOMPARE(lookup(index, "m", true), QList<galera::ContactEntry*>() << b);
+    }
+
+    void testUpdateAndRemove()
+    {
+        galera::TextIndex index;
+        galera::ContactEntry *a = newEntry();
+
+        index.insert(a, QStringList() << "Fulano de Tal");
+        QCOMPARE(lookup(index, "fulano").size(), 1);
+
+        index.update(a, QStringList() << "Beltrano");
+        QCOMPARE(lookup(index, "fulano").size(), 0);
+        QCOMPARE(lookup(index, "beltrano").size(), 1);
+
+        index.remove(a);
+        QCOMPARE(lookup(index, "beltrano").size(), 0);
+        QCOMPARE(lookup(index, "b", true).size(), 0);
+    }
+
+    void testCopy()
+    {
+        galera::TextIndex index;
+        galera::ContactEntry *a = newEntry();
+        galera::ContactEntry *b = newEntry();
+
+        index.insert(a, QStringList() << "Fulano de Tal");
+        index.insert(b, QStringList() << "Maria Jose");
+
+        // the copy keeps the old values after the original changes
+        galera::TextIndex copy(index);
+        index.update(a, QStringList() << "Beltrano");
+
+        QCOMPARE(lookup(copy, "fulano"), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(lookup(copy, "f", true), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(lookup(copy, "beltrano").size(), 0);
+        QCOMPARE(lookup(copy, "maria"), QList<galera::ContactEntry*>() << b);
+
+        QCOMPARE(lookup(index, "fulano").size(), 0);
+        QCOMPARE(lookup(index, "f", true).size(), 0);
+        QCOMPARE(lookup(index, "be", true), QList<galera::ContactEntry*>() << a);
+        QCOMPARE(lookup(index, "maria"), QList<galera::ContactEntry*>() << b);
+    }
+
+    void testContactsMapLookup()
+    {
+        galera::ContactsMap map;
+        QStringList names;
+        names << "Charlie Brown" << "Alice Cooper" << "Bob Dylan";
+        for(int i = 0; i < names.size(); i++) {
+            QtContacts::QContact contact;
+            QtContacts::QContactDisplayLabel label;
+            label.setLabel(names[i]);
+            contact.saveDetail(&label);
+            map.insert(new galera::ContactEntry(new galera::QIndividual(QString::number(i), contact, QDateTime())));
+        }
+
+        // results are returned in the map order
+        QList<galera::ContactEntry*> result = map.valueByText("co", true);
+        QCOMPARE(result.size(), 1);
+        QCOMPARE(result.first()->individual()->id(), QStringLiteral("1"));
+
+        result = map.valueByText("li", false);
+        QCOMPARE(result.size(), map.size());
+
+        result = map.valueByText("lic", false);
+        QCOMPARE(result.size(), 1);
+        QCOMPARE(result.first()->individual()->id(), QStringLiteral("1"));
+
+        result = map.valueByText("b", true);
+        QCOMPARE(result.size(), 2);
+        QCOMPARE(result[0]->individual()->id(), QStringLiteral("2"));
+        QCOMPARE(result[1]->individual()->id(), QStringLiteral("0"));
+    }
+};
+
+QTEST_MAIN(TextIndexTest)
+
+#include "text-index-test.moc"
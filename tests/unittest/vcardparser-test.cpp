@@ -20,10 +20,13 @@
 #include <QObject>
 #include <QtTest>
 #include <QDebug>
+#include <QTemporaryDir>
 
 #include <QtContacts>
 
 #include "common/vcard-parser.h"
+#include "common/vcard-reader.h"
+#include "common/vcard-writer.h"
 
 using namespace QtContacts;
 using namespace galera;
@@ -37,6 +40,7 @@ class VCardParseTest : public QObject
 private:
     QStringList m_vcards;
     QList<QContact> m_contacts;
+    QTemporaryDir m_tmpDir;
 
     void compareContact(const QtContacts::QContact &contact, const QtContacts::QContact &other)
     {
@@ -126,6 +130,189 @@ private:
         }
     }
 
+    /*
+     * Unfold the vcard lines and sort the parameters and the parameter values
+     * of each line, QtVersit writes them following the QHash order
+     */
+    QStringList normalizeVCard(const QString &vcard)
+    {
+        QStringList result;
+        QString unfolded(vcard);
+        unfolded.replace("\r\n ", "");
+        Q_FOREACH(const QString &line, unfolded.split("\r\n", QString::SkipEmptyParts)) {
+            int valueStart = line.indexOf(":");
+            QStringList params = line.left(valueStart).split(";");
+            QString name = params.takeFirst();
+            for(int i=0; i < params.size(); i++) {
+                QStringList param = params[i].split("=");
+                QStringList values = param.value(1).split(",");
+                values.sort();
+                params[i] = param.value(0) + "=" + values.join(",");
+            }
+            params.sort();
+            params.prepend(name);
+            result << params.join(";") + line.mid(valueStart);
+        }
+        return result;
+    }
+
+    QStringList versitExport(const QList<QContact> &contacts)
+    {
+        VCardParser parser;
+        parser.setFastExportEnabled(false);
+        parser.contactToVcard(contacts);
+        parser.waitForFinished();
+        return parser.vcardResult();
+    }
+
+    QContact testContact(const QString &contactType)
+    {
+        QContact contact = m_contacts[0];
+        if (contactType == "full") {
+            contact = fullContact();
+        } else if (contactType == "long values") {
+            QContactNote note;
+            note.setNote(QString("long note ").repeated(30));
+            contact.saveDetail(&note);
+            QContactExtendedDetail xDet;
+            xDet.setName("X-AVATAR-REV");
+            xDet.setData(QString("0123456789").repeated(12));
+            xDet.setDetailUri("1.1");
+            contact.saveDetail(&xDet);
+        } else if (contactType == "unicode") {
+            QContactName name = contact.detail<QContactName>();
+            name.setFirstName(QString::fromUtf8("Jo\xc3\xa3o \xf0\x9f\x98\x80 ").repeated(10));
+            contact.saveDetail(&name);
+        } else if (contactType == "with id") {
+            contact.setId(QContactId::fromString(QStringLiteral("qtcontacts:memory::11")));
+        } else if (contactType == "tag") {
+            QContactTag tag;
+            tag.setTag("DINO, THE DINOSAUR");
+            contact.saveDetail(&tag);
+        } else if (contactType == "address") {
+            QContactAddress address;
+            address.setStreet("Street 1; block 2");
+            address.setLocality("Recife");
+            address.setCountry("Brazil");
+            address.setContexts(QContactDetail::ContextHome);
+            address.setSubTypes(QList<int>() << QContactAddress::SubTypePostal
+                                             << QContactAddress::SubTypeParcel);
+            address.setDetailUri("1.4");
+            contact.saveDetail(&address);
+        } else if (contactType == "avatar url") {
+            QContactAvatar avatar;
+            avatar.setImageUrl(QUrl("https://www.google.com/m8/feeds/photos/media/renato.test%40gmail.com/1dd7d51a1518626a"));
+            avatar.setDetailUri("1.1");
+            contact.saveDetail(&avatar);
+        } else if (contactType == "avatar file") {
+            QFile file(m_tmpDir.path() + "/avatar.png");
+            if (!file.exists()) {
+                file.open(QIODevice::WriteOnly);
+                file.write("PNG image data");
+                file.close();
+            }
+            QContactAvatar avatar;
+            avatar.setImageUrl(QUrl::fromLocalFile(file.fileName()));
+            contact.saveDetail(&avatar);
+        } else if (contactType == "missing avatar file") {
+            QContactAvatar avatar;
+            avatar.setImageUrl(QUrl::fromLocalFile(m_tmpDir.path() + "/missing.png"));
+            contact.saveDetail(&avatar);
+        }
+        return contact;
+    }
+
+    QList<QContact> versitImport(const QStringList &vcards)
+    {
+        VCardParser parser;
+        parser.setFastImportEnabled(false);
+        parser.vcardToContact(vcards);
+        parser.waitForFinished();
+        return parser.contactsResult();
+    }
+
+    void compareImportedContacts(const QContact &contact, const QContact &other)
+    {
+        QCOMPARE(contact.id(), other.id());
+        QCOMPARE(contact.details(), other.details());
+        QCOMPARE(contact.preferredDetails(), other.preferredDetails());
+    }
+
+    QContact fullContact()
+    {
+        QContact c = m_contacts[0];
+
+        QContactGuid guid;
+        guid.setGuid("7b1c3a44-guid;with,escapes");
+        c.saveDetail(&guid);
+
+        QContactName name = c.detail<QContactName>();
+        name.setPrefix("Dr.");
+        name.setSuffix("Jr.");
+        name.setDetailUri("1.1");
+        c.saveDetail(&name);
+
+        QContactDisplayLabel label;
+        label.setLabel("Dino da Silva Sauro");
+        label.setDetailUri("1.1");
+        c.saveDetail(&label);
+
+        QContactNickname nickname;
+        nickname.setNickname("Dino, the dinosaur");
+        c.saveDetail(&nickname);
+
+        QContactBirthday birthday;
+        birthday.setDateTime(QDateTime(QDate(1991, 4, 26), QTime(10, 30, 0)));
+        birthday.setDetailUri("1.1");
+        c.saveDetail(&birthday);
+
+        QContactTimestamp timestamp;
+        timestamp.setLastModified(QDateTime(QDate(2015, 4, 16), QTime(15, 26, 50), Qt::UTC));
+        timestamp.setCreated(QDateTime(QDate(2015, 4, 14), QTime(16, 16, 44), Qt::UTC));
+        c.saveDetail(&timestamp);
+
+        QContactFavorite favorite;
+        favorite.setFavorite(true);
+        favorite.setDetailUri("1.1");
+        c.saveDetail(&favorite);
+
+        QContactNote note;
+        note.setNote("first line\r\nsecond line; with \\ and , chars\nlast line");
+        c.saveDetail(&note);
+
+        QContactEmailAddress email;
+        email.setEmailAddress("dino@work.com");
+        email.setContexts(QContactDetail::ContextWork);
+        email.setDetailUri("1.2");
+        c.saveDetail(&email);
+
+        QContactPhoneNumber phone;
+        phone.setNumber("+55 81 3333-1410");
+        phone.setContexts(QContactDetail::ContextHome);
+        phone.setSubTypes(QList<int>() << QContactPhoneNumber::SubTypeFax);
+        phone.setDetailUri("1.3");
+        QContactManagerEngine::setDetailAccessConstraints(&phone,
+                                                          QContactDetail::ReadOnly |
+                                                          QContactDetail::Irremovable);
+        c.saveDetail(&phone);
+        c.setPreferredDetail("TEL", phone);
+
+        QContactSyncTarget target;
+        target.setDetailUri("1.ADDRESSBOOKID0");
+        target.setSyncTarget("ADDRESSBOOKNAME0");
+        target.setValue(QContactSyncTarget::FieldSyncTarget + 1, "source-id");
+        target.setValue(QContactSyncTarget::FieldSyncTarget + 2, "0");
+        c.saveDetail(&target);
+
+        QContactExtendedDetail xDet;
+        xDet.setName("X-REMOTE-ID");
+        xDet.setData("MY_REMOTE_ID");
+        xDet.setDetailUri("1.1");
+        c.saveDetail(&xDet);
+
+        return c;
+    }
+
 
 private Q_SLOTS:
     void init()
@@ -425,6 +612,231 @@ private Q_SLOTS:
          QString vcard = VCardParser::contactToVcard(c);
          QVERIFY(vcard.contains("UID:11"));
      }
+    /*
+     * Test if the vcards written by VCardWriter are equal to the QtVersit ones
+     */
+    void testFastExportEquivalence_data()
+    {
+        QTest::addColumn<QString>("contactType");
+
+        QTest::newRow("basic contact") << "basic";
+        QTest::newRow("full contact") << "full";
+        QTest::newRow("folded lines") << "long values";
+        QTest::newRow("non ascii values") << "unicode";
+        QTest::newRow("contact id as uid") << "with id";
+        QTest::newRow("tag") << "tag";
+        QTest::newRow("address") << "address";
+        QTest::newRow("remote avatar") << "avatar url";
+        QTest::newRow("local avatar") << "avatar file";
+        QTest::newRow("missing avatar file") << "missing avatar file";
+    }
+
+    void testFastExportEquivalence()
+    {
+        QFETCH(QString, contactType);
+        // necessary to create the contact id
+        QContactManager manager("memory");
+
+        QContact contact = testContact(contactType);
+        QVERIFY(VCardWriter::canWrite(contact));
+
+        VCardWriter writer;
+        QString vcard = writer.write(contact);
+        QString versitVcard = versitExport(QList<QContact>() << contact).value(0);
+
+        QCOMPARE(normalizeVCard(vcard), normalizeVCard(versitVcard));
+        QCOMPARE(VCardParser::contactToVcard(contact), vcard);
+    }
+
+    /*
+     * Test if the vcards written by VCardWriter can be parsed back
+     */
+    void testFastExportRoundTrip()
+    {
+        QContact contact = fullContact();
+
+        VCardWriter writer;
+        QContact parsed = VCardParser::vcardToContact(writer.write(contact));
+        compareContact(parsed, contact);
+
+        QCOMPARE(parsed.detail<QContactGuid>().guid(), contact.detail<QContactGuid>().guid());
+        QCOMPARE(parsed.detail<QContactDisplayLabel>().label(), contact.detail<QContactDisplayLabel>().label());
+        QCOMPARE(parsed.detail<QContactNickname>().nickname(), contact.detail<QContactNickname>().nickname());
+        QCOMPARE(parsed.detail<QContactFavorite>().isFavorite(), true);
+        QCOMPARE(parsed.detail<QContactNote>().note(),
+                 QString("first line\nsecond line; with \\ and , chars\nlast line"));
+        QCOMPARE(parsed.detail<QContactTimestamp>().lastModified(),
+                 contact.detail<QContactTimestamp>().lastModified());
+
+        QContactPhoneNumber phone = parsed.detail<QContactPhoneNumber>();
+        Q_FOREACH(const QContactPhoneNumber &p, parsed.details<QContactPhoneNumber>()) {
+            if (p.number() == "+55 81 3333-1410") {
+                phone = p;
+            }
+        }
+        QCOMPARE(phone.detailUri(), QString("1.3"));
+        QVERIFY(phone.accessConstraints().testFlag(QContactDetail::ReadOnly));
+        QVERIFY(phone.accessConstraints().testFlag(QContactDetail::Irremovable));
+        QCOMPARE(QContactPhoneNumber(parsed.preferredDetail("TEL")).number(), phone.number());
+
+        QContactSyncTarget target = parsed.detail<QContactSyncTarget>();
+        QCOMPARE(target.detailUri(), QString("1.ADDRESSBOOKID0"));
+        QCOMPARE(target.syncTarget(), QString("ADDRESSBOOKNAME0"));
+        QCOMPARE(target.value(QContactSyncTarget::FieldSyncTarget + 1).toString(), QString("source-id"));
+
+        QContactExtendedDetail xDet = parsed.detail<QContactExtendedDetail>();
+        QCOMPARE(xDet.name(), QString("X-REMOTE-ID"));
+        QCOMPARE(xDet.data().toString(), QString("MY_REMOTE_ID"));
+    }
+
+    /*
+     * Test if contacts with details not supported by VCardWriter are exported by QtVersit
+     * keeping the original order
+     */
+    void testFastExportFallback()
+    {
+        QContact withOrganization = m_contacts[1];
+        QContactOrganization organization;
+        organization.setName("Recife Corp");
+        organization.setTitle("Dinosaur");
+        withOrganization.saveDetail(&organization);
+        QVERIFY(!VCardWriter::canWrite(withOrganization));
+
+        QContact withAvatar = m_contacts[1];
+        QContactAvatar avatar;
+        avatar.setImageUrl(QUrl::fromLocalFile(m_tmpDir.path() + "/avatar.svg"));
+        withAvatar.saveDetail(&avatar);
+        QVERIFY(!VCardWriter::canWrite(withAvatar));
+
+        QList<QContact> contacts;
+        contacts << m_contacts[0] << withOrganization << fullContact();
+
+        QStringList vcards = VCardParser::contactToVcardSync(contacts);
+        QStringList versitVcards = versitExport(contacts);
+        QCOMPARE(vcards.size(), 3);
+        QCOMPARE(versitVcards.size(), 3);
+        for(int i=0; i < vcards.size(); i++) {
+            QCOMPARE(normalizeVCard(vcards[i]), normalizeVCard(versitVcards[i]));
+        }
+        QVERIFY(vcards[1].contains("Recife Corp"));
+    }
+
+    /*
+     * Test if the contacts read by VCardReader are equal to the QtVersit ones
+     */
+    void testFastImportEquivalence_data()
+    {
+        QTest::addColumn<QString>("contactType");
+
+        QTest::newRow("basic contact") << "basic";
+        QTest::newRow("full contact") << "full";
+        QTest::newRow("folded lines") << "long values";
+        QTest::newRow("non ascii values") << "unicode";
+        QTest::newRow("contact id as uid") << "with id";
+        QTest::newRow("hand written vcard") << "vcard";
+    }
+
+    void testFastImportEquivalence()
+    {
+        QFETCH(QString, contactType);
+        QContactManager manager("memory");
+
+        QString vcard;
+        if (contactType == "vcard") {
+            // lines ending with "\n"
+            vcard = m_vcards[1];
+            vcard.replace("\r\n", "\n");
+        } else {
+            VCardWriter writer;
+            vcard = writer.write(testContact(contactType));
+        }
+
+        VCardReader reader;
+        QContact contact;
+        QVERIFY(reader.read(vcard, &contact));
+
+        QList<QContact> versitContacts = versitImport(QStringList() << vcard);
+        QCOMPARE(versitContacts.size(), 1);
+        compareImportedContacts(contact, versitContacts[0]);
+        compareImportedContacts(VCardParser::vcardToContact(vcard), contact);
+    }
+
+    /*
+     * Test if vcards with properties not supported by VCardReader are imported by QtVersit
+     * keeping the original order
+     */
+    void testFastImportFallback()
+    {
+        QString withAddress = m_vcards[1];
+        withAddress.replace("END:VCARD", "ADR;TYPE=HOME:;;Street 1;Recife;;;\r\nEND:VCARD");
+
+        VCardReader reader;
+        QContact contact;
+        QVERIFY(!reader.read(withAddress, &contact));
+        QVERIFY(!reader.read(QStringLiteral("BEGIN:VCARD\r\nEND::VCARD\r\n"), &contact));
+
+        QStringList vcards;
+        vcards << m_vcards[0] << withAddress << m_vcards[1];
+        QList<QContact> contacts = VCardParser::vcardToContactSync(vcards);
+        QList<QContact> versitContacts = versitImport(vcards);
+        QCOMPARE(contacts.size(), 3);
+        QCOMPARE(versitContacts.size(), 3);
+        for(int i=0; i < contacts.size(); i++) {
+            compareImportedContacts(contacts[i], versitContacts[i]);
+        }
+        QCOMPARE(contacts[1].detail<QContactAddress>().locality(), QString("Recife"));
+    }
+
+    /*
+     * Test that the invalid vcards keep their positions as empty contacts
+     */
+    void testInvalidVCardPosition()
+    {
+        QString withAddress = m_vcards[1];
+        withAddress.replace("END:VCARD", "ADR;TYPE=HOME:;;Street 1;Recife;;;\r\nEND:VCARD");
+
+        QStringList vcards;
+        vcards << QStringLiteral("BEGIN:VCARD\r\nEND::VCARD\r\n") << m_vcards[0] << withAddress;
+        QList<QContact> contacts = VCardParser::vcardToContactSync(vcards);
+        QCOMPARE(contacts.size(), 3);
+        QVERIFY(contacts[0].isEmpty());
+        compareContact(contacts[1], m_contacts[0]);
+        QCOMPARE(contacts[2].detail<QContactAddress>().locality(), QString("Recife"));
+    }
+
+    /*
+     * Compare the number of contacts decoded per second by QtVersit and VCardReader
+     */
+    void benchmarkVCardToContact_data()
+    {
+        QTest::addColumn<bool>("fastImport");
+
+        QTest::newRow("qtversit") << false;
+        QTest::newRow("vcard reader") << true;
+    }
+
+    void benchmarkVCardToContact()
+    {
+        QFETCH(bool, fastImport);
+
+        QStringList vcards;
+        VCardWriter writer;
+        QContact contact = fullContact();
+        for(int i=0; i < 1000; i++) {
+            QContactName name = contact.detail<QContactName>();
+            name.setFirstName(QString("Dino %1").arg(i));
+            contact.saveDetail(&name);
+            vcards << writer.write(contact);
+        }
+
+        VCardParser parser;
+        parser.setFastImportEnabled(fastImport);
+        QBENCHMARK {
+            parser.vcardToContact(vcards);
+            parser.waitForFinished();
+        }
+        QCOMPARE(parser.contactsResult().size(), vcards.size());
+    }
 };
 
 QTEST_MAIN(VCardParseTest)